@@ -174,7 +174,11 @@ std::string get_default_json_content() {
         {"background", {255, 165, 0}},
         {"after", ""},
         {"nerd-icon", ""},
-        {"bold", false}
+        {"bold", false},
+        {"showAheadBehind", true},
+        {"showDirty", true},
+        {"timeout", 50},
+        {"staleIndicator", " …"}
     }},
     {"currentdir", {
         {"enabled", true},
@@ -234,6 +238,13 @@ std::string get_sh_default_json() {
           {"italic", false},
           {"underline", false}
       }},
+      {"unknown_command", {
+          {"foreground", {230, 57, 70}},
+          {"background", {256, 256, 256}},
+          {"bold", false},
+          {"italic", false},
+          {"underline", false}
+      }},
       {"subcommand", {
           {"foreground", {226, 149, 120}},
           {"background", {256, 256, 256}},
@@ -431,10 +442,11 @@ int install() {
 
     print("[slash-utils] Creating shared library libslashutils\n");
     system("g++ -std=c++20 -fPIC -shared "
-       "../abstractions/iofuncs.cpp ../abstractions/info.cpp ../help_helper.cpp "
+       "../abstractions/iofuncs.cpp ../abstractions/filestream.cpp ../abstractions/walker.cpp ../abstractions/watcher.cpp ../abstractions/fuzzy.cpp ../abstractions/csv.cpp "
+       "../abstractions/info.cpp ../help_helper.cpp "
        "../cmd_highlighter.cpp ../abstractions/json.cpp ../tui/tui.cpp ../git/git.cpp "
        "-o ~/.slash/slash-utils/libslashutils.so "
-       "-lgit2 -lssl -lcrypto");
+       "-lgit2 -lssl -lcrypto -pthread");
 
     const char* ld_path = getenv("LD_LIBRARY_PATH");
     std::string new_ld_path = (ld_path ? std::string(ld_path) : "") + ":" + home + "/.slash/slash-utils";
@@ -456,20 +468,20 @@ int install() {
         "g++ -std=c++20 create.cpp -o " + home + "/.slash/slash-utils/create -L" + home + "/.slash/slash-utils -lslashutils",
         "g++ -std=c++20 del.cpp -o " + home + "/.slash/slash-utils/del -L" + home + "/.slash/slash-utils -lslashutils",
         "g++ -std=c++20 echo.cpp -o " + home + "/.slash/slash-utils/echo -L" + home + "/.slash/slash-utils -lslashutils",
-        "g++ -std=c++20 fnd.cpp -o " + home + "/.slash/slash-utils/fnd -L" + home + "/.slash/slash-utils -lslashutils",
-        "g++ -std=c++20 ls.cpp -o " + home + "/.slash/slash-utils/ls -L" + home + "/.slash/slash-utils -lslashutils -lgit2",
+        "g++ -std=c++20 fnd.cpp -o " + home + "/.slash/slash-utils/fnd -L" + home + "/.slash/slash-utils -lslashutils -pthread",
+        "g++ -std=c++20 ls.cpp -o " + home + "/.slash/slash-utils/ls -L" + home + "/.slash/slash-utils -lslashutils -lgit2 -pthread",
         "g++ -std=c++20 clear.cpp -o " + home + "/.slash/slash-utils/clear -L" + home + "/.slash/slash-utils -lslashutils",
         "g++ -std=c++20 csv.cpp -o " + home + "/.slash/slash-utils/csv -L" + home + "/.slash/slash-utils -lslashutils",
-        "g++ -std=c++20 disku.cpp -o " + home + "/.slash/slash-utils/disku -L" + home + "/.slash/slash-utils -lslashutils",
+        "g++ -std=c++20 disku.cpp -o " + home + "/.slash/slash-utils/disku -L" + home + "/.slash/slash-utils -lslashutils -pthread",
         "g++ -std=c++20 encode.cpp -o " + home + "/.slash/slash-utils/encode -L" + home + "/.slash/slash-utils -lslashutils",
         "g++ -std=c++20 mkdir.cpp -o " + home + "/.slash/slash-utils/mkdir -L" + home + "/.slash/slash-utils -lslashutils",
-        "g++ -std=c++20 pager.cpp -o " + home + "/.slash/slash-utils/pager -L" + home + "/.slash/slash-utils -lslashutils",
+        "g++ -std=c++20 pager.cpp -o " + home + "/.slash/slash-utils/pager -L" + home + "/.slash/slash-utils -lslashutils -pthread",
         "g++ -std=c++20 sumcheck.cpp -o " + home + "/.slash/slash-utils/sumcheck -L" + home + "/.slash/slash-utils -lslashutils -lssl -lcrypto",
         "g++ -std=c++20 textmt.cpp -o " + home + "/.slash/slash-utils/textmt -L" + home + "/.slash/slash-utils -lslashutils",
         "g++ -std=c++20 netinfo.cpp -o " + home + "/.slash/slash-utils/netinfo -L" + home + "/.slash/slash-utils -lslashutils",
         "g++ -std=c++20 ren.cpp -o " + home + "/.slash/slash-utils/ren -L" + home + "/.slash/slash-utils -lslashutils",
-        "g++ -std=c++20 rf.cpp -o " + home + "/.slash/slash-utils/rf -L" + home + "/.slash/slash-utils -lslashutils -lgit2",
-        "g++ -std=c++20 srch.cpp -o " + home + "/.slash/slash-utils/srch -L" + home + "/.slash/slash-utils -lslashutils",
+        "g++ -std=c++20 rf.cpp -o " + home + "/.slash/slash-utils/rf -L" + home + "/.slash/slash-utils -lslashutils -lgit2 -pthread",
+        "g++ -std=c++20 srch.cpp -o " + home + "/.slash/slash-utils/srch -L" + home + "/.slash/slash-utils -lslashutils -pthread",
         "g++ -std=c++20 md.cpp -o " + home + "/.slash/slash-utils/md -L" + home + "/.slash/slash-utils -lslashutils"
     };
 
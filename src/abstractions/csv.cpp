@@ -0,0 +1,190 @@
+#include "csv.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const size_t CSV_CHUNK_SIZE = 256 * 1024;
+
+io::CsvReader::CsvReader(const std::string& path, char separator, bool map) : separator(separator) {
+  struct stat st{};
+  if(map && stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+    file = FileView(path);
+    err = file.error();
+    data = file.view();
+    eof = true;
+    return;
+  }
+
+  fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    err = errno;
+    eof = true;
+    return;
+  }
+  owns_fd = true;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  buffer.resize(CSV_CHUNK_SIZE);
+}
+
+io::CsvReader::CsvReader(Text text, char separator) : text(std::move(text.value)), separator(separator) {
+  data = this->text;
+  eof = true;
+}
+
+io::CsvReader::~CsvReader() {
+  if(owns_fd) close(fd);
+}
+
+// Moves the row being read to the front of the buffer and reads more after it
+bool io::CsvReader::fill() {
+  if(eof) return false;
+
+  size_t keep = data.size() - row_start;
+  if(row_start > 0) {
+    memmove(buffer.data(), buffer.data() + row_start, keep);
+    scanned -= row_start;
+    row_start = 0;
+  }
+  if(keep == buffer.size()) buffer.resize(buffer.size() * 2);
+
+  while(true) {
+    ssize_t n = read(fd, buffer.data() + keep, buffer.size() - keep);
+    if(n > 0) {
+      data = std::string_view(buffer.data(), keep + n);
+      return true;
+    }
+    if(n < 0 && errno == EINTR) continue;
+    if(n < 0) err = errno;
+    data = std::string_view(buffer.data(), keep);
+    eof = true;
+    return false;
+  }
+}
+
+// Classifies the next 64 bytes, or whatever is left at the end
+void io::CsvReader::scan_block() {
+  size_t n = std::min<size_t>(64, data.size() - scanned);
+  const char* p = data.data() + scanned;
+  char tail[64];
+  if(n < 64) {
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, p, n);
+    p = tail;
+  }
+
+  uint64_t quotes = 0, structural = 0;
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i sep = _mm_set1_epi8(separator);
+  const __m128i nl = _mm_set1_epi8('\n');
+  for(int i = 0; i < 4; i++) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+    quotes |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)))) << (i * 16);
+    structural |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(chunk, sep), _mm_cmpeq_epi8(chunk, nl))))) << (i * 16);
+  }
+#else
+  for(int i = 0; i < 64; i++) {
+    quotes |= static_cast<uint64_t>(p[i] == '"') << i;
+    structural |= static_cast<uint64_t>(p[i] == separator || p[i] == '\n') << i;
+  }
+#endif
+
+  // Each bit becomes the XOR of itself and every bit below it, so the bytes from an opening
+  // quote up to its closing one are set. A "" inside quotes flips it twice and changes nothing
+  uint64_t in_quotes = quotes;
+  for(int shift = 1; shift < 64; shift *= 2) in_quotes ^= in_quotes << shift;
+  if(inside) in_quotes = ~in_quotes;
+  inside = (in_quotes >> 63) & 1;
+
+  pending = structural & ~in_quotes;
+  if(n < 64) pending &= (uint64_t(1) << n) - 1;
+  block = scanned;
+  scanned += n;
+}
+
+bool io::CsvReader::next_structural(size_t& pos) {
+  while(pending == 0) {
+    // Only whole blocks get scanned until the end, a quote can't be judged without what's after it
+    if(data.size() - scanned < 64 && !eof) {
+      fill();
+      continue;
+    }
+    if(scanned == data.size()) return false;
+    scan_block();
+  }
+
+  pos = block + __builtin_ctzll(pending);
+  pending &= pending - 1;
+  return true;
+}
+
+bool io::CsvReader::rewind() {
+  if(!seekable()) return false;
+  row_start = scanned = block = 0;
+  pending = 0;
+  inside = false;
+  return true;
+}
+
+bool io::CsvReader::next_row(std::vector<std::string_view>& fields) {
+  fields.clear();
+  bounds.clear();
+
+  size_t field = 0; // Relative to row_start, which fill() may move
+  while(true) {
+    size_t pos;
+    if(!next_structural(pos)) {
+      if(row_start == data.size()) return false;
+      bounds.push_back({field, data.size() - row_start}); // Last row without a newline
+      break;
+    }
+
+    bounds.push_back({field, pos - row_start});
+    if(data[pos] == '\n') break;
+    field = pos + 1 - row_start;
+  }
+
+  std::string_view row = data.substr(row_start, bounds.back().second);
+  row_start += bounds.back().second + 1;
+  if(row_start > data.size()) row_start = data.size();
+
+  if(!row.empty() && row.back() == '\r') {
+    row.remove_suffix(1);
+    bounds.back().second--;
+  }
+
+  // Reserved up front so the views into it stay put
+  unescaped.clear();
+  unescaped.reserve(row.size());
+
+  for(auto [start, end] : bounds) {
+    std::string_view value = row.substr(start, end - start);
+    if(value.empty() || value[0] != '"') {
+      fields.push_back(value);
+      continue;
+    }
+
+    value.remove_prefix(1);
+    if(!value.empty() && value.back() == '"') value.remove_suffix(1);
+    if(value.find('"') == std::string_view::npos) {
+      fields.push_back(value);
+      continue;
+    }
+
+    size_t from = unescaped.size();
+    for(size_t i = 0; i < value.size(); i++) {
+      unescaped += value[i];
+      if(value[i] == '"' && i + 1 < value.size() && value[i + 1] == '"') i++;
+    }
+    fields.push_back(std::string_view(unescaped).substr(from));
+  }
+  return true;
+}
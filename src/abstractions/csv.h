@@ -0,0 +1,69 @@
+#ifndef SLASH_CSV_H
+#define SLASH_CSV_H
+
+#include "filestream.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace io {
+  // Reads CSV the way RFC 4180 has it: fields split by a separator and rows by "\n" or "\r\n", where a
+  // field in double quotes can hold separators, newlines and "" for a quote. Separators and newlines are
+  // found 64 bytes at a time with SSE2 like simdcsv does: the quotes in a block are turned into a mask of
+  // the bytes inside quotes with a prefix XOR, and whatever is inside them isn't structural.
+  //
+  // Files are read in chunks, so memory stays bounded by the chunk size plus the longest row. A regular
+  // file can be mapped instead, to read it more than once with rewind()
+  class CsvReader {
+    private:
+    FileView file;
+    int fd = -1;
+    bool owns_fd = false;
+    std::vector<char> buffer; // What was read from fd
+    std::string text;         // When reading text given directly
+    std::string_view data;    // Everything available so far
+    bool eof = false;
+    int err = 0;
+    char separator;
+
+    size_t row_start = 0; // Where the next row begins in data
+    size_t scanned = 0;   // Bytes classified so far
+    size_t block = 0;     // Offset of the block pending is for
+    uint64_t pending = 0; // Separators and newlines in that block not handed out yet
+    bool inside = false;  // The last byte scanned was inside quotes
+
+    std::vector<std::pair<size_t, size_t>> bounds; // Of the current row's fields, relative to row_start
+    std::string unescaped; // Quoted fields that had "" in them, with the quotes halved
+
+    bool fill();
+    void scan_block();
+    bool next_structural(size_t& pos);
+
+    public:
+    // CSV given directly rather than a path to it
+    struct Text {
+      std::string value;
+    };
+
+    CsvReader(const std::string& path, char separator, bool map = false);
+    CsvReader(Text text, char separator);
+    CsvReader(const CsvReader&) = delete;
+    CsvReader& operator=(const CsvReader&) = delete;
+    ~CsvReader();
+
+    bool ok() const { return err == 0; }
+    int error() const { return err; }
+
+    // Whether rewind() works, i.e. the whole input is in memory or mapped
+    bool seekable() const { return fd == -1; }
+    bool rewind();
+
+    // The next row's fields with their quotes taken off, valid until the next call. False at the end
+    bool next_row(std::vector<std::string_view>& fields);
+  };
+}
+
+#endif // SLASH_CSV_H
@@ -0,0 +1,209 @@
+#include "filestream.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Below this, one read() is cheaper than setting up and faulting in a mapping
+const size_t MIN_MAPPED_SIZE = 16 * 1024;
+
+#pragma region FileView
+
+io::FileView::FileView(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    err = errno;
+    return;
+  }
+
+  struct stat st{};
+  bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  if(regular && static_cast<size_t>(st.st_size) >= MIN_MAPPED_SIZE) {
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr != MAP_FAILED) {
+      data = static_cast<const char*>(addr);
+      length = st.st_size;
+      mapped = true;
+      close(fd);
+      return;
+    }
+  }
+
+  // Not mappable (pipe, character device, procfs...), read it until EOF since st_size can't be trusted
+  if(regular) buffer.reserve(st.st_size);
+  char chunk[64 * 1024];
+  while(true) {
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if(n == 0) break;
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      err = errno;
+      buffer.clear();
+      break;
+    }
+    buffer.append(chunk, n);
+  }
+  close(fd);
+
+  data = buffer.data();
+  length = buffer.size();
+}
+
+io::FileView::FileView(FileView&& other) noexcept {
+  *this = std::move(other);
+}
+
+io::FileView& io::FileView::operator=(FileView&& other) noexcept {
+  if(this == &other) return *this;
+  if(mapped) munmap(const_cast<char*>(data), length);
+
+  mapped = other.mapped;
+  length = other.length;
+  err = other.err;
+  buffer = std::move(other.buffer);
+  data = mapped ? other.data : buffer.data(); // A moved short string doesn't keep its address
+
+  other.data = nullptr;
+  other.length = 0;
+  other.mapped = false;
+  return *this;
+}
+
+io::FileView::~FileView() {
+  if(mapped) munmap(const_cast<char*>(data), length);
+}
+
+#pragma endregion
+
+#pragma region StreamReader
+
+io::StreamReader::StreamReader(int fd, size_t chunk_size) : fd(fd), buf(chunk_size) {}
+
+io::StreamReader::StreamReader(const std::string& path, size_t chunk_size) : buf(chunk_size) {
+  fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd == -1) {
+    err = errno;
+    eof = true;
+    return;
+  }
+  owns_fd = true;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+io::StreamReader::~StreamReader() {
+  if(owns_fd) close(fd);
+}
+
+bool io::StreamReader::fill() {
+  if(eof) return false;
+
+  // Keep the unconsumed part, moved to the front, and only grow when a single line fills the whole buffer
+  if(begin > 0) {
+    memmove(buf.data(), buf.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+  }
+  if(end == buf.size()) buf.resize(buf.size() * 2);
+
+  while(true) {
+    ssize_t n = read(fd, buf.data() + end, buf.size() - end);
+    if(n > 0) {
+      end += n;
+      return true;
+    }
+    if(n < 0 && errno == EINTR) continue;
+    if(n < 0) err = errno;
+    eof = true;
+    return false;
+  }
+}
+
+bool io::StreamReader::next_chunk(std::string_view& chunk) {
+  if(begin == end && !fill()) return false;
+  chunk = std::string_view(buf.data() + begin, end - begin);
+  begin = end;
+  return true;
+}
+
+bool io::StreamReader::next_line(std::string_view& line) {
+  size_t searched = begin; // Don't scan the same bytes again after every read
+  while(true) {
+    const char* start = buf.data() + begin;
+    const char* nl = static_cast<const char*>(memchr(buf.data() + searched, '\n', end - searched));
+    if(nl != nullptr) {
+      line = std::string_view(start, nl - start);
+      begin = nl - buf.data() + 1;
+      return true;
+    }
+
+    size_t pending = end - begin;
+    if(!fill()) {
+      if(begin == end) return false;
+      line = std::string_view(buf.data() + begin, end - begin); // Last line without a trailing newline
+      begin = end;
+      return true;
+    }
+    searched = begin + pending;
+  }
+}
+
+#pragma endregion
+
+#pragma region Newlines
+
+size_t io::count_newlines(std::string_view text) {
+  const char* p = text.data();
+  size_t size = text.size();
+  size_t count = 0;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+  for(; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl)));
+  }
+#endif
+
+  for(; i < size; i++) count += p[i] == '\n';
+  return count;
+}
+
+size_t io::line_start(std::string_view text, size_t n) {
+  if(n == 0) return 0;
+
+  const char* p = text.data();
+  size_t size = text.size();
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+  for(; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, nl));
+    size_t found = __builtin_popcount(mask);
+    if(found < n) {
+      n -= found;
+      continue;
+    }
+
+    // The one we want is in this block, drop the ones before it
+    while(--n > 0) mask &= mask - 1;
+    return i + __builtin_ctz(mask) + 1;
+  }
+#endif
+
+  for(; i < size; i++) {
+    if(p[i] == '\n' && --n == 0) return i + 1;
+  }
+  return std::string_view::npos;
+}
+
+#pragma endregion
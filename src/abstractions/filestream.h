@@ -0,0 +1,117 @@
+#ifndef SLASH_FILESTREAM_H
+#define SLASH_FILESTREAM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace io {
+  // Read-only view of a whole file. Regular files are mmap'd, so nothing is copied and the kernel
+  // pages the file in as it's used; anything else (pipes, /proc files, small files) is read into memory.
+  // A mapped file that gets truncated by someone else while it's being read raises SIGBUS
+  class FileView {
+    private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string buffer; // Used when the file isn't mapped
+    int err = 0;
+
+    public:
+    FileView() = default;
+    explicit FileView(const std::string& path);
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+    FileView(FileView&& other) noexcept;
+    FileView& operator=(FileView&& other) noexcept;
+    ~FileView();
+
+    bool ok() const { return err == 0; }
+    int error() const { return err; } // errno of the failed open or read
+    bool is_mapped() const { return mapped; }
+
+    std::string_view view() const { return {data, length}; }
+    size_t size() const { return length; }
+  };
+
+  // Reads a file descriptor (stdin, a pipe, a socket or a file) in fixed-size chunks,
+  // so memory stays bounded by the chunk size plus the longest line
+  class StreamReader {
+    private:
+    int fd = -1;
+    bool owns_fd = false;
+    std::vector<char> buf;
+    size_t begin = 0; // Unconsumed data is buf[begin, end)
+    size_t end = 0;
+    bool eof = false;
+    int err = 0;
+
+    bool fill(); // Reads more after the unconsumed data, false at EOF or on error
+
+    public:
+    explicit StreamReader(int fd, size_t chunk_size = 64 * 1024);
+    explicit StreamReader(const std::string& path, size_t chunk_size = 64 * 1024);
+    StreamReader(const StreamReader&) = delete;
+    StreamReader& operator=(const StreamReader&) = delete;
+    ~StreamReader();
+
+    bool ok() const { return err == 0; }
+    int error() const { return err; }
+
+    // Both hand out views into the internal buffer, valid until the next call
+    bool next_chunk(std::string_view& chunk);
+    bool next_line(std::string_view& line); // Without the '\n', a final line without one is still returned
+  };
+
+  // Iterates the lines of a buffer without copying them: for(std::string_view line : io::Lines(text))
+  class Lines {
+    private:
+    std::string_view text;
+
+    public:
+    class iterator {
+      private:
+      std::string_view rest;
+      std::string_view line;
+      bool done = true;
+
+      void advance() {
+        if(rest.empty()) {
+          done = true;
+          return;
+        }
+        size_t nl = rest.find('\n');
+        if(nl == std::string_view::npos) {
+          line = rest;
+          rest = {};
+        } else {
+          line = rest.substr(0, nl);
+          rest.remove_prefix(nl + 1);
+        }
+      }
+
+      public:
+      iterator() = default;
+      explicit iterator(std::string_view text) : rest(text), done(false) { advance(); }
+
+      std::string_view operator*() const { return line; }
+      iterator& operator++() { advance(); return *this; }
+      bool operator==(const iterator& other) const { return done && other.done; }
+      bool operator!=(const iterator& other) const { return !(*this == other); }
+    };
+
+    explicit Lines(std::string_view text) : text(text) {}
+    iterator begin() const { return iterator(text); }
+    iterator end() const { return iterator(); }
+  };
+
+  // Number of '\n' in text. Counted 16 bytes at a time with SSE2, so it goes about as fast as memory does
+  size_t count_newlines(std::string_view text);
+
+  // Offset where line n (from 0) starts, just past the n-th '\n', or npos if text has fewer lines.
+  // Skips whole blocks the same way count_newlines counts them, without looking at the lines in between
+  size_t line_start(std::string_view text, size_t n);
+}
+
+#endif // SLASH_FILESTREAM_H
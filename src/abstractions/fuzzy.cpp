@@ -0,0 +1,404 @@
+#include "fuzzy.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Same scores as fzf
+static constexpr int SCORE_MATCH = 16;
+static constexpr int GAP_START = -3;
+static constexpr int GAP_EXTENSION = -1;
+static constexpr int BONUS_BOUNDARY = SCORE_MATCH / 2;
+static constexpr int BONUS_NONWORD = SCORE_MATCH / 2;
+static constexpr int BONUS_CAMEL = BONUS_BOUNDARY + GAP_EXTENSION;
+static constexpr int BONUS_CONSECUTIVE = -(GAP_START + GAP_EXTENSION);
+static constexpr int BONUS_BOUNDARY_WHITE = BONUS_BOUNDARY + 2;
+static constexpr int BONUS_BOUNDARY_DELIMITER = BONUS_BOUNDARY + 1;
+static constexpr int FIRST_CHAR_MULTIPLIER = 2;
+
+static constexpr int NONE = std::numeric_limits<int>::min() / 2;
+static constexpr size_t MAX_CELLS = 64 * 1024; // Past this the table costs more than it's worth, so it's matched greedily
+static constexpr size_t MIN_CHUNK = 16 * 1024; // Candidates per thread, fewer than that aren't worth a thread
+
+enum CharClass { WHITE, NONWORD, DELIMITER, LOWER, UPPER, LETTER, NUMBER };
+
+static CharClass class_of(char ch) {
+  unsigned char c = static_cast<unsigned char>(ch);
+  if(c >= 'a' && c <= 'z') return LOWER;
+  if(c >= 'A' && c <= 'Z') return UPPER;
+  if(c >= '0' && c <= '9') return NUMBER;
+  if(c >= 0x80) return LETTER;
+  if(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') return WHITE;
+  if(c == '/' || c == ',' || c == ':' || c == ';' || c == '|') return DELIMITER;
+  return NONWORD;
+}
+
+static int bonus_for(CharClass prev, CharClass current) {
+  if(current > NONWORD) {
+    if(prev == WHITE) return BONUS_BOUNDARY_WHITE;
+    if(prev == DELIMITER) return BONUS_BOUNDARY_DELIMITER;
+    if(prev == NONWORD) return BONUS_BOUNDARY;
+  }
+  if((prev == LOWER && current == UPPER) || (prev != NUMBER && current == NUMBER)) return BONUS_CAMEL;
+  if(current == NONWORD || current == DELIMITER) return BONUS_NONWORD;
+  if(current == WHITE) return BONUS_BOUNDARY_WHITE;
+  return 0;
+}
+
+static char lower(char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+#pragma region Candidates
+
+void fuzzy::Candidates::add(std::string_view text) {
+  uint64_t lo = 0, hi = 0;
+  for(char ch : text) {
+    unsigned char c = static_cast<unsigned char>(lower(ch));
+    if(c < 64) lo |= 1ULL << c;
+    else if(c < 127) hi |= 1ULL << (c - 64);
+    else hi |= 1ULL << 63;
+  }
+
+  arena.append(text);
+  offsets.push_back(static_cast<uint32_t>(arena.size()));
+  masks_lo.push_back(lo);
+  masks_hi.push_back(hi);
+}
+
+void fuzzy::Candidates::clear() {
+  arena.clear();
+  offsets = {0};
+  masks_lo.clear();
+  masks_hi.clear();
+}
+
+#pragma endregion
+
+#pragma region Pattern
+
+fuzzy::Pattern::Pattern(std::string_view query) : chars(query) {
+  case_sensitive = std::any_of(chars.begin(), chars.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+
+  for(char& ch : chars) {
+    char l = lower(ch);
+    if(!case_sensitive) ch = l;
+
+    unsigned char c = static_cast<unsigned char>(l);
+    if(c < 64) need_lo |= 1ULL << c;
+    else if(c < 127) need_hi |= 1ULL << (c - 64);
+    else need_hi |= 1ULL << 63;
+  }
+}
+
+bool fuzzy::Pattern::narrows(const Pattern& previous) const {
+  if(previous.empty()) return true;
+  if(previous.case_sensitive && !case_sensitive) return false;
+
+  // previous has to be a subsequence of this
+  size_t i = 0;
+  for(char c : chars) {
+    if(i < previous.chars.size() && (previous.case_sensitive ? c : lower(c)) == previous.chars[i]) i++;
+  }
+  return i == previous.chars.size();
+}
+
+// fzf's first algorithm: the earliest place the pattern ends, then shortened from the back as much as it goes
+int fuzzy::Pattern::score_greedy(std::string_view text, size_t first, size_t last) const {
+  auto eq = [&](char c, char p) { return (case_sensitive ? c : lower(c)) == p; };
+  size_t m = chars.size();
+
+  size_t end = first;
+  for(size_t j = first, i = 0; j <= last; j++) {
+    if(eq(text[j], chars[i]) && ++i == m) {
+      end = j;
+      break;
+    }
+  }
+
+  size_t start = end;
+  for(size_t j = end + 1, i = m; j-- > first;) {
+    if(eq(text[j], chars[i - 1]) && --i == 0) {
+      start = j;
+      break;
+    }
+  }
+
+  int score = 0, first_bonus = 0;
+  size_t i = 0, consecutive = 0;
+  bool in_gap = false;
+  CharClass prev = start > 0 ? class_of(text[start - 1]) : WHITE;
+  for(size_t j = start; j <= end; j++) {
+    CharClass current = class_of(text[j]);
+    if(eq(text[j], chars[i])) {
+      int bonus = bonus_for(prev, current);
+      if(consecutive == 0) first_bonus = bonus;
+      else {
+        if(bonus >= BONUS_BOUNDARY && bonus > first_bonus) first_bonus = bonus;
+        bonus = std::max({bonus, first_bonus, BONUS_CONSECUTIVE});
+      }
+      score += SCORE_MATCH + (i == 0 ? bonus * FIRST_CHAR_MULTIPLIER : bonus);
+      in_gap = false;
+      consecutive++;
+      i++;
+    } else {
+      score += in_gap ? GAP_EXTENSION : GAP_START;
+      in_gap = true;
+      consecutive = 0;
+      first_bonus = 0;
+    }
+    prev = current;
+  }
+  return score;
+}
+
+// fzf's second algorithm: the best scoring alignment, one table row per pattern character. Row i only
+// covers the text between the earliest and the latest place character i can be at and still leave room
+// for the rest of the pattern, which the scans that check for a match in the first place find
+int fuzzy::Pattern::score(std::string_view text) const {
+  if(chars.empty()) return 0;
+  auto eq = [&](char c, char p) { return (case_sensitive ? c : lower(c)) == p; };
+  size_t m = chars.size();
+
+  struct Scratch {
+    std::vector<size_t> from, to;
+    std::vector<int> h_prev, h_cur, chunk_prev, chunk_cur;
+  };
+  thread_local Scratch s;
+  if(s.from.size() < m) {
+    s.from.resize(m);
+    s.to.resize(m);
+  }
+
+  size_t i = 0;
+  for(size_t j = 0; j < text.size() && i < m; j++) {
+    if(eq(text[j], chars[i])) s.from[i++] = j;
+  }
+  if(i < m) return -1;
+
+  size_t j = text.size();
+  for(i = m; i-- > 0;) {
+    while(!eq(text[--j], chars[i])) {}
+    s.to[i] = j;
+  }
+
+  size_t first = s.from[0], last = s.to[m - 1];
+  size_t width = last - first + 1;
+
+  if(m == 1) { // Just the best placed occurrence
+    int best = 0;
+    for(j = first; j <= last; j++) {
+      if(!eq(text[j], chars[0])) continue;
+      int b = bonus_for(j > 0 ? class_of(text[j - 1]) : WHITE, class_of(text[j]));
+      best = std::max(best, SCORE_MATCH + b * FIRST_CHAR_MULTIPLIER);
+    }
+    return best;
+  }
+  if(width * m > MAX_CELLS) return score_greedy(text, first, last);
+
+  if(s.h_prev.size() < width) {
+    for(auto* v : {&s.h_prev, &s.h_cur, &s.chunk_prev, &s.chunk_cur}) v->resize(width);
+  }
+  std::fill(s.h_prev.begin(), s.h_prev.begin() + width, NONE);
+  std::fill(s.h_cur.begin(), s.h_cur.begin() + width, NONE);
+
+  // Only needed where a pattern character is, so it's worked out there
+  auto bonus = [&](size_t j) {
+    return bonus_for(first + j > 0 ? class_of(text[first + j - 1]) : WHITE, class_of(text[first + j]));
+  };
+
+  int* h_prev = s.h_prev.data();
+  int* h_cur = s.h_cur.data();
+  int* chunk_prev = s.chunk_prev.data(); // Bonus of the first character in the run ending here
+  int* chunk_cur = s.chunk_cur.data();
+
+  for(i = 0; i < m; i++) {
+    size_t from = s.from[i] - first, to = s.to[i] - first;
+
+    if(i == 0) {
+      for(j = from; j <= to; j++) {
+        if(!eq(text[first + j], chars[0])) continue;
+        int b = bonus(j);
+        h_cur[j] = SCORE_MATCH + b * FIRST_CHAR_MULTIPLIER;
+        chunk_cur[j] = b;
+      }
+    } else {
+      size_t prev_from = s.from[i - 1] - first, prev_to = s.to[i - 1] - first;
+      int gap_best = NONE; // Best score ending at least two characters back, with the gap penalty in it
+
+      for(j = prev_from + 1; j <= to; j++) {
+        if(j >= 2) gap_best = std::max(gap_best + GAP_EXTENSION, h_prev[j - 2] + GAP_START);
+        if(j < from || !eq(text[first + j], chars[i])) continue;
+
+        int here = bonus(j);
+        int score = NONE, chunk = 0;
+        if(h_prev[j - 1] > NONE) { // Right after the previous character
+          chunk = chunk_prev[j - 1];
+          int b = here;
+          if(b >= BONUS_BOUNDARY && b > chunk) chunk = b; // A new word starts here, so a new run does too
+          else b = std::max({b, chunk, BONUS_CONSECUTIVE});
+          score = h_prev[j - 1] + SCORE_MATCH + b;
+        }
+        if(gap_best > NONE && gap_best + SCORE_MATCH + here > score) { // After a gap
+          score = gap_best + SCORE_MATCH + here;
+          chunk = here;
+        }
+        h_cur[j] = score;
+        chunk_cur[j] = chunk;
+      }
+
+      // Back to empty, since it's the row after next one
+      std::fill(h_prev + prev_from, h_prev + prev_to + 1, NONE);
+    }
+    std::swap(h_prev, h_cur);
+    std::swap(chunk_prev, chunk_cur);
+  }
+
+  int best = NONE;
+  for(j = s.from[m - 1] - first; j <= s.to[m - 1] - first; j++) best = std::max(best, h_prev[j]);
+  return std::max(0, best);
+}
+
+#pragma endregion
+
+#pragma region Matching
+
+// Appends the indices in [begin, end) whose character bitmap has everything the pattern needs.
+// Done a few candidates at a time with SIMD, since it's most of the work for a pattern that rejects most of them
+static void prefilter_scalar(const uint64_t* lo, const uint64_t* hi, size_t begin, size_t end,
+                             uint64_t need_lo, uint64_t need_hi, std::vector<uint32_t>& out) {
+  for(size_t i = begin; i < end; i++) {
+    if((need_lo & ~lo[i]) == 0 && (need_hi & ~hi[i]) == 0) out.push_back(static_cast<uint32_t>(i));
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static void prefilter_avx2(const uint64_t* lo, const uint64_t* hi, size_t begin, size_t end,
+                           uint64_t need_lo, uint64_t need_hi, std::vector<uint32_t>& out) {
+  const __m256i nlo = _mm256_set1_epi64x(static_cast<long long>(need_lo));
+  const __m256i nhi = _mm256_set1_epi64x(static_cast<long long>(need_hi));
+  const __m256i zero = _mm256_setzero_si256();
+
+  size_t i = begin;
+  for(; i + 4 <= end; i += 4) {
+    __m256i missing = _mm256_or_si256(
+      _mm256_andnot_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i)), nlo),
+      _mm256_andnot_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + i)), nhi));
+    int ok = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(missing, zero)));
+    while(ok) {
+      out.push_back(static_cast<uint32_t>(i + __builtin_ctz(ok)));
+      ok &= ok - 1;
+    }
+  }
+  prefilter_scalar(lo, hi, i, end, need_lo, need_hi, out);
+}
+
+static void prefilter_sse2(const uint64_t* lo, const uint64_t* hi, size_t begin, size_t end,
+                           uint64_t need_lo, uint64_t need_hi, std::vector<uint32_t>& out) {
+  const __m128i nlo = _mm_set1_epi64x(static_cast<long long>(need_lo));
+  const __m128i nhi = _mm_set1_epi64x(static_cast<long long>(need_hi));
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t i = begin;
+  for(; i + 2 <= end; i += 2) {
+    __m128i missing = _mm_or_si128(
+      _mm_andnot_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i)), nlo),
+      _mm_andnot_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i)), nhi));
+    // No 64 bit compare in SSE2, so a lane is clear when all 8 of its bytes compare equal to zero
+    int bytes = _mm_movemask_epi8(_mm_cmpeq_epi32(missing, zero));
+    if((bytes & 0xFF) == 0xFF) out.push_back(static_cast<uint32_t>(i));
+    if((bytes >> 8) == 0xFF) out.push_back(static_cast<uint32_t>(i + 1));
+  }
+  prefilter_scalar(lo, hi, i, end, need_lo, need_hi, out);
+}
+#endif
+
+static void prefilter(const uint64_t* lo, const uint64_t* hi, size_t begin, size_t end,
+                      uint64_t need_lo, uint64_t need_hi, std::vector<uint32_t>& out) {
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if(has_avx2) prefilter_avx2(lo, hi, begin, end, need_lo, need_hi, out);
+  else prefilter_sse2(lo, hi, begin, end, need_lo, need_hi, out);
+#else
+  prefilter_scalar(lo, hi, begin, end, need_lo, need_hi, out);
+#endif
+}
+
+// Results are sorted as plain integers: score, then length, then index, packed so that smaller is better
+static uint64_t sort_key(const fuzzy::Candidates& candidates, uint32_t index, int score, fuzzy::Tiebreak tiebreak) {
+  uint64_t s = 0xFFFF - static_cast<uint64_t>(std::min(score, 0xFFFF));
+  uint64_t length = tiebreak == fuzzy::Tiebreak::LENGTH ? std::min<uint64_t>(candidates.at(index).size(), 0xFFFF) : 0;
+  return s << 48 | length << 32 | index;
+}
+
+// Runs work(keys, begin, end) over [0, count) split into one part per thread, then merges the sorted parts
+template <typename Work>
+static std::vector<fuzzy::Match> in_parallel(size_t count, Work work) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t parts_count = std::max<size_t>(1, std::min<size_t>(threads, count / MIN_CHUNK));
+
+  std::vector<std::vector<uint64_t>> parts(parts_count);
+  std::vector<std::thread> pool;
+  for(size_t p = 1; p < parts_count; p++) {
+    pool.emplace_back([&, p]() {
+      work(parts[p], count * p / parts_count, count * (p + 1) / parts_count);
+      std::sort(parts[p].begin(), parts[p].end());
+    });
+  }
+  work(parts[0], 0, count / parts_count);
+  std::sort(parts[0].begin(), parts[0].end());
+  for(auto& t : pool) t.join();
+
+  std::vector<uint64_t> keys = std::move(parts[0]);
+  for(size_t p = 1; p < parts_count; p++) {
+    size_t middle = keys.size();
+    keys.insert(keys.end(), parts[p].begin(), parts[p].end());
+    std::inplace_merge(keys.begin(), keys.begin() + middle, keys.end());
+  }
+
+  std::vector<fuzzy::Match> result(keys.size());
+  for(size_t i = 0; i < keys.size(); i++) {
+    result[i] = {static_cast<uint32_t>(keys[i]), 0xFFFF - static_cast<int>(keys[i] >> 48)};
+  }
+  return result;
+}
+
+std::vector<fuzzy::Match> fuzzy::match(const Pattern& pattern, const Candidates& candidates, Tiebreak tiebreak, size_t begin, size_t end) {
+  end = std::min(end, candidates.size());
+  if(begin >= end) return {};
+
+  return in_parallel(end - begin, [&](std::vector<uint64_t>& keys, size_t from, size_t to) {
+    std::vector<uint32_t> survivors;
+    prefilter(candidates.lo(), candidates.hi(), begin + from, begin + to, pattern.mask_lo(), pattern.mask_hi(), survivors);
+    for(uint32_t index : survivors) {
+      int score = pattern.score(candidates.at(index));
+      if(score >= 0) keys.push_back(sort_key(candidates, index, score, tiebreak));
+    }
+  });
+}
+
+std::vector<fuzzy::Match> fuzzy::match(const Pattern& pattern, const Candidates& candidates, const std::vector<Match>& subset, Tiebreak tiebreak) {
+  return in_parallel(subset.size(), [&](std::vector<uint64_t>& keys, size_t from, size_t to) {
+    for(size_t i = from; i < to; i++) {
+      uint32_t index = subset[i].index;
+      if(!pattern.may_match(candidates.lo()[index], candidates.hi()[index])) continue;
+      int score = pattern.score(candidates.at(index));
+      if(score >= 0) keys.push_back(sort_key(candidates, index, score, tiebreak));
+    }
+  });
+}
+
+void fuzzy::merge(std::vector<Match>& into, std::vector<Match>&& more, const Candidates& candidates, Tiebreak tiebreak) {
+  size_t middle = into.size();
+  into.insert(into.end(), more.begin(), more.end());
+  std::inplace_merge(into.begin(), into.begin() + middle, into.end(), [&](const Match& a, const Match& b) {
+    return sort_key(candidates, a.index, a.score, tiebreak) < sort_key(candidates, b.index, b.score, tiebreak);
+  });
+}
+
+#pragma endregion
@@ -0,0 +1,75 @@
+#ifndef SLASH_FUZZY_H
+#define SLASH_FUZZY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fuzzy {
+  struct Match {
+    uint32_t index; // Into the Candidates
+    int score;
+  };
+
+  // The strings to match against, packed together. Each one also gets a bitmap of the (lowercased)
+  // characters in it, so most of the ones that can't match are thrown out without looking at the text
+  class Candidates {
+    private:
+    std::string arena;
+    std::vector<uint32_t> offsets = {0};
+    std::vector<uint64_t> masks_lo; // Bits for bytes 0-63
+    std::vector<uint64_t> masks_hi; // Bits for bytes 64-127, bit 63 for anything non-ASCII
+
+    public:
+    void add(std::string_view text);
+    void clear();
+    size_t size() const { return offsets.size() - 1; }
+    std::string_view at(size_t i) const { return std::string_view(arena).substr(offsets[i], offsets[i + 1] - offsets[i]); }
+    const uint64_t* lo() const { return masks_lo.data(); }
+    const uint64_t* hi() const { return masks_hi.data(); }
+  };
+
+  // A query, matched as a subsequence the way fzf does it: case-insensitive unless it has uppercase in it,
+  // with bonuses for characters at word boundaries and runs of consecutive characters and penalties for gaps
+  class Pattern {
+    private:
+    std::string chars; // Lowercased unless case_sensitive
+    bool case_sensitive = false;
+    uint64_t need_lo = 0;
+    uint64_t need_hi = 0;
+
+    int score_greedy(std::string_view text, size_t first, size_t last) const;
+
+    public:
+    explicit Pattern(std::string_view query);
+
+    bool empty() const { return chars.empty(); }
+    uint64_t mask_lo() const { return need_lo; }
+    uint64_t mask_hi() const { return need_hi; }
+    bool may_match(uint64_t lo, uint64_t hi) const { return (need_lo & ~lo) == 0 && (need_hi & ~hi) == 0; }
+
+    int score(std::string_view text) const; // -1 if it doesn't match, 0 for everything if the pattern is empty
+
+    // True if everything this matches is also matched by previous, so previous' results only need narrowing down
+    bool narrows(const Pattern& previous) const;
+  };
+
+  // What decides between equal scores. Either way whichever was added first wins in the end,
+  // so adding the newest first ranks by recency
+  enum class Tiebreak { LENGTH, INDEX };
+
+  // Scores the candidates in [begin, end) on a pool of threads, best first
+  std::vector<Match> match(const Pattern& pattern, const Candidates& candidates, Tiebreak tiebreak = Tiebreak::LENGTH,
+                           size_t begin = 0, size_t end = SIZE_MAX);
+
+  // Same, but only for the candidates in subset, typically the results of a pattern this one narrows
+  std::vector<Match> match(const Pattern& pattern, const Candidates& candidates, const std::vector<Match>& subset,
+                           Tiebreak tiebreak = Tiebreak::LENGTH);
+
+  // Merges two sorted results into one, for candidates added after the first was matched
+  void merge(std::vector<Match>& into, std::vector<Match>&& more, const Candidates& candidates, Tiebreak tiebreak = Tiebreak::LENGTH);
+}
+
+#endif // SLASH_FUZZY_H
@@ -2,6 +2,7 @@
 #include <math.h>
 #include "iofuncs.h"
 #include "info.h"
+#include "filestream.h"
 #include <unistd.h>
 #include <cstring>
 #include <variant>
@@ -79,21 +80,14 @@ std::string io::center(std::string text, int width) {
 }
 
 std::variant<std::string, int> io::read_file(std::string filepath) {
-  int fd = open(filepath.c_str(), O_RDONLY);
-  if(fd == -1) {
-    return errno;
-  }
-
-  char buffer[100'000];
-  ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
-  if(bytesRead < 0) {
-    return errno;
+  // Whole file, however big, instead of the first 100 KB. Use io::FileView to avoid the copy
+  io::FileView file(filepath);
+  if(!file.ok()) {
+    errno = file.error();
+    return file.error();
   }
 
-  buffer[bytesRead] = '\0';
-  std::string content = buffer;
-  close(fd);
-  return content;
+  return std::string(file.view());
 }
 
 int io::write_to_file(std::string filepath, std::string content) {
@@ -4,6 +4,13 @@
 
 #include <string>
 #include <cstring> // for strerror
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
 
 #include "json.hpp"
 
@@ -93,3 +100,129 @@ std::optional<std::array<int, 3>> get_int_array3(const nlohmann::json& json, con
 
     return result;
 }
+
+#pragma region cache
+
+struct CachedJson {
+    nlohmann::json json;
+    std::string dir;
+    std::string filename;
+    int wd = -1;
+    std::atomic<bool> stale{true};
+
+    // Only used when there is no inotify watch on the directory
+    ino_t inode = 0;
+    struct timespec mtime{};
+    off_t size = -1;
+};
+
+static std::unordered_map<std::string, std::unique_ptr<CachedJson>> json_cache;
+static std::mutex json_cache_mutex;
+static int inotify_fd = -2; // -2: not initialized yet, -1: inotify is unavailable
+static std::atomic<unsigned long> json_cache_generation{0};
+
+static void watch_json_files() {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while (true) {
+        ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(json_cache_mutex);
+        for (char* ptr = buffer; ptr < buffer + len; ) {
+            auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            for (auto& [path, entry] : json_cache) {
+                if (event->mask & IN_Q_OVERFLOW) {
+                    entry->stale = true;
+                    continue;
+                }
+                if (entry->wd != event->wd) continue;
+
+                // The directory itself is gone, the watch has to be added again once it's back
+                if (event->mask & IN_IGNORED) {
+                    entry->wd = -1;
+                    entry->stale = true;
+                } else if (event->len > 0 && entry->filename == event->name) {
+                    entry->stale = true;
+                }
+            }
+        }
+    }
+}
+
+static void init_inotify() {
+    inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        inotify_fd = -1;
+        return;
+    }
+
+    std::thread(watch_json_files).detach();
+}
+
+// Returns true if the file on disk differs from what was last parsed
+static bool changed_on_disk(CachedJson& entry, const std::string& path) {
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0) {
+        bool changed = entry.size != -1;
+        entry.size = -1;
+        return changed;
+    }
+
+    bool changed = st.st_ino != entry.inode || st.st_size != entry.size ||
+                   st.st_mtim.tv_sec != entry.mtime.tv_sec || st.st_mtim.tv_nsec != entry.mtime.tv_nsec;
+
+    entry.inode = st.st_ino;
+    entry.size = st.st_size;
+    entry.mtime = st.st_mtim;
+    return changed;
+}
+
+const nlohmann::json& get_cached_json(const std::string& path) {
+    std::lock_guard<std::mutex> lock(json_cache_mutex);
+    if (inotify_fd == -2) init_inotify();
+
+    auto& entry = json_cache[path];
+    if (!entry) {
+        entry = std::make_unique<CachedJson>();
+        size_t slash = path.find_last_of('/');
+        entry->dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        entry->filename = slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    // Watch the directory rather than the file, since editors usually save by renaming a new file over the old one
+    // Without a watch (e.g. the directory doesn't exist yet) the mtime check below decides instead
+    if (entry->wd < 0 && inotify_fd >= 0) {
+        entry->wd = inotify_add_watch(inotify_fd, entry->dir.c_str(),
+                                      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM);
+        if (entry->wd >= 0) entry->stale = true;
+    }
+
+    bool needs_reload = entry->stale.exchange(false);
+    if (entry->wd < 0 && changed_on_disk(*entry, path)) needs_reload = true;
+
+    if (needs_reload) {
+        entry->json = get_json(path);
+        ++json_cache_generation;
+    }
+    return entry->json;
+}
+
+unsigned long get_json_cache_generation() {
+    return json_cache_generation;
+}
+
+void invalidate_json_cache() {
+    std::lock_guard<std::mutex> lock(json_cache_mutex);
+    for (auto& [path, entry] : json_cache) {
+        entry->stale = true;
+        entry->size = -1;
+    }
+}
+
+#pragma endregion
@@ -8,6 +8,12 @@
 
 nlohmann::json get_json(const std::string& path);
 
+// Parses the file once and keeps it for the lifetime of the process.
+// The file is only re-read when it changes on disk (inotify, or a stat check when inotify is unavailable)
+const nlohmann::json& get_cached_json(const std::string& path);
+void invalidate_json_cache(); // Forces every cached file to be re-read on next access, used by reload
+unsigned long get_json_cache_generation(); // Bumped every time a cached file is re-parsed, for callers that derive state from it
+
 std::optional<bool> get_bool(const nlohmann::json& json, const std::string& property, const std::string& object = "");
 std::optional<std::string> get_string(const nlohmann::json& json, const std::string& property, const std::string& object = "");
 std::optional<int> get_int(const nlohmann::json& json, const std::string& property, const std::string& object);
@@ -0,0 +1,237 @@
+#include "walker.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#pragma region Entry
+
+unsigned char walk::Entry::type() {
+  if(d_type != DT_UNKNOWN) return d_type;
+
+  const struct stat* s = stat();
+  if(s == nullptr) return DT_UNKNOWN;
+  if(S_ISREG(s->st_mode)) d_type = DT_REG;
+  else if(S_ISDIR(s->st_mode)) d_type = DT_DIR;
+  else if(S_ISLNK(s->st_mode)) d_type = DT_LNK;
+  else if(S_ISFIFO(s->st_mode)) d_type = DT_FIFO;
+  else if(S_ISSOCK(s->st_mode)) d_type = DT_SOCK;
+  else if(S_ISCHR(s->st_mode)) d_type = DT_CHR;
+  else if(S_ISBLK(s->st_mode)) d_type = DT_BLK;
+  return d_type;
+}
+
+const struct stat* walk::Entry::stat() {
+  if(!stat_done) {
+    stat_done = true;
+    std::string n(name);
+    if(fstatat(dir_fd, n.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) stat_err = errno;
+  }
+  return stat_err == 0 ? &st : nullptr;
+}
+
+std::string walk::Entry::path() const {
+  std::string p;
+  p.reserve(dir.size() + name.size() + 1);
+  p += dir;
+  if(!dir.ends_with('/')) p += '/';
+  p += name;
+  return p;
+}
+
+#pragma endregion
+
+#pragma region ResultQueue
+
+walk::ResultQueue::~ResultQueue() {
+  Node* node = head.load();
+  while(node) {
+    Node* next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+void walk::ResultQueue::push(std::string&& batch) {
+  Node* node = new Node{std::move(batch), head.load(std::memory_order_relaxed)};
+  while(!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+std::vector<std::string> walk::ResultQueue::take_all() {
+  Node* node = head.exchange(nullptr, std::memory_order_acquire);
+
+  std::vector<std::string> batches;
+  while(node) { // Newest first, reversed below
+    batches.push_back(std::move(node->data));
+    Node* next = node->next;
+    delete node;
+    node = next;
+  }
+  std::reverse(batches.begin(), batches.end());
+  return batches;
+}
+
+#pragma endregion
+
+#pragma region walker
+
+struct DirTask {
+  std::string path;
+  size_t depth;
+  void* data;
+};
+
+struct WorkerQueue {
+  std::mutex mutex;
+  std::deque<DirTask> tasks;
+};
+
+class Walk {
+  private:
+  const walk::Options& options;
+  std::vector<WorkerQueue> queues;
+  std::atomic<size_t> pending{0}; // Directories queued or being read, the walk is over when it drops to 0
+  std::mutex idle_mutex;
+  std::condition_variable idle_cv;
+  std::atomic<unsigned> sleeping{0};
+
+  void push(unsigned worker, DirTask&& task) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard lock(queues[worker].mutex);
+      queues[worker].tasks.push_back(std::move(task));
+    }
+    if(sleeping.load(std::memory_order_relaxed) > 0) idle_cv.notify_one();
+  }
+
+  bool pop(unsigned worker, DirTask& task) {
+    { // Newest first from our own queue, so a worker mostly stays within one subtree
+      std::lock_guard lock(queues[worker].mutex);
+      if(!queues[worker].tasks.empty()) {
+        task = std::move(queues[worker].tasks.back());
+        queues[worker].tasks.pop_back();
+        return true;
+      }
+    }
+
+    // Oldest first from the others, those are the closest to the root and likely the biggest subtrees
+    for(size_t i = 1; i < queues.size(); i++) {
+      WorkerQueue& victim = queues[(worker + i) % queues.size()];
+      std::lock_guard lock(victim.mutex);
+      if(!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void read_dir(unsigned worker, const DirTask& task, char* buf, size_t buf_size) {
+    if(options.expand) {
+      std::vector<walk::Subdir> subdirs;
+      if(options.expand(task.path, task.data, subdirs)) {
+        for(auto& subdir : subdirs) push(worker, {std::move(subdir.path), task.depth + 1, subdir.data});
+        if(options.leave) options.leave(task.data);
+        return;
+      }
+    }
+
+    int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+    if(task.depth > 0) flags |= O_NOFOLLOW; // Only the root may be a symlink
+    int fd = open(task.path.c_str(), flags);
+    if(fd == -1) {
+      if(options.error) options.error(task.path, errno);
+      if(options.leave) options.leave(task.data);
+      return;
+    }
+
+    while(true) {
+      ssize_t n = getdents64(fd, buf, buf_size);
+      if(n == 0) break;
+      if(n < 0) {
+        if(errno == EINTR) continue;
+        if(options.error) options.error(task.path, errno);
+        break;
+      }
+
+      for(ssize_t offset = 0; offset < n;) {
+        auto* d = reinterpret_cast<struct dirent64*>(buf + offset);
+        offset += d->d_reclen;
+
+        std::string_view name = d->d_name;
+        if(name == "." || name == "..") continue;
+
+        walk::Entry entry(task.path, name, fd, d->d_ino, d->d_type, task.depth + 1, task.data);
+        bool descend = options.visit ? options.visit(entry, worker) : true;
+        if(descend && entry.type() == DT_DIR) push(worker, {entry.path(), task.depth + 1, entry.child_data});
+      }
+    }
+    close(fd);
+    if(options.leave) options.leave(task.data);
+  }
+
+  void run(unsigned worker) {
+    const size_t buf_size = 256 * 1024; // getdents batch, a few thousand entries per syscall
+    auto buf = std::make_unique<char[]>(buf_size);
+
+    DirTask task;
+    while(true) {
+      if(pop(worker, task)) {
+        read_dir(worker, task, buf.get(), buf_size);
+        if(pending.fetch_sub(1, std::memory_order_acq_rel) == 1) idle_cv.notify_all();
+        continue;
+      }
+      if(pending.load(std::memory_order_acquire) == 0) return;
+
+      // Nothing to steal right now. A push between the check and the wait can be missed, hence the timeout
+      std::unique_lock lock(idle_mutex);
+      sleeping.fetch_add(1, std::memory_order_relaxed);
+      idle_cv.wait_for(lock, std::chrono::milliseconds(1));
+      sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  public:
+  Walk(const walk::Options& options, unsigned threads) : options(options), queues(threads) {}
+
+  void start(const std::string& root, void* root_data) {
+    push(0, {root, 0, root_data});
+
+    std::vector<std::thread> workers;
+    for(unsigned i = 1; i < queues.size(); i++) workers.emplace_back(&Walk::run, this, i);
+    run(0);
+    for(auto& t : workers) t.join();
+  }
+};
+
+unsigned walk::thread_count(const Options& options) {
+  if(options.threads > 0) return options.threads;
+  unsigned cores = std::thread::hardware_concurrency();
+  return cores > 0 ? cores : 4;
+}
+
+int walk::parallel_walk(const std::string& root, const Options& options, void* root_data) {
+  struct stat st;
+  if(::stat(root.c_str(), &st) != 0) {
+    if(options.error) options.error(root, errno);
+    return -1;
+  }
+  if(!S_ISDIR(st.st_mode)) {
+    if(options.error) options.error(root, ENOTDIR);
+    return -1;
+  }
+
+  Walk walk(options, thread_count(options));
+  walk.start(root, root_data);
+  return 0;
+}
+
+#pragma endregion
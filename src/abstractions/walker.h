@@ -0,0 +1,89 @@
+#ifndef SLASH_WALKER_H
+#define SLASH_WALKER_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace walk {
+  // One directory entry, as seen by the visitor. Only valid during the visit call.
+  // Nothing beyond getdents is done for it unless type() has to fall back to lstat or stat() is called
+  class Entry {
+    private:
+    unsigned char d_type;
+    bool stat_done = false;
+    int stat_err = 0;
+    struct stat st;
+
+    public:
+    const std::string& dir; // Path of the containing directory, starting with the root as given
+    std::string_view name;
+    int dir_fd;             // Open fd of the containing directory, for *at() calls
+    ino_t ino;
+    size_t depth;           // 1 for entries directly inside the root
+    void* dir_data;         // Whatever the visitor attached to the containing directory
+    void* child_data = nullptr; // Set by the visitor to attach something to this directory, handed back in dir_data and leave
+
+    Entry(const std::string& dir, std::string_view name, int dir_fd, ino_t ino, unsigned char d_type, size_t depth, void* dir_data)
+      : d_type(d_type), dir(dir), name(name), dir_fd(dir_fd), ino(ino), depth(depth), dir_data(dir_data) {}
+
+    unsigned char type();        // DT_*, from getdents or from lstat when the filesystem doesn't report it
+    const struct stat* stat();   // lstat relative to dir_fd, done once; nullptr if it failed (see stat_error)
+    int stat_error() const { return stat_err; }
+    std::string path() const;
+  };
+
+  struct Subdir {
+    std::string path;
+    void* data;
+  };
+
+  struct Options {
+    unsigned threads = 0; // 0 for one per core
+    // Called from the worker threads, so it must be thread-safe. Returning false doesn't descend into a directory
+    std::function<bool(Entry& entry, unsigned worker)> visit;
+    std::function<void(const std::string& path, int err)> error; // Directories that couldn't be read
+    // Called once a directory has been read (or failed to open), with the data attached to it.
+    // Its subdirectories may still be queued or being read by then
+    std::function<void(void* data)> leave;
+    // Called before a directory is read. Returning true skips reading it and walks the subdirectories
+    // filled in instead, for callers that already know what's in it (leave is still called)
+    std::function<bool(const std::string& path, void* data, std::vector<Subdir>& subdirs)> expand;
+  };
+
+  unsigned thread_count(const Options& options);
+
+  // Walks everything under root with a pool of workers. Each worker keeps a deque of directories,
+  // works depth-first from its own end and steals from the other end of someone else's when it runs dry.
+  // Symlinks are never followed, except for the root itself. Returns -1 if the root can't be opened
+  int parallel_walk(const std::string& root, const Options& options, void* root_data = nullptr);
+
+  // Lock-free multi-producer queue of output batches. Workers push whole batches of text,
+  // a single consumer takes everything that's there in one go
+  class ResultQueue {
+    private:
+    struct Node {
+      std::string data;
+      Node* next;
+    };
+    std::atomic<Node*> head{nullptr};
+
+    public:
+    ResultQueue() = default;
+    ResultQueue(const ResultQueue&) = delete;
+    ResultQueue& operator=(const ResultQueue&) = delete;
+    ~ResultQueue();
+
+    void push(std::string&& batch);
+    std::vector<std::string> take_all(); // Oldest first
+    bool empty() const { return head.load(std::memory_order_acquire) == nullptr; }
+  };
+}
+
+#endif // SLASH_WALKER_H
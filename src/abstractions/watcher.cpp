@@ -0,0 +1,40 @@
+#include "watcher.h"
+
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+
+io::Watcher::Watcher() {
+  fd = inotify_init1(IN_CLOEXEC);
+  if(fd < 0) err = errno;
+}
+
+io::Watcher::~Watcher() {
+  if(fd >= 0) close(fd);
+}
+
+int io::Watcher::add(const std::string& path, uint32_t mask) {
+  return inotify_add_watch(fd, path.c_str(), mask);
+}
+
+void io::Watcher::remove(int wd) {
+  inotify_rm_watch(fd, wd);
+}
+
+int io::Watcher::wait(int timeout_ms, const std::function<void(const WatchEvent&)>& on_event) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  int ready = poll(&pfd, 1, timeout_ms);
+  if(ready <= 0) return ready < 0 && errno != EINTR ? -1 : 0;
+
+  char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t len = read(fd, buffer, sizeof(buffer));
+  if(len < 0) return errno == EINTR || errno == EAGAIN ? 0 : -1;
+
+  int count = 0;
+  for(char* ptr = buffer; ptr < buffer + len; count++) {
+    auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+    ptr += sizeof(struct inotify_event) + event->len;
+    on_event({event->wd, event->mask, event->len ? std::string_view(event->name) : std::string_view()});
+  }
+  return count;
+}
@@ -0,0 +1,42 @@
+#ifndef SLASH_WATCHER_H
+#define SLASH_WATCHER_H
+
+#include <sys/inotify.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace io {
+  struct WatchEvent {
+    int wd;                // What add() returned for the watched path
+    uint32_t mask;         // IN_* flags
+    std::string_view name; // Entry inside a watched directory, empty for the watched path itself
+  };
+
+  // Thin wrapper around an inotify instance
+  class Watcher {
+    private:
+    int fd = -1;
+    int err = 0;
+
+    public:
+    Watcher();
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+    ~Watcher();
+
+    bool ok() const { return fd >= 0; }
+    int error() const { return err; }
+
+    int add(const std::string& path, uint32_t mask); // Watch descriptor, -1 with errno set on failure
+    void remove(int wd);
+
+    // Waits up to timeout_ms (-1 for forever) and hands every event that arrived to on_event.
+    // Returns the number of events, 0 on timeout and -1 on error with errno set
+    int wait(int timeout_ms, const std::function<void(const WatchEvent&)>& on_event);
+  };
+}
+
+#endif // SLASH_WATCHER_H
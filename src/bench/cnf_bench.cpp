@@ -0,0 +1,86 @@
+// Micro-benchmark for "command not found" suggestions: fills a temporary $PATH directory with 10k
+// executables and times suggest_commands() for misspelled and unknown names. Exits with 1 if the
+// mean lookup takes a millisecond or more. Built by the optional cnf_bench target:
+//
+//   cmake -S . -B build -DSLASH_BENCHMARKS=ON && cmake --build build --target cnf_bench && ./build/cnf_bench
+
+#include "../core/cnf.h"
+#include "../core/command_table.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+const size_t COMMANDS = 10000;
+const size_t QUERIES = 2000;
+
+int main() {
+  char dir_template[] = "/tmp/slash-cnf-bench-XXXXXX";
+  if(!mkdtemp(dir_template)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string dir = dir_template;
+
+  std::mt19937 rng(42);
+  auto random_name = [&]() {
+    std::string name;
+    size_t len = 3 + rng() % 12;
+    for(size_t i = 0; i < len; i++) name += (i > 0 && rng() % 8 == 0) ? '-' : static_cast<char>('a' + rng() % 26);
+    return name;
+  };
+
+  std::vector<std::string> names;
+  while(names.size() < COMMANDS) {
+    std::string name = random_name();
+    int fd = open((dir + "/" + name).c_str(), O_WRONLY | O_CREAT | O_EXCL, 0755);
+    if(fd == -1) continue; // Already made
+    close(fd);
+    names.push_back(name);
+  }
+  setenv("PATH", dir.c_str(), 1);
+
+  // Half are one or two typos away from a real command, half are made up
+  std::vector<std::string> queries;
+  for(size_t i = 0; i < QUERIES; i++) {
+    if(i % 2) {
+      queries.push_back(random_name());
+      continue;
+    }
+    std::string query = names[rng() % names.size()];
+    for(int edits = 1 + rng() % 2; edits > 0; edits--) query[rng() % query.size()] = 'a' + rng() % 26;
+    queries.push_back(query);
+  }
+
+  using clock = std::chrono::steady_clock;
+  auto first_start = clock::now();
+  size_t found = suggest_commands(queries[0], 3).size(); // Reads the directory and builds the index
+  double first = std::chrono::duration<double, std::micro>(clock::now() - first_start).count();
+
+  std::vector<double> times;
+  for(auto& query : queries) {
+    auto start = clock::now();
+    found += suggest_commands(query, 3).size();
+    times.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+  }
+
+  std::sort(times.begin(), times.end());
+  double mean = 0;
+  for(double t : times) mean += t;
+  mean /= times.size();
+
+  printf("%zu commands in $PATH, %zu lookups, %zu suggestions\n", CommandTable::names().size(), times.size(), found);
+  printf("first (reads $PATH and indexes): %.1f us\n", first);
+  printf("mean %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n",
+         mean, times[times.size() / 2], times[times.size() * 99 / 100], times.back());
+
+  std::filesystem::remove_all(dir);
+  return mean < 1000 ? 0 : 1;
+}
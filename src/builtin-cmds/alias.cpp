@@ -6,6 +6,7 @@
 #include "../help_helper.h"
 
 #include <unistd.h>
+#include <sys/stat.h>
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -100,21 +101,38 @@ void create_alias(const std::string& name, const std::string& value) {
   io::overwrite_file(aliases_path, io::join(aliases, "\n"));
 }
 
-std::string get_alias(std::string name, bool print) {
-  std::string home = getenv("HOME");
-  std::string aliases_path = home + "/.slash/.slash_aliases";
+// The saved aliases, read again only when the file changes since get_alias() runs on every keystroke
+// for highlighting. A missing file just means there are none
+static const std::vector<std::string>& saved_aliases() {
+  static std::vector<std::string> aliases;
+  static struct stat last{};
+
+  std::string aliases_path = std::string(getenv("HOME")) + "/.slash/.slash_aliases";
+  struct stat st{};
+  if(stat(aliases_path.c_str(), &st) != 0) {
+    aliases.clear();
+    last = {};
+    return aliases;
+  }
+  if(st.st_ino == last.st_ino && st.st_size == last.st_size && st.st_mtim.tv_sec == last.st_mtim.tv_sec
+    && st.st_mtim.tv_nsec == last.st_mtim.tv_nsec) return aliases;
 
+  last = st;
   auto content = io::read_file(aliases_path);
   if(!std::holds_alternative<std::string>(content)) {
-    std::string error = std::string("Failed to read \"" + aliases_path + "\": ") + strerror(errno);
-    info::error(error, errno);
-    return "UNKNOWN";
+    aliases.clear();
+    return aliases;
   }
 
-  std::vector<std::string> aliases = io::split(std::get<std::string>(content), "\n");
+  aliases = io::split(std::get<std::string>(content), "\n");
   aliases.erase(std::remove_if(aliases.begin(), aliases.end(), [](std::string& a){
     return a == "\n" || a.starts_with("//");
   }), aliases.end());
+  return aliases;
+}
+
+std::string get_alias(std::string name, bool print) {
+  const std::vector<std::string>& aliases = saved_aliases();
 
   for(auto& a : temp_aliases) {
     if(a.alias == name) {
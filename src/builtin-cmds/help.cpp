@@ -124,6 +124,7 @@ int help_keys() {
   ss << yellow << "  • Ctrl+K: " << reset << " Clear all content after the cursor\n";
   ss << yellow << "  • Ctrl+W: " << reset << " Clear the word cursor is on\n";
   ss << yellow << "  • Ctrl+L: " << reset << " Clear screen easily without clearing scrollback buffer\n";
+  ss << yellow << "  • Ctrl+R: " << reset << " Search history as you type. Ctrl+R again for older matches, Enter to run\n";
   ss << yellow << "  • Alt+X:  " << reset << " Convert entire input to lowercase\n";
   ss << yellow << "  • Alt+C:  " << reset << " Convert entire input to uppercase\n\n";
 
@@ -57,6 +57,16 @@ void create_temp_var(std::string name, std::string value) {
   temp_vars.push_back({name, value});
 }
 
+void set_temp_var(std::string name, std::string value) {
+  for(auto& v : temp_vars) {
+    if(v.name == name) {
+      v.value = value;
+      return;
+    }
+  }
+  create_temp_var(name, value);
+}
+
 void create_variable(std::string name, std::string value) {
   if(name.find(" ") != std::string::npos) {
     info::error("Variable cannot contain spaces!");
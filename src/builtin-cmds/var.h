@@ -15,6 +15,7 @@ extern std::vector<Variable> temp_vars;
 void list_variables();
 
 void create_temp_var(std::string name, std::string value);
+void set_temp_var(std::string name, std::string value); // Overwrites the variable if it already exists
 void create_variable(std::string name, std::string value);
 
 std::variant<std::string, int> get_value(std::string name);
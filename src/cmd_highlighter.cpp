@@ -1,57 +1,9 @@
 #include "cmd_highlighter.h"
-#include <boost/regex.hpp>
 #include "abstractions/definitions.h"
 #include "abstractions/json.h"
 
-std::string highlight(const std::string& input,
-                      const std::vector<std::pair<boost::regex, std::string>>& patterns) {
-  std::string result;
-  size_t pos = 0;
-  size_t len = input.size();
-
-  // We'll find all matches of all patterns and sort them by position to colorize properly
-  struct Match {
-    size_t start;
-    size_t end;
-    std::string color;
-  };
-
-  std::vector<Match> matches;
-
-  for (auto& [pattern, color] : patterns) {
-    boost::sregex_iterator it(input.begin(), input.end(), pattern);
-    boost::sregex_iterator end;
-    while (it != end) {
-      auto m = *it;
-      matches.push_back({(size_t)m.position(), (size_t)m.position() + m.length(), color});
-      ++it;
-    }
-  }
-
-  // Sort matches by start position
-  std::sort(matches.begin(), matches.end(),
-            [](const Match& a, const Match& b) { return a.start < b.start; });
-
-  size_t last_end = 0;
-  for (const auto& m : matches) {
-    // Skip overlaps
-    if (m.start < last_end) continue;
-
-    // Append text before match
-    if (m.start > last_end)
-      result.append(input.substr(last_end, m.start - last_end));
-
-    // Append colored match
-    result.append(m.color + input.substr(m.start, m.end - m.start) + "\033[0m");
-    last_end = m.end;
-  }
-
-  // Append any remaining text
-  if (last_end < len)
-    result.append(input.substr(last_end));
-
-  return result;
-}
+#include <sstream>
+#include <vector>
 
 std::string rgb_to_ansi_2(std::array<int, 3> rgb, bool bg = false) {
   int r = rgb[0], g = rgb[1], b = rgb[2];
@@ -62,7 +14,7 @@ std::string rgb_to_ansi_2(std::array<int, 3> rgb, bool bg = false) {
   return res.str();
 }
 
-std::string get_ansi(nlohmann::json& j, std::string elm) {
+std::string get_ansi(const nlohmann::json& j, std::string elm) {
   if(!j.contains(elm)) return "";
 
   std::stringstream ss;
@@ -78,57 +30,226 @@ std::string get_ansi(nlohmann::json& j, std::string elm) {
 
 std::string get_syntax_highlighting_theme_path() {
   std::string home = getenv("HOME");
-  auto j = get_json(home + "/.slash/config/settings.json");
+  const auto& j = get_cached_json(home + "/.slash/config/settings.json");
   if(j.empty()) return home + "/.slash/config/syntax-highlighting-themes/default.json";
 
   return get_string(j, "pathOfSyntaxHighlightingTheme").value_or(home + "/.slash/config/syntax-highlighting-themes/default.json");
 }
 
+#pragma region theme
+
+// Colors of the current theme, rebuilt only when the theme file changes
+struct HighlightTheme {
+  std::string path;
+  unsigned long generation = 0;
+  bool compiled = false;
+
+  std::string cmd, unknown_cmd, number, flag, path_color, comment, quote, quote_pref, link, subcommand, exec_flags, op, var;
+};
+
+const HighlightTheme& get_theme() {
+  static HighlightTheme theme;
+
+  std::string path = get_syntax_highlighting_theme_path();
+  const auto& j = get_cached_json(path);
+  unsigned long generation = get_json_cache_generation();
+  if(theme.compiled && theme.path == path && theme.generation == generation) return theme;
+
+  theme.path = path;
+  theme.generation = generation;
+  theme.compiled = true;
+
+  theme.cmd         = get_ansi(j, "command");
+  theme.unknown_cmd = j.contains("unknown_command") ? get_ansi(j, "unknown_command") : red;
+  theme.number      = j.contains("numbers") ? get_ansi(j, "numbers") : get_ansi(j, "number");
+  theme.flag        = get_ansi(j, "flags");
+  theme.path_color  = get_ansi(j, "paths");
+  theme.comment     = get_ansi(j, "comments");
+  theme.quote       = get_ansi(j, "quotes");
+  theme.quote_pref  = get_ansi(j, "quotes_pref");
+  theme.link        = get_ansi(j, "links");
+  theme.subcommand  = get_ansi(j, "subcommand");
+  theme.exec_flags  = get_ansi(j, "exec_flags");
+  theme.op          = get_ansi(j, "operators");
+  theme.var         = get_ansi(j, "vars");
+
+  return theme;
+}
+
+#pragma endregion
+
+#pragma region lexer
+
+// A token of the last highlighted line. Tokens cover the whole line, whitespace included,
+// so the output can be cut at any token boundary and resumed from there
+struct Token {
+  size_t start;
+  size_t end;
+  bool command_next; // Whether the word after this token is in command position
+  size_t out_end;    // Length of the highlighted output up to the end of this token
+};
+
+static std::string last_input;
+static std::string last_output;
+static std::vector<Token> last_tokens;
+static unsigned long last_generation = 0;
+static std::string last_theme_path;
+static bool (*command_checker)(const std::string&) = nullptr;
+
+bool is_operator_char(char c) {
+  return c == '|' || c == '&' || c == '>' || c == '<';
+}
+
+bool is_word_end(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == ';' || c == '#' ||
+         c == '"' || c == '\'' || is_operator_char(c);
+}
+
+bool is_var_char(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+void append_colored(std::string& out, const std::string& color, const std::string& input, size_t start, size_t end) {
+  if(color.empty()) {
+    out.append(input, start, end - start);
+    return;
+  }
+  out += color;
+  out.append(input, start, end - start);
+  out += reset;
+}
+
+// Same word classes as the old regex patterns, decided once per word instead of per pattern
+const std::string& classify_word(const HighlightTheme& theme, const std::string& word, bool command_pos) {
+  static const std::string none;
+
+  if(command_pos) {
+    if(command_checker == nullptr || word.find('$') != std::string::npos || command_checker(word)) return theme.cmd;
+    return theme.unknown_cmd;
+  }
+  if(word == "@r" || word == "@t" || word == "@o" || word == "@O" || word == "@e") return theme.exec_flags;
+  if(word.size() > 1 && word[0] == '-') return theme.flag;
+
+  size_t scheme_end = word.find("://");
+  if(scheme_end != std::string::npos && scheme_end > 0 && isalpha(static_cast<unsigned char>(word[0])) && scheme_end + 3 < word.size()) {
+    return theme.link;
+  }
+
+  if(word[0] == '/' || word[0] == '~' || word == "." || word == ".." || word.starts_with("./") || word.starts_with("../")) {
+    return theme.path_color;
+  }
+
+  bool digits = true;
+  for(char c : word) if(!isdigit(static_cast<unsigned char>(c))) { digits = false; break; }
+  if(digits) return theme.number;
+
+  if(word[0] == '$') return none; // Coloured by the variable pass below
+  return theme.subcommand;
+}
+
+// Highlights a word, with $VARIABLES inside it getting the variable color
+void append_word(std::string& out, const HighlightTheme& theme, const std::string& input, size_t start, size_t end, const std::string& color) {
+  size_t i = start;
+  size_t plain_start = start;
+  while(i < end) {
+    if(input[i] == '$' && i + 1 < end && is_var_char(input[i + 1])) {
+      append_colored(out, color, input, plain_start, i);
+      size_t var_end = i + 1;
+      while(var_end < end && is_var_char(input[var_end])) var_end++;
+      append_colored(out, theme.var, input, i, var_end);
+      i = plain_start = var_end;
+      continue;
+    }
+    i++;
+  }
+  append_colored(out, color, input, plain_start, end);
+}
+
+// Lexes `input` from `pos`, which must be a token boundary, using the same splitting rules as parse_arguments:
+// words end at whitespace, quotes run to their matching unescaped quote, E"..." and @"..." are prefixed quotes,
+// and # outside of quotes starts a comment
+void lex_from(const HighlightTheme& theme, const std::string& input, size_t pos, bool command_pos) {
+  size_t n = input.size();
+
+  while(pos < n) {
+    char c = input[pos];
+    size_t start = pos;
+
+    if(c == ' ' || c == '\t') {
+      while(pos < n && (input[pos] == ' ' || input[pos] == '\t')) pos++;
+      last_output.append(input, start, pos - start);
+    } else if(c == '\n' || c == ';') {
+      pos++;
+      command_pos = true;
+      last_output += c;
+    } else if(c == '#') {
+      while(pos < n && input[pos] != '\n') pos++;
+      append_colored(last_output, theme.comment, input, start, pos);
+    } else if(is_operator_char(c)) {
+      char next = pos + 1 < n ? input[pos + 1] : '\0';
+      bool two_chars = (c == '>' && next == '>') || (c == '&' && next == '&') || (c == '|' && next == '|');
+      pos += two_chars ? 2 : 1;
+      if(c == '|' || c == '&') command_pos = true; // Redirections are followed by a file, not a command
+      append_colored(last_output, theme.op, input, start, pos);
+    } else if((c == 'E' || c == '@') && pos + 1 < n && input[pos + 1] == '"') {
+      pos++;
+      append_colored(last_output, theme.quote_pref, input, start, pos);
+    } else if(c == '"' || c == '\'') {
+      pos++;
+      while(pos < n && input[pos] != c) {
+        if(input[pos] == '\\' && pos + 1 < n) pos++;
+        pos++;
+      }
+      if(pos < n) pos++; // Closing quote, an unterminated quote runs to the end of the line
+      command_pos = false;
+      append_colored(last_output, theme.quote, input, start, pos);
+    } else {
+      while(pos < n && !is_word_end(input[pos])) pos++;
+      std::string word = input.substr(start, pos - start);
+      append_word(last_output, theme, input, start, pos, classify_word(theme, word, command_pos));
+      command_pos = false;
+    }
+
+    last_tokens.push_back({start, pos, command_pos, last_output.size()});
+  }
+}
+
+#pragma endregion
+
+void set_command_checker(bool (*is_known)(const std::string& command)) {
+  command_checker = is_known;
+  last_input.clear();
+  last_output.clear();
+  last_tokens.clear();
+}
+
 std::string highl(std::string prompt) {
-  auto j = get_json(get_syntax_highlighting_theme_path());
-
-  boost::regex quotes(R"((["'])(?:\\.|(?!\1).)*\1)");
-  boost::regex comments("\\#.*");
-  boost::regex operators(">>|&&|\\|\\||[|&>]");
-  boost::regex paths("(/[^\\s|&><#\"]+)|(\\.{1,2}(/[^\\s|&><#\"]*)*)|(~)");
-  boost::regex flags("-[A-Za-z0-9\\-_]+");
-  boost::regex numbers("[0-9]");
-  boost::regex quote_pref("(E|@)(?=\"[^\"]*\")");
-  // I know its lengthy but boost::regex doesnt support variable length lookbehinds. Atleast theres lookbehind support unlike std::regex
-  boost::regex cmds(R"((?:^|\s*(?<=&&)|\s*(?<=\|)|\s*(?<=;))\s*([^\s]+))"); 
-  boost::regex exec_flags(R"(@(r|t|o|O|e))");
-  boost::regex links(R"([a-zA-Z][a-zA-Z0-9+.-]*:\/\/[^\s/$.?#].[^\s]*)");
-  boost::regex subcommands(R"(\b[A-Za-z0-9\-_]+\b)");
-  boost::regex vars(R"(\$[A-Za-z0-9_]+)");
-
-  const std::string cmd_color         = get_ansi(j, "command");
-  const std::string number_color      = get_ansi(j, "numbers");
-  const std::string flag_color        = get_ansi(j, "flags");
-  const std::string path_color        = get_ansi(j, "paths");
-  const std::string comment_color     = get_ansi(j, "comments");
-  const std::string quote_color       = get_ansi(j, "quotes");
-  const std::string quote_pref_color  = get_ansi(j, "quotes_pref");
-  const std::string link_color        = get_ansi(j, "links");
-  const std::string subcommand_color  = get_ansi(j, "subcommand");
-  const std::string exec_flags_color  = get_ansi(j, "exec_flags");
-  const std::string operator_color    = get_ansi(j, "operators");
-  const std::string var_color         = get_ansi(j, "vars");
-
-  std::vector<std::pair<boost::regex, std::string>> patterns = {
-      {vars, var_color},
-      {exec_flags, exec_flags_color},
-      {numbers, number_color},
-      {flags, flag_color},
-      {paths, path_color},
-      {comments, comment_color},
-      {cmds, cmd_color},
-      {operators, operator_color},
-      {quote_pref, quote_pref_color},
-      {links, link_color},
-      {quotes, quote_color},
-      {subcommands, subcommand_color},
-      {operators, operator_color}
-  };
-
-  return highlight(prompt, patterns);
-}
\ No newline at end of file
+  const auto& theme = get_theme();
+
+  if(theme.generation != last_generation || theme.path != last_theme_path) {
+    last_input.clear();
+    last_output.clear();
+    last_tokens.clear();
+    last_generation = theme.generation;
+    last_theme_path = theme.path;
+  }
+
+  // Only the tokens before the first changed character are kept. A token is reused only if the character right
+  // after it is unchanged too, since that character decides where the token ends (e.g. > becoming >>)
+  size_t common = 0;
+  size_t max_common = std::min(prompt.size(), last_input.size());
+  while(common < max_common && prompt[common] == last_input[common]) common++;
+
+  size_t keep = 0;
+  while(keep < last_tokens.size() && last_tokens[keep].end < common) keep++;
+
+  size_t pos = keep > 0 ? last_tokens[keep - 1].end : 0;
+  bool command_pos = keep > 0 ? last_tokens[keep - 1].command_next : true;
+  last_output.resize(keep > 0 ? last_tokens[keep - 1].out_end : 0);
+  last_tokens.resize(keep);
+
+  lex_from(theme, prompt, pos, command_pos);
+  last_input = std::move(prompt);
+
+  return last_output;
+}
@@ -5,4 +5,8 @@
 
 std::string highl(std::string prompt); 
 
+// Lets the shell tell the highlighter which commands exist, unknown ones get the "unknown_command" color.
+// Without a checker (e.g. in slash-utils) every command gets the command color
+void set_command_checker(bool (*is_known)(const std::string& command));
+
 #endif // SLASH_CMD_HIGHLIGHTER_CPP
\ No newline at end of file
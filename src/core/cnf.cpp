@@ -1,80 +1,150 @@
 #include "cnf.h"
+#include "command_table.h"
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
 
 #include <unistd.h>
 #include <algorithm>
-#include <dirent.h>
-#include <limits>
+#include <bit>
+#include <cstdint>
+#include <string_view>
 #include <sstream>
 #include <vector>
 #include <cstdlib>
 
-static std::vector<std::string> commands;
-
-int d_levenshtein(const std::string &s1, const std::string &s2) {
-    size_t len1 = s1.size();
-    size_t len2 = s2.size();
-    std::vector<std::vector<int>> d(len1 + 1, std::vector<int>(len2 + 1));
-
-    for (size_t i = 0; i <= len1; i++) d[i][0] = i;
-    for (size_t j = 0; j <= len2; j++) d[0][j] = j;
-
-    for (size_t i = 1; i <= len1; i++) {
-        for (size_t j = 1; j <= len2; j++) {
-            int cost = (s1[i-1] == s2[j-1]) ? 0 : 1;
-            d[i][j] = std::min({ d[i-1][j] + 1,     // deletion
-                                 d[i][j-1] + 1,     // insertion
-                                 d[i-1][j-1] + cost // substitution
-                               });
-            if (i > 1 && j > 1 && s1[i-1]==s2[j-2] && s1[i-2]==s2[j-1]) {
-                d[i][j] = std::min(d[i][j], d[i-2][j-2] + cost); // transposition
-            }
-        }
+const int MAX_SUGGESTION_DISTANCE = 2;
+
+struct IndexedCommand {
+  size_t index;     // Into CommandTable::names()
+  uint64_t letters; // Which characters occur in the name, folded into 64 bits
+};
+
+// Commands bucketed by length, since names more than MAX_SUGGESTION_DISTANCE
+// characters longer or shorter can never be suggested
+static std::vector<std::vector<IndexedCommand>> by_length;
+static unsigned long indexed_generation = 0;
+static bool indexed = false;
+
+uint64_t letter_mask(std::string_view s) {
+  uint64_t mask = 0;
+  for(unsigned char c : s) mask |= uint64_t(1) << (c & 63);
+  return mask;
+}
+
+void index_commands() {
+  unsigned long generation = CommandTable::generation();
+  if(indexed && generation == indexed_generation) return;
+
+  const auto& names = CommandTable::names();
+  by_length.clear();
+  for(size_t i = 0; i < names.size(); i++) {
+    size_t len = names[i].size();
+    if(len >= by_length.size()) by_length.resize(len + 1);
+    by_length[len].push_back({i, letter_mask(names[i])});
+  }
+
+  indexed = true;
+  indexed_generation = generation;
+}
+
+// Optimal string alignment distance (Levenshtein plus adjacent transpositions), only computed
+// inside a band of max_dist around the diagonal. Returns max_dist + 1 as soon as the distance
+// is known to be larger. `rows` is scratch space, reused between calls
+int bounded_distance(std::string_view a, std::string_view b, int max_dist, std::vector<int>& rows) {
+  const int n = a.size(), m = b.size();
+  const int over = max_dist + 1;
+  if(std::abs(n - m) > max_dist) return over;
+
+  rows.assign(3 * (m + 1), over);
+  int* before = rows.data();       // Row i - 2, for transpositions
+  int* prev = before + (m + 1);    // Row i - 1
+  int* cur = prev + (m + 1);       // Row i
+  for(int j = 0; j <= std::min(m, max_dist); j++) prev[j] = j;
+
+  for(int i = 1; i <= n; i++) {
+    int lo = std::max(1, i - max_dist);
+    int hi = std::min(m, i + max_dist);
+
+    cur[0] = i <= max_dist ? i : over;
+    if(lo > 1) cur[lo - 1] = over;
+    int row_min = lo == 1 ? cur[0] : over;
+
+    for(int j = lo; j <= hi; j++) {
+      int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+      int d = std::min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost});
+      if(i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+        d = std::min(d, before[j - 2] + cost);
+      }
+      cur[j] = std::min(d, over);
+      row_min = std::min(row_min, cur[j]);
     }
-    return d[len1][len2];
+    if(hi < m) cur[hi + 1] = over;
+
+    if(row_min > max_dist) return over; // Every path through this row is already too far
+
+    int* recycled = before;
+    before = prev;
+    prev = cur;
+    cur = recycled;
+  }
+
+  return std::min(prev[m], over);
 }
 
-void fill_commands() {
-    char* path_env = getenv("PATH");
-    if(!path_env) return;
+std::vector<Suggestion> suggest_commands(const std::string& cmd, size_t count) {
+  index_commands();
+  const auto& names = CommandTable::names();
 
-    std::vector<std::string> bindirs = io::split(path_env, ":");
-    char* home_env = getenv("HOME");
-    if(home_env)
-        bindirs.push_back(std::string(home_env) + "/.slash/slash-utils");
+  static std::vector<int> rows;
+  std::vector<std::pair<int, size_t>> best; // (distance, index), sorted, at most `count` long
+  int limit = MAX_SUGGESTION_DISTANCE;
+  uint64_t query_letters = letter_mask(cmd);
 
-    for(auto& dir : bindirs) {
-        DIR* d = opendir(dir.c_str());
-        if(!d) continue;
+  // Closest lengths first, so `limit` tightens before the far buckets are scanned
+  for(int diff = 0; diff <= MAX_SUGGESTION_DISTANCE; diff++) {
+    for(int sign : {1, -1}) {
+      if(diff == 0 && sign == -1) continue;
+      long len = static_cast<long>(cmd.size()) + sign * diff;
+      if(diff > limit || len < 0 || len >= static_cast<long>(by_length.size())) continue;
 
-        struct dirent* entry;
-        while((entry = readdir(d)) != nullptr) {
-            std::string name = entry->d_name;
-            if(name == "." || name == "..") continue;
-            commands.push_back(name);
-        }
-        closedir(d);
+      for(auto& [index, letters] : by_length[len]) {
+        // One edit adds or removes at most two characters from the set of letters, so this is a lower bound
+        if(std::popcount(letters ^ query_letters) > 2 * limit) continue;
+
+        int distance = bounded_distance(cmd, names[index], limit, rows);
+        if(distance == 0 || distance > limit) continue;
+
+        auto pos = std::upper_bound(best.begin(), best.end(), std::make_pair(distance, index),
+          [&](const auto& x, const auto& y) {
+            return x.first != y.first ? x.first < y.first : names[x.second] < names[y.second];
+          });
+        best.insert(pos, {distance, index});
+        if(best.size() > count) best.pop_back();
+        if(best.size() == count) limit = best.back().first;
+      }
     }
+  }
+
+  std::vector<Suggestion> result;
+  for(auto& [distance, index] : best) result.push_back({names[index], distance});
+  return result;
 }
 
 std::string cnf(std::string cmd) {
     std::stringstream ss;
     ss << red << "[Error] " << reset << cmd << ": Command not found\n";
 
-    std::string best_match;
-    int min_dist = std::numeric_limits<int>::max();
+    auto suggestions = suggest_commands(cmd, 3);
+    // Only the closest ones, "gti" shouldn't suggest "gcc" next to "git"
+    while(!suggestions.empty() && suggestions.back().distance > suggestions.front().distance) suggestions.pop_back();
 
-    for(const auto& command : commands) {
-        int distance = d_levenshtein(cmd, command);
-        if(distance < min_dist) {
-            min_dist = distance;
-            best_match = command;
+    if(!suggestions.empty()) {
+        ss << "Did you mean ";
+        for(size_t i = 0; i < suggestions.size(); i++) {
+            if(i > 0) ss << (i + 1 == suggestions.size() ? " or " : ", ");
+            ss << cyan << "\"" << suggestions[i].name << "\"" << reset;
         }
-    }
-
-    if(min_dist > 0 && min_dist < 3) { // threshold for suggestion
-        ss << "Did you mean " << cyan << "\"" << best_match << "\"" << reset << "?\n";
+        ss << "?\n";
     }
 
     return ss.str();
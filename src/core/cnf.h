@@ -2,8 +2,14 @@
 #define SLASH_CNF_H
 
 #include <string>
+#include <vector>
+
+struct Suggestion {
+  std::string name;
+  int distance;
+};
 
-void fill_commands();
 std::string cnf(std::string cmd);
+std::vector<Suggestion> suggest_commands(const std::string& cmd, size_t count); // Closest commands first
 
 #endif // SLASH_CNF_H
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "command_table.h"
+#include "../abstractions/definitions.h"
+#include "../abstractions/iofuncs.h"
+
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+struct BinDir {
+  std::string path;
+  bool readable = false;
+  struct timespec mtime = {};
+  std::vector<std::string> entries;
+};
+
+static std::vector<BinDir> dirs; // slash-utils first, then $PATH in order, so the first match wins like execvp
+static std::unordered_map<std::string, size_t> table; // Command name to its index in dirs
+static std::vector<std::string> all_names;
+static std::string last_path_env;
+static std::chrono::steady_clock::time_point last_check;
+static bool built = false;
+static unsigned long table_generation = 0;
+
+#pragma region helpers
+
+// Reads the directory again if it changed since the last read, returns whether it did
+bool read_dir(BinDir& dir) {
+  struct stat st;
+  if(stat(dir.path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    bool changed = dir.readable;
+    dir.readable = false;
+    dir.entries.clear();
+    return changed;
+  }
+
+  if(dir.readable && st.st_mtim.tv_sec == dir.mtime.tv_sec && st.st_mtim.tv_nsec == dir.mtime.tv_nsec) return false;
+
+  dir.readable = true;
+  dir.mtime = st.st_mtim;
+  dir.entries.clear();
+
+  DIR* d = opendir(dir.path.c_str());
+  if(!d) {
+    dir.readable = false;
+    return true;
+  }
+
+  // Only what execvp could run counts, so a stray non-executable file can't shadow a command later in $PATH.
+  // Symlinks are followed, and DT_UNKNOWN from filesystems that don't fill in d_type is stat'd like the rest
+  int fd = dirfd(d);
+  struct dirent* entry;
+  while((entry = readdir(d)) != nullptr) {
+    if(entry->d_type == DT_DIR) continue;
+    std::string name = entry->d_name;
+    if(name == "." || name == "..") continue;
+
+    struct stat entry_st;
+    if(fstatat(fd, name.c_str(), &entry_st, 0) != 0 || !S_ISREG(entry_st.st_mode)) continue;
+    if(faccessat(fd, name.c_str(), X_OK, AT_EACCESS) != 0) continue;
+    dir.entries.push_back(std::move(name));
+  }
+  closedir(d);
+  return true;
+}
+
+void rebuild_table() {
+  table_generation++;
+  table.clear();
+  all_names.clear();
+  for(size_t i = 0; i < dirs.size(); i++) {
+    for(auto& name : dirs[i].entries) {
+      if(table.emplace(name, i).second) all_names.push_back(name);
+    }
+  }
+}
+
+// Rebuilds the directory list for a new $PATH, keeping the directories that were already read
+void set_search_path(const std::string& path_env) {
+  std::vector<std::string> wanted = {slash_dir + "/slash-utils"};
+  for(auto& dir : io::split(path_env, ":")) {
+    if(dir.empty() || std::find(wanted.begin(), wanted.end(), dir) != wanted.end()) continue;
+    wanted.push_back(dir);
+  }
+
+  std::vector<BinDir> next;
+  for(auto& path : wanted) {
+    auto it = std::find_if(dirs.begin(), dirs.end(), [&](const BinDir& d) { return d.path == path; });
+    if(it != dirs.end()) next.push_back(std::move(*it));
+    else next.push_back({path, false, {}, {}});
+  }
+  dirs = std::move(next);
+  last_path_env = path_env;
+}
+
+#pragma endregion
+
+void CommandTable::refresh(bool force) {
+  const char* env = getenv("PATH");
+  std::string path_env = env ? env : "";
+  auto now = std::chrono::steady_clock::now();
+
+  bool path_changed = !built || path_env != last_path_env;
+  if(!force && !path_changed && now - last_check < std::chrono::seconds(1)) return;
+  last_check = now;
+
+  bool changed = path_changed;
+  if(path_changed) set_search_path(path_env);
+  for(auto& dir : dirs) {
+    if(read_dir(dir)) changed = true;
+  }
+
+  built = true;
+  if(changed) rebuild_table();
+}
+
+std::string CommandTable::lookup(const std::string& name, bool rescan_on_miss) {
+  if(name.empty()) return "";
+  if(name.find('/') != std::string::npos) {
+    return access(name.c_str(), X_OK) == 0 ? name : "";
+  }
+
+  refresh();
+  auto it = table.find(name);
+  if(it == table.end()) {
+    if(!rescan_on_miss) return "";
+    refresh(true); // Might have been installed within the last second
+    it = table.find(name);
+    if(it == table.end()) return "";
+  }
+  return dirs[it->second].path + "/" + name;
+}
+
+bool CommandTable::is_builtin(const std::string& name) {
+  return name == "var" || name == "jobs" || name == "help" || name == "alias" || name == "exit" ||
+         name == "cd" || name == "reload" || name == "slash-greeting" ||
+         name == "~" || name == ".." || name == "/";
+}
+
+bool CommandTable::is_slash_util(const std::string& path) {
+  return path.starts_with(slash_dir + "/slash-utils/");
+}
+
+const std::vector<std::string>& CommandTable::names() {
+  refresh();
+  return all_names;
+}
+
+unsigned long CommandTable::generation() {
+  refresh();
+  return table_generation;
+}
@@ -0,0 +1,22 @@
+#ifndef SLASH_COMMAND_TABLE_H
+#define SLASH_COMMAND_TABLE_H
+
+#include <string>
+#include <vector>
+
+// Every command in ~/.slash/slash-utils and $PATH, hashed by name, like bash's `hash`.
+// Each directory is read once and only read again when its mtime changes or $PATH does
+namespace CommandTable {
+  void refresh(bool force = false); // Stats the directories at most once a second unless forced
+
+  // Absolute path, or "" if there is no such command. A miss stats every directory again in case the command
+  // was just installed, which callers running on every keystroke turn off with rescan_on_miss
+  std::string lookup(const std::string& name, bool rescan_on_miss = true);
+  bool is_builtin(const std::string& name);
+  bool is_slash_util(const std::string& path); // Whether a path returned by lookup() is a slash-util
+
+  const std::vector<std::string>& names(); // Every known command name, for suggestions
+  unsigned long generation();              // Bumped whenever names() changes
+}
+
+#endif // SLASH_COMMAND_TABLE_H
@@ -7,6 +7,7 @@
 #include <chrono>
 #include "../abstractions/info.h"
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/json.h"
 #include "../builtin-cmds/cd.h"
 #include "../builtin-cmds/var.h"
 #include "../builtin-cmds/alias.h"
@@ -14,56 +15,33 @@
 #include <nlohmann/json.hpp>
 #include <thread>
 #include "jobs.h"
+#include "history.h"
 #include "parser.h"
 #include "../builtin-cmds/slash-greeting.h"
 #include "../builtin-cmds/help.h"
 #include "../builtin-cmds/jobs.h"
 #include "cnf.h"
+#include "command_table.h"
 #include <algorithm>
 #include "exiter.h"
+#include "pipeline.h"
 
 #pragma region helpers
 
 bool is_print_exit_code_enabled() {
-  bool pec = false;
-  auto settings = io::read_file(slash_dir + "/config/settings.json");
-  nlohmann::json json;
+  const auto& json = get_cached_json(slash_dir + "/config/settings.json");
+  if(json.empty()) return false;
 
-  if(std::holds_alternative<std::string>(settings)) {
-    json = nlohmann::json::parse(std::get<std::string>(settings));
-  } else {
-    std::stringstream error;
-    error << "Failed to open settings.json: " << strerror(errno);
-    info::error(error.str(), errno, "settings.json");
-    return false;
-  }
-
-  if(json.contains("printExitCodeWhenProgramExits")) {
-     pec = json["printExitCodeWhenProgramExits"];
-  } else {
+  if(!json.contains("printExitCodeWhenProgramExits")) {
     info::error("Missing \"printExitCodeWhenProgramExits\" property in settings");
     return false;
   }
 
-  if(!pec) return false;
-
-  return pec;
+  return get_bool(json, "printExitCodeWhenProgramExits").value_or(false);
 }
 
-int save_to_history(std::vector<std::string> parsed_arg, std::string input) {
-  std::string cmd = io::split(input, " ")[0];
-  std::string full_path = getenv("HOME") + std::string("/.slash/slash-utils/") + cmd;
-  if(access(full_path.c_str(), X_OK) == 0) {
-    cmd = full_path + cmd;
-    parsed_arg[0] = cmd;
-  }
-
-  input = io::trim(input);
-  std::string history_path = getenv("HOME") + std::string("/.slash/.slash_history");
-
-  if(!io::write_to_file(history_path, input + "\n")) {
-    return errno;
-  } else return 0;
+int save_to_history(std::string input) {
+  return HistoryStore::get().append(io::trim(input));
 }
 
 std::string get_signal_name(int signal) {
@@ -172,6 +150,60 @@ std::string get_signal_name(int signal) {
 }
 
 
+int parse_redirections(std::vector<std::string>& args, RedirectInfo& rinfo, std::string& input_file) {
+  if(!rinfo.stdout_enabled || !rinfo.stderr_enabled) {
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == ">" || args[i] == ">>" || args[i] == "1>" || args[i] == "1>>") {
+            rinfo.stdout_enabled = true;
+            rinfo.stdout_append = (args[i] == ">>" || args[i] == "1>>");
+            if (i + 1 < args.size()) rinfo.stdout_filepath = args[i + 1];
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            i--;
+        }
+        else if (args[i] == "2>" || args[i] == "2>>") {
+            rinfo.stderr_enabled = true;
+            rinfo.stderr_append = (args[i] == "2>>");
+            if (i + 1 < args.size()) rinfo.stderr_filepath = args[i + 1];
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            i--;
+        }
+        else if (args[i] == "2>&1") rinfo.err_to_out = true;
+        else if (args[i] == "1>&2") rinfo.out_to_err = true;
+        else if (args[i] == "0>&1") rinfo.in_to_out = true;
+        else if (args[i] == "0>&2") rinfo.in_to_err = true;
+        else if (args[i] == "2>&0") rinfo.err_to_in = true;
+        else if (args[i] == "1>&0") rinfo.out_to_in = true;
+    }
+  }
+
+  if(io::vecContains(args, "<")) {
+    auto it = std::find_if(args.begin(), args.end(), [](std::string s) {
+      return s == "<";
+    });
+    int i = std::distance(args.begin(), it);
+
+    if(i + 1 >= args.size()) {
+      info::error("Unspecified input redirection file");
+      return -1;
+    }
+
+    input_file = args[i + 1];
+    args.erase(args.begin() + i, args.begin() + i + 2);
+  }
+
+  args.erase(
+        std::remove_if(args.begin(), args.end(),
+                        [](std::string s){
+                            return s == "2>&0" || s == "2>&1" || 
+                                  s == "1>&0" || s == "1>&2" || 
+                                  s == "0>&1" || s == "0>&2";
+                        }),
+          args.end()
+      );
+
+  return 0;
+}
+
 #pragma endregion
 
 volatile sig_atomic_t interrupted = 0; // For Ctrl+C 
@@ -225,6 +257,27 @@ std::string message(int sig, bool core_dumped) {
     }
 }
 
+void print_elapsed_time(std::chrono::_V2::system_clock::time_point start) {
+  auto end = std::chrono::high_resolution_clock::now();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+  int hours = elapsed.count() / 3600000;
+  int minutes = (elapsed.count() % 3600000) / 60000;
+  int seconds = (elapsed.count() % 60000) / 1000;
+  int milliseconds = elapsed.count() % 1000;
+
+  std::stringstream ss;
+
+  ss << cyan << "[Elapsed time: "
+     << std::setw(2) << std::setfill('0') << hours << ":"
+     << std::setw(2) << std::setfill('0') << minutes << ":"
+     << std::setw(2) << std::setfill('0') << seconds << ":"
+     << std::setw(3) << std::setfill('0') << milliseconds
+     << "]\n" << reset;
+
+  io::print(ss.str());
+}
+
 int wait_foreground_job(pid_t pid, const std::string& cmd, ExecFlags flags, bool time, std::chrono::_V2::system_clock::time_point start) {
     struct sigaction in{};
     in.sa_handler = handle_sigint;
@@ -250,26 +303,7 @@ int wait_foreground_job(pid_t pid, const std::string& cmd, ExecFlags flags, bool
         pid_t result = waitpid(pid, &status, WUNTRACED | WCONTINUED);
     if (result == -1) break; // no more children
 
-        if((WIFEXITED(status) || WIFSIGNALED(status)) && (flags.time || time)) {
-      auto end = std::chrono::high_resolution_clock::now();
-      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-      int hours = elapsed.count() / 3600000;
-      int minutes = (elapsed.count() % 3600000) / 60000;
-      int seconds = (elapsed.count() % 60000) / 1000;
-      int milliseconds = elapsed.count() % 1000;
-
-      std::stringstream ss;
-    
-      ss << cyan << "[Elapsed time: "
-         << std::setw(2) << std::setfill('0') << hours << ":"
-         << std::setw(2) << std::setfill('0') << minutes << ":"
-         << std::setw(2) << std::setfill('0') << seconds << ":"
-         << std::setw(3) << std::setfill('0') << milliseconds
-         << "]\n" << reset;
-
-      io::print(ss.str());       
-        }
+        if((WIFEXITED(status) || WIFSIGNALED(status)) && (flags.time || time)) print_elapsed_time(start);
 
         if (WIFEXITED(status)) {
             int code = WEXITSTATUS(status);
@@ -307,6 +341,63 @@ int wait_foreground_job(pid_t pid, const std::string& cmd, ExecFlags flags, bool
 
 
 
+// Runs a builtin in this process. args are already stripped of exec flags and redirections, so a pipeline
+// stage forked off for one doesn't parse, resolve or read settings again in the child
+int run_builtin(std::vector<std::string> parsed_args) {
+  if(parsed_args[0] == "var") {
+    parsed_args.erase(parsed_args.begin());
+    return var(parsed_args);
+  }
+
+  if(parsed_args[0] == "jobs") {
+    parsed_args.erase(parsed_args.begin());
+    return jobs(parsed_args);
+  }
+
+  if(parsed_args[0] == "help") {
+    if(parsed_args.size() > 1) {
+      if(parsed_args[1] == "--slash-utils") return slash_utils_help();
+      else if(parsed_args[1] == "--keys") return help_keys();
+      else if(parsed_args[1] == "--cquotes") return colored_quotes_help();
+      else info::error("Invalid help argument.\n");
+    }
+    return help();
+  }
+
+  if(parsed_args[0] == "alias") {
+    parsed_args.erase(parsed_args.begin());
+    return alias(parsed_args);
+  }
+
+  if(parsed_args[0] == "exit") return slash_exit();
+
+  if(parsed_args[0] == "cd") {
+    parsed_args.erase(parsed_args.begin());
+    return cd(parsed_args);
+  }
+
+  if(parsed_args[0] == "reload") {
+    if(parsed_args.size() > 1) {
+      if(parsed_args[1] == "-h" || parsed_args[1] == "--help") {
+        io::print(green + "\nFunction\n" + reset);
+        io::print("  Reload .slashrc and the prompt, syntax highlighting and settings files\n\n");
+        return 0;
+      }
+    }
+    invalidate_json_cache(); // pick up edited themes and settings even if a change notification was missed
+    execute_startup_commands(); // reload .slashrc
+    return 0;
+  }
+
+  if(parsed_args[0] == "~" || parsed_args[0] == ".." || parsed_args[0] == "/") {
+    return cd({parsed_args[0]});
+  }
+
+  if(parsed_args[0] == "slash-greeting") return greet();
+
+  return 127;
+}
+
 int execute(std::vector<std::string> parsed_args, std::string input, bool bg, RedirectInfo rinfo = {}, ExecFlags info = {}) {
   if(parsed_args.empty()) return 0;
 
@@ -337,15 +428,14 @@ int execute(std::vector<std::string> parsed_args, std::string input, bool bg, Re
 
   std::string cmd = parsed_args[0];
 
-  bool using_path = false;
-  std::string home = getenv("HOME");
-  std::string slashutil_path = home + "/.slash/slash-utils/" + parsed_args[0];
+  // Resolved from the command table, so neither this nor the child has to probe $PATH. Builtins are
+  // run as they are and not looked up, which would rescan every directory in $PATH on the miss
+  std::string resolved = CommandTable::is_builtin(parsed_args[0]) ? "" : CommandTable::lookup(parsed_args[0]);
 
   // For the condition with ~, .., and /, trying to access a slash-util with these will disrupt it
-  if(access(slashutil_path.c_str(), X_OK) == 0 && 
+  if(CommandTable::is_slash_util(resolved) &&
    parsed_args[0] != "~" && parsed_args[0] != "/" && parsed_args[0] != "..") {
-       parsed_args[0] = slashutil_path;
-       using_path = true;
+       parsed_args[0] = resolved;
 }
 
   bool stdout_only   = io::vecContains(parsed_args, "@o");
@@ -367,109 +457,10 @@ int execute(std::vector<std::string> parsed_args, std::string input, bool bg, Re
     }
   }
 
-  if(!rinfo.stdout_enabled || !rinfo.stderr_enabled) {
-    for (size_t i = 0; i < parsed_args.size(); i++) {
-        if (parsed_args[i] == ">" || parsed_args[i] == ">>" || parsed_args[i] == "1>" || parsed_args[i] == "1>>") {
-            rinfo.stdout_enabled = true;
-            rinfo.stdout_append = (parsed_args[i] == ">>" || parsed_args[i] == "1>>");
-            if (i + 1 < parsed_args.size()) rinfo.stdout_filepath = parsed_args[i + 1];
-            parsed_args.erase(parsed_args.begin() + i, parsed_args.begin() + i + 2);
-            i--;
-        }
-        else if (parsed_args[i] == "2>" || parsed_args[i] == "2>>") {
-            rinfo.stderr_enabled = true;
-            rinfo.stderr_append = (parsed_args[i] == "2>>");
-            if (i + 1 < parsed_args.size()) rinfo.stderr_filepath = parsed_args[i + 1];
-            parsed_args.erase(parsed_args.begin() + i, parsed_args.begin() + i + 2);
-            i--;
-        }
-        else if (parsed_args[i] == "2>&1") rinfo.err_to_out = true;
-        else if (parsed_args[i] == "1>&2") rinfo.out_to_err = true;
-        else if (parsed_args[i] == "0>&1") rinfo.in_to_out = true;
-        else if (parsed_args[i] == "0>&2") rinfo.in_to_err = true;
-        else if (parsed_args[i] == "2>&0") rinfo.err_to_in = true;
-        else if (parsed_args[i] == "1>&0") rinfo.out_to_in = true;
-    }
-  }
-
   std::string input_redfile;
-  if(io::vecContains(parsed_args, "<")) {
-    auto it = std::find_if(parsed_args.begin(), parsed_args.end(), [](std::string s) {
-      return s == "<";
-    });
-    int i = std::distance(parsed_args.begin(), it);
-
-    if(i >= parsed_args.size()) {
-      info::error("Unspecified input redirection file");
-      return -1;
-    }
-
-    input_redfile = parsed_args[i + 1];
-    parsed_args.erase(parsed_args.begin() + i, parsed_args.begin() + i + 2);
-  }
-
-  parsed_args.erase(
-        std::remove_if(parsed_args.begin(), parsed_args.end(),
-                        [](std::string s){
-                            return s == "2>&0" || s == "2>&1" || 
-                                  s == "1>&0" || s == "1>&2" || 
-                                  s == "0>&1" || s == "0>&2";
-                        }),
-          parsed_args.end()
-      );
-
-  if(parsed_args[0] == "var") {
-    parsed_args.erase(parsed_args.begin());
-    
-    return var(parsed_args);
-  }
-
-  if(parsed_args[0] == "jobs") {
-    parsed_args.erase(parsed_args.begin());
-    return jobs(parsed_args);
-  }
-
-  if(parsed_args[0] == "help") {
-    if(parsed_args.size() > 1) {
-      if(parsed_args[1] == "--slash-utils") return slash_utils_help();
-      else if(parsed_args[1] == "--keys") return help_keys();
-      else if(parsed_args[1] == "--cquotes") return colored_quotes_help();
-      else info::error("Invalid help argument.\n");
-    }
-    return help();
-  }
-
-  if(parsed_args[0] == "alias") {
-    parsed_args.erase(parsed_args.begin());
-    return alias(parsed_args);
-  }
-
-  if (parsed_args[0] == "exit") {
-    return slash_exit();      
-  }
-
-    if (parsed_args[0] == "cd") {
-        parsed_args.erase(parsed_args.begin());
-        return cd(parsed_args);
-    }
-
-    if(parsed_args[0] == "reload") {
-      if(parsed_args.size() > 1) {
-        if(parsed_args[1] == "-h" || parsed_args[1] == "--help") {
-          io::print(green + "\nFunction\n" + reset);
-          io::print("  Reload .slashrc\n\n");
-          return 0;
-        }
-      }
-      execute_startup_commands(); // reload .slashrc
-      return 0;
-    }
-
-    if(parsed_args[0] == "~" || parsed_args[0] == ".." || parsed_args[0] == "/") {
-      return cd({parsed_args[0]});
-    }
+  if(parse_redirections(parsed_args, rinfo, input_redfile) != 0) return -1;
 
-    if(parsed_args[0] == "slash-greeting") return greet();
+  if(CommandTable::is_builtin(parsed_args[0])) return run_builtin(parsed_args);
 
   pid_t pid = fork();
   if (pid == -1) {
@@ -564,10 +555,10 @@ int execute(std::vector<std::string> parsed_args, std::string input, bool bg, Re
       joined += argv[i];
     }
 
-    if(using_path) {
-        execv(slashutil_path.c_str(), argv.data());
+    if(!resolved.empty()) {
+        execv(resolved.c_str(), argv.data());
     } else {
-        execvp(argv[0], argv.data());
+        errno = ENOENT;
     }
 
     // If execvp or execv fail
@@ -611,63 +602,6 @@ int execute(std::vector<std::string> parsed_args, std::string input, bool bg, Re
 }
 
 
-int execute_pipeline(const std::string& raw_input) {
-    auto commands = io::split(raw_input, "|");
-    int n = commands.size();
-
-    int prev_fd = -1; // previous pipe read end
-    std::vector<pid_t> pids;
-
-    for (int i = 0; i < n; i++) {
-        std::string cmd_str = io::trim(commands[i]);
-        auto args = parse_arguments(cmd_str);
-
-        int pipe_fd[2] = {-1, -1};
-        if (i < n - 1) {
-            if (pipe(pipe_fd) == -1) {
-                info::error("Failed to create pipe: " + std::string(strerror(errno)), errno);
-                return -1;
-            }
-        }
-
-        pid_t pid = fork();
-        if (pid == -1) {
-            info::error("Fork failed: " + std::string(strerror(errno)), errno);
-            return -1;
-        }
-
-        if (pid == 0) { // child
-            if (prev_fd != -1) {
-                dup2(prev_fd, STDIN_FILENO);
-                close(prev_fd);
-            }
-            if (pipe_fd[1] != -1) {
-                dup2(pipe_fd[1], STDOUT_FILENO);
-                close(pipe_fd[0]);
-                close(pipe_fd[1]);
-            }
-
-            execute(args, cmd_str, io::vecContains(args, "&"), {});
-            _exit(0);
-        } else { // parent
-            if (prev_fd != -1) close(prev_fd);
-            if (pipe_fd[1] != -1) close(pipe_fd[1]);
-            prev_fd = pipe_fd[0];
-            pids.push_back(pid);
-        }
-    }
-
-    // Wait for all children
-    int exit_code = 0;
-    for (auto pid : pids) {
-        int status;
-        waitpid(pid, &status, 0);
-        if (WIFEXITED(status)) exit_code = WEXITSTATUS(status);
-    }
-
-    return exit_code;
-}
-
 int exec(std::vector<std::string> args, std::string raw_input) {
     raw_input = io::trim(raw_input);
     if (args.empty()) return 0;
@@ -707,9 +641,12 @@ int exec(std::vector<std::string> args, std::string raw_input) {
         return 0;
     }
 
-    if (io::vecContains(args, "|")) {
-        return execute_pipeline(raw_input);
+    auto stages = split_pipeline(bg ? raw_input.substr(0, raw_input.size() - 1) : raw_input);
+    if (stages.size() > 1) {
+        return run_pipeline(stages, bg);
     }
 
-    return execute(args, raw_input, bg, {});
+    int code = execute(args, raw_input, bg, {});
+    set_temp_var("PIPESTATUS", std::to_string(code));
+    return code;
 }
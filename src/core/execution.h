@@ -33,10 +33,15 @@ struct ExecFlags {
   bool time;
 };
 
+bool is_print_exit_code_enabled();
+int parse_redirections(std::vector<std::string>& args, RedirectInfo& rinfo, std::string& input_file); // Strips redirections from args
+std::string message(int sig, bool core_dumped);
+void print_elapsed_time(std::chrono::_V2::system_clock::time_point start);
+
+int run_builtin(std::vector<std::string> parsed_args); // For names CommandTable::is_builtin() accepts
 int execute(std::vector<std::string> parsed_args, std::string input, bool bg, RedirectInfo rinfo, ExecFlags info);
-int pipe_execute(std::vector<std::vector<std::string>> commands);
 int wait_foreground_job(pid_t pid, const std::string& cmd, ExecFlags flags, bool time, std::chrono::_V2::system_clock::time_point start);
-int save_to_history(std::vector<std::string> parsed_arg, std::string input);
+int save_to_history(std::string input);
 
 int exec(std::vector<std::string> args, std::string raw_input);
 
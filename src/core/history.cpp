@@ -0,0 +1,104 @@
+#include "history.h"
+#include "../abstractions/definitions.h"
+#include "../abstractions/info.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+
+HistoryStore::HistoryStore(std::string history_path) : path(history_path) {
+  offsets.push_back(0);
+}
+
+HistoryStore& HistoryStore::get() {
+  static HistoryStore store(slash_dir + "/.slash_history");
+  return store;
+}
+
+void HistoryStore::add(std::string_view entry) {
+  if(entry.empty()) return;
+  arena.append(entry);
+  offsets.push_back(arena.size());
+}
+
+int HistoryStore::load() {
+  loaded = true;
+  arena.clear();
+  offsets.assign(1, 0);
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    if(errno == ENOENT) return 0;
+    info::error("Failed to load history: " + std::string(strerror(errno)), errno, path);
+    return errno;
+  }
+
+  // Read in chunks so files of any size load fully, carrying a partial line over to the next chunk
+  char buffer[65536];
+  std::string partial;
+  ssize_t bytes_read;
+  while((bytes_read = read(fd, buffer, sizeof(buffer))) != 0) {
+    if(bytes_read < 0) {
+      if(errno == EINTR) continue;
+      int err = errno;
+      info::error("Failed to read history: " + std::string(strerror(err)), err, path);
+      close(fd);
+      return err;
+    }
+
+    std::string_view chunk(buffer, bytes_read);
+    size_t start = 0;
+    size_t newline;
+    while((newline = chunk.find('\n', start)) != std::string_view::npos) {
+      if(partial.empty()) add(chunk.substr(start, newline - start));
+      else {
+        partial.append(chunk.substr(start, newline - start));
+        add(partial);
+        partial.clear();
+      }
+      start = newline + 1;
+    }
+    partial.append(chunk.substr(start));
+  }
+  add(partial);
+
+  close(fd);
+  return 0;
+}
+
+size_t HistoryStore::size() {
+  if(!loaded) load();
+  return offsets.size() - 1;
+}
+
+std::string_view HistoryStore::at(size_t index) {
+  if(!loaded) load();
+  return std::string_view(arena).substr(offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+std::string_view HistoryStore::from_newest(size_t index) {
+  return at(size() - 1 - index);
+}
+
+int HistoryStore::append(const std::string& entry) {
+  if(entry.empty()) return 0;
+  if(loaded) add(entry);
+
+  int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if(fd < 0) {
+    info::error(strerror(errno), errno, path);
+    return errno;
+  }
+
+  std::string line = entry + "\n";
+  if(write(fd, line.c_str(), line.size()) < 0) {
+    int err = errno;
+    info::error(strerror(err), err, path);
+    close(fd);
+    return err;
+  }
+
+  close(fd);
+  return 0;
+}
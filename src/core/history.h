@@ -0,0 +1,31 @@
+#ifndef SLASH_HISTORY_H
+#define SLASH_HISTORY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Command history, loaded from ~/.slash/.slash_history once and kept in memory.
+// Entries are stored back to back in one arena, with an offset index for O(1) access
+class HistoryStore {
+  private:
+  std::string arena;
+  std::vector<size_t> offsets; // Start of every entry in the arena, followed by the end of the last one
+  std::string path;
+  bool loaded = false;
+
+  void add(std::string_view entry);
+
+  public:
+  HistoryStore(std::string history_path);
+
+  static HistoryStore& get(); // The shell's history
+
+  int load(); // Called on first access, appending alone never loads the file
+  size_t size();
+  std::string_view at(size_t index);          // 0 is the oldest entry
+  std::string_view from_newest(size_t index); // 0 is the newest entry
+  int append(const std::string& entry);       // Adds to memory and to the file
+};
+
+#endif // SLASH_HISTORY_H
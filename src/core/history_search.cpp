@@ -0,0 +1,135 @@
+#include "history_search.h"
+
+#include <algorithm>
+#include <cctype>
+
+// Each repeated use of a command counts as if it had been run this many commands later
+static constexpr uint32_t FREQUENCY_WEIGHT = 50;
+
+static char lower(char c) {
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static uint32_t trigram_at(std::string_view str, size_t i) {
+  return (static_cast<uint32_t>(static_cast<unsigned char>(lower(str[i]))) << 16) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(lower(str[i + 1]))) << 8) |
+          static_cast<uint32_t>(static_cast<unsigned char>(lower(str[i + 2])));
+}
+
+HistorySearch::HistorySearch(HistoryStore& history_store) : store(history_store) {}
+
+HistorySearch& HistorySearch::get() {
+  static HistorySearch search(HistoryStore::get());
+  return search;
+}
+
+void HistorySearch::index_new_entries() {
+  size_t total = store.size();
+  if(indexed == total) return;
+
+  ids.reserve(ids.size() + (total - indexed));
+  entries.reserve(entries.size() + (total - indexed));
+
+  for(; indexed < total; indexed++) {
+    std::string_view command = store.at(indexed);
+
+    auto [it, inserted] = ids.try_emplace(std::string(command), static_cast<uint32_t>(entries.size()));
+    uint32_t id = it->second;
+    if(!inserted) {
+      entries[id].last_seen = indexed;
+      entries[id].count++;
+      continue;
+    }
+    entries.push_back({static_cast<uint32_t>(indexed), 1});
+
+    for(size_t i = 0; i + 3 <= command.size(); i++) {
+      auto& list = trigrams[trigram_at(command, i)];
+      if(list.empty() || list.back() != id) list.push_back(id);
+    }
+  }
+
+  results.clear(); // Rankings changed
+}
+
+bool HistorySearch::contains(uint32_t id, const std::string& lower_query) {
+  std::string_view command = store.at(entries[id].last_seen);
+  auto it = std::search(command.begin(), command.end(), lower_query.begin(), lower_query.end(),
+                        [](char a, char b) { return lower(a) == b; });
+  return it != command.end();
+}
+
+std::vector<uint32_t> HistorySearch::candidates(const std::string& lower_query) {
+  std::vector<uint32_t> result;
+
+  if(lower_query.size() < 3) {
+    result.resize(entries.size());
+    for(uint32_t id = 0; id < entries.size(); id++) result[id] = id;
+    return result;
+  }
+
+  // Intersect the posting lists, smallest first
+  std::vector<const std::vector<uint32_t>*> lists;
+  for(size_t i = 0; i + 3 <= lower_query.size(); i++) {
+    auto it = trigrams.find(trigram_at(lower_query, i));
+    if(it == trigrams.end()) return {};
+    lists.push_back(&it->second);
+  }
+  std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+
+  result = *lists[0];
+  for(size_t i = 1; i < lists.size() && !result.empty(); i++) {
+    std::vector<uint32_t> intersection;
+    std::set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(intersection));
+    result = std::move(intersection);
+  }
+  return result;
+}
+
+void HistorySearch::rank(std::vector<uint32_t>& ids_to_rank) {
+  auto score = [this](uint32_t id) {
+    return static_cast<uint64_t>(entries[id].last_seen) + static_cast<uint64_t>(entries[id].count - 1) * FREQUENCY_WEIGHT;
+  };
+  std::sort(ids_to_rank.begin(), ids_to_rank.end(), [&](uint32_t a, uint32_t b) { return score(a) > score(b); });
+}
+
+void HistorySearch::reset() {
+  results.clear();
+}
+
+const std::vector<uint32_t>& HistorySearch::search(const std::string& query) {
+  static const std::vector<uint32_t> nothing;
+  index_new_entries();
+  if(query.empty()) return nothing;
+
+  std::string lower_query = query;
+  std::transform(lower_query.begin(), lower_query.end(), lower_query.begin(), lower);
+
+  // Drop the results of queries that aren't a prefix of this one (backspace or edits)
+  while(!results.empty() && !lower_query.starts_with(results.back().first)) results.pop_back();
+  if(!results.empty() && results.back().first == lower_query) return results.back().second;
+
+  // A longer query can only match a subset of what the shorter one matched, already ranked.
+  // The trigram index is used instead when it gives fewer candidates
+  bool can_narrow = !results.empty();
+  std::vector<uint32_t> matched;
+  std::vector<uint32_t> from_index;
+  if(!can_narrow || lower_query.size() >= 3) from_index = candidates(lower_query);
+
+  if(can_narrow && (lower_query.size() < 3 || results.back().second.size() <= from_index.size())) {
+    for(uint32_t id : results.back().second) {
+      if(contains(id, lower_query)) matched.push_back(id);
+    }
+  } else {
+    for(uint32_t id : from_index) {
+      if(contains(id, lower_query)) matched.push_back(id);
+    }
+    rank(matched);
+  }
+
+  results.emplace_back(lower_query, std::move(matched));
+  return results.back().second;
+}
+
+std::string_view HistorySearch::entry(uint32_t id) {
+  return store.at(entries[id].last_seen);
+}
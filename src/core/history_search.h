@@ -0,0 +1,47 @@
+#ifndef SLASH_HISTORY_SEARCH_H
+#define SLASH_HISTORY_SEARCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "history.h"
+
+// Case-insensitive substring search over the history, for Ctrl+R.
+// Duplicate commands are merged, and results are ranked by recency and frequency.
+// A trigram index narrows the candidates, and typing more characters only filters the previous results
+class HistorySearch {
+  private:
+  struct Entry {
+    uint32_t last_seen; // Index in the HistoryStore of the newest occurrence
+    uint32_t count;
+  };
+
+  HistoryStore& store;
+  size_t indexed = 0; // Number of store entries already indexed
+
+  std::unordered_map<std::string, uint32_t> ids;
+  std::vector<Entry> entries;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams; // Trigram -> ids of the entries containing it, ascending
+
+  // Results of every query typed so far in this search, so backspace doesn't search again
+  std::vector<std::pair<std::string, std::vector<uint32_t>>> results;
+
+  void index_new_entries();
+  bool contains(uint32_t id, const std::string& lower_query);
+  std::vector<uint32_t> candidates(const std::string& lower_query);
+  void rank(std::vector<uint32_t>& ids_to_rank);
+
+  public:
+  HistorySearch(HistoryStore& history_store);
+
+  static HistorySearch& get();
+
+  void reset(); // Starts a new search session
+  const std::vector<uint32_t>& search(const std::string& query); // Best match first
+  std::string_view entry(uint32_t id);
+};
+
+#endif // SLASH_HISTORY_SEARCH_H
@@ -282,9 +282,43 @@ Args parse_arguments(std::string command) {
   return args;
 }
 
+std::vector<std::string> split_pipeline(const std::string& command) {
+  std::vector<std::string> stages;
+  std::string current;
+  bool dq_mode = false;
+  bool sq_mode = false;
+
+  for (size_t i = 0; i < command.size(); i++) {
+    char c = command[i];
+
+    if (c == '\\' && !sq_mode && i + 1 < command.size()) {
+      current += c;
+      current += command[++i];
+      continue;
+    }
+    if (c == '"' && !sq_mode) dq_mode = !dq_mode;
+    else if (c == '\'' && !dq_mode) sq_mode = !sq_mode;
+
+    if (c == '|' && !dq_mode && !sq_mode) {
+      if (i + 1 < command.size() && command[i + 1] == '|') { // "||" belongs to exec()
+        current += "||";
+        i++;
+        continue;
+      }
+      stages.push_back(current);
+      current.clear();
+      continue;
+    }
+    current += c;
+  }
+  stages.push_back(current);
+
+  return stages;
+}
+
 std::vector<Args> parse_pipe_commands(const std::string& command) {
   std::vector<Args> result;
-  Args pipe_cmds = io::split(command, "|");
+  Args pipe_cmds = split_pipeline(command);
   for (auto& cmd : pipe_cmds) {
     cmd = io::trim(cmd);
     result.push_back(parse_arguments(cmd));
@@ -7,6 +7,7 @@
 using Args = std::vector<std::string>;
 
 Args parse_arguments(std::string command);
+std::vector<std::string> split_pipeline(const std::string& command); // Splits on unquoted single "|"
 std::vector<Args> parse_pipe_commands(const std::string& command);
 
 #endif // SLASH_PARSER_H
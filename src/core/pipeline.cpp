@@ -0,0 +1,304 @@
+#include "pipeline.h"
+#include "execution.h"
+#include "parser.h"
+#include "jobs.h"
+#include "cnf.h"
+#include "command_table.h"
+#include "startup.h"
+#include "../abstractions/definitions.h"
+#include "../abstractions/info.h"
+#include "../abstractions/iofuncs.h"
+#include "../builtin-cmds/var.h"
+
+#include <spawn.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+extern char** environ;
+
+struct PipelineStage {
+  Args args;              // Exec flags and redirections already removed
+  std::string path;       // Resolved executable, empty for builtins and unknown commands
+  bool builtin = false;
+  RedirectInfo rinfo = {};
+  std::string input_file;
+  bool stdout_only = false;
+  bool stderr_only = false;
+};
+
+#pragma region helpers
+
+int prepare_stage(const std::string& text, PipelineStage& stage, ExecFlags& flags) {
+  stage.args = parse_arguments(text);
+  if(stage.args.empty()) {
+    info::error("Missing command in pipeline");
+    return -1;
+  }
+
+  if(parse_redirections(stage.args, stage.rinfo, stage.input_file) != 0) return -1;
+
+  Args kept;
+  for(auto& arg : stage.args) {
+    if(arg == "@o") stage.stdout_only = true;
+    else if(arg == "@O") stage.stderr_only = true;
+    else if(arg == "@e") flags.exit_code = true;
+    else if(arg == "@t") flags.time = true;
+    else if(arg == "@r") flags.repeat = true;
+    else kept.push_back(arg);
+  }
+  stage.args = std::move(kept);
+
+  if(stage.args.empty()) {
+    info::error("No command specified.");
+    return -1;
+  }
+
+  // Same lookup order as execute(): builtins, then slash-utils and $PATH
+  const std::string& cmd = stage.args[0];
+  if(CommandTable::is_builtin(cmd)) stage.builtin = true;
+  else stage.path = CommandTable::lookup(cmd);
+
+  return 0;
+}
+
+// Redirections are applied in the same order execute() applies them in its child
+void add_redirections(posix_spawn_file_actions_t* actions, const PipelineStage& stage) {
+  const RedirectInfo& r = stage.rinfo;
+
+  if(!stage.input_file.empty()) {
+    posix_spawn_file_actions_addopen(actions, STDIN_FILENO, stage.input_file.c_str(), O_RDONLY, 0);
+  }
+  if(r.stdout_enabled) {
+    int flags = O_WRONLY | O_CREAT | (r.stdout_append ? O_APPEND : O_TRUNC);
+    posix_spawn_file_actions_addopen(actions, STDOUT_FILENO, r.stdout_filepath.c_str(), flags, 0644);
+  }
+  if(r.stderr_enabled) {
+    int flags = O_WRONLY | O_CREAT | (r.stderr_append ? O_APPEND : O_TRUNC);
+    posix_spawn_file_actions_addopen(actions, STDERR_FILENO, r.stderr_filepath.c_str(), flags, 0644);
+  }
+
+  if(r.err_to_in)  posix_spawn_file_actions_adddup2(actions, STDIN_FILENO, STDERR_FILENO);
+  if(r.err_to_out) posix_spawn_file_actions_adddup2(actions, STDOUT_FILENO, STDERR_FILENO);
+  if(r.out_to_in)  posix_spawn_file_actions_adddup2(actions, STDIN_FILENO, STDOUT_FILENO);
+  if(r.out_to_err) posix_spawn_file_actions_adddup2(actions, STDERR_FILENO, STDOUT_FILENO);
+  if(r.in_to_out)  posix_spawn_file_actions_adddup2(actions, STDOUT_FILENO, STDIN_FILENO);
+  if(r.in_to_err)  posix_spawn_file_actions_adddup2(actions, STDERR_FILENO, STDIN_FILENO);
+
+  if(stage.stdout_only) posix_spawn_file_actions_addopen(actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+  if(stage.stderr_only) posix_spawn_file_actions_addopen(actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+}
+
+pid_t spawn_stage(const PipelineStage& stage, pid_t pgid, int in_fd, int out_fd, bool foreground) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 35)
+  // Hand the terminal over before exec (and before stdin is replaced by a pipe), so the first stage can't read it while still in the background
+  if(foreground && pgid == 0 && isatty(STDIN_FILENO)) {
+    posix_spawn_file_actions_addtcsetpgrp_np(&actions, STDIN_FILENO);
+  }
+#endif
+
+  if(in_fd != -1)  posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+  if(out_fd != -1) posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+  add_redirections(&actions, stage);
+
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+  posix_spawnattr_setpgroup(&attr, pgid);
+
+  sigset_t defaults;
+  sigemptyset(&defaults);
+  for(int sig : {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD, SIGPIPE}) sigaddset(&defaults, sig);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attr, &mask);
+
+  std::vector<char*> argv;
+  for(auto& arg : stage.args) argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  pid_t pid;
+  int err = posix_spawn(&pid, stage.path.c_str(), &actions, &attr, argv.data(), environ);
+
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  if(err != 0) {
+    info::error("Failed to execute \"" + stage.args[0] + "\": " + std::string(strerror(err)));
+    return -1;
+  }
+  return pid;
+}
+
+// Builtins can't be exec'd, so they get a plain fork. Everything was resolved in the parent, the child
+// only runs the builtin: anything more could block on a lock some other thread held when it forked
+pid_t fork_builtin(const PipelineStage& stage, pid_t pgid, int in_fd, int out_fd, int unused_fd) {
+  pid_t pid = fork();
+  if(pid != 0) return pid;
+
+  setpgid(0, pgid);
+  for(int sig : {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD, SIGPIPE}) signal(sig, SIG_DFL);
+
+  if(in_fd != -1)     { dup2(in_fd, STDIN_FILENO); close(in_fd); }
+  if(out_fd != -1)    { dup2(out_fd, STDOUT_FILENO); close(out_fd); }
+  if(unused_fd != -1) close(unused_fd);
+
+  _exit(run_builtin(stage.args) & 0xff);
+}
+
+std::string join_codes(const std::vector<int>& codes) {
+  std::vector<std::string> parts;
+  for(int code : codes) parts.push_back(std::to_string(code));
+  return io::join(parts, " ");
+}
+
+int status_to_code(int status) {
+  if(WIFEXITED(status)) return WEXITSTATUS(status);
+  if(WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+  return 0;
+}
+
+#pragma endregion
+
+int run_pipeline(const std::vector<std::string>& stage_texts, bool bg) {
+  ExecFlags flags = {};
+  std::vector<PipelineStage> stages(stage_texts.size());
+  for(size_t i = 0; i < stage_texts.size(); i++) {
+    if(prepare_stage(stage_texts[i], stages[i], flags) != 0) return -1;
+  }
+  if(is_print_exit_code_enabled()) flags.exit_code = true;
+
+  std::string cmd;
+  for(size_t i = 0; i < stage_texts.size(); i++) {
+    if(i > 0) cmd += " | ";
+    cmd += io::trim(stage_texts[i]);
+  }
+
+  // The terminal mode is shared by every process on it, so one switch here covers all stages
+  enable_canonical_mode();
+  signal(SIGTTOU, SIG_IGN);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  if(flags.time) io::print(cyan + "[Timer started]\n" + reset);
+
+  std::vector<pid_t> pids(stages.size(), -1);
+  std::vector<int> codes(stages.size(), 127);
+  pid_t pgid = 0;
+  int in_fd = -1;
+
+  for(size_t i = 0; i < stages.size(); i++) {
+    int pipe_fd[2] = {-1, -1};
+    if(i + 1 < stages.size() && pipe2(pipe_fd, O_CLOEXEC) == -1) {
+      info::error("Failed to create pipe: " + std::string(strerror(errno)), errno);
+      if(in_fd != -1) close(in_fd);
+      break;
+    }
+
+    PipelineStage& stage = stages[i];
+    pid_t pid = -1;
+    if(stage.builtin) {
+      pid = fork_builtin(stage, pgid, in_fd, pipe_fd[1], pipe_fd[0]);
+    } else if(stage.path.empty()) {
+      io::print_err(cnf(stage.args[0]));
+    } else {
+      pid = spawn_stage(stage, pgid, in_fd, pipe_fd[1], !bg);
+    }
+
+    if(pid > 0) {
+      if(pgid == 0) pgid = pid;
+      setpgid(pid, pgid); // Also done by the child, whichever runs first wins
+      if(!bg && isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, pgid);
+      pids[i] = pid;
+    }
+
+    if(in_fd != -1) close(in_fd);
+    if(pipe_fd[1] != -1) close(pipe_fd[1]);
+    in_fd = pipe_fd[0];
+  }
+
+  if(pgid == 0) { // Nothing could be started
+    set_temp_var("PIPESTATUS", join_codes(codes));
+    return codes.back();
+  }
+
+  if(bg) {
+    JobCont::add_job(pgid, cmd, JobCont::State::Running, flags, start);
+    io::print(yellow + "[Pipeline running in the background, pgid " + std::to_string(pgid) + "]\n" + reset);
+    enable_raw_mode();
+
+    pid_t last = pids.back();
+    std::thread([pgid, last, cmd]() {
+      int status, last_status = 0;
+      pid_t pid;
+      while((pid = waitpid(-pgid, &status, 0)) > 0 || (pid == -1 && errno == EINTR)) {
+        if(pid == last) last_status = status;
+      }
+
+      if(WIFSIGNALED(last_status)) {
+        JobCont::update_job(pgid, JobCont::State::Terminated);
+        io::print(orange + "[Background pipeline " + cmd + " terminated by signal " + std::to_string(WTERMSIG(last_status)) + "]\n" + reset);
+      } else {
+        JobCont::update_job(pgid, JobCont::State::Completed);
+        io::print(orange + "[Background pipeline " + cmd + " finished with exit code " + std::to_string(status_to_code(last_status)) + "]\n" + reset);
+      }
+    }).detach();
+    return 0;
+  }
+
+  size_t remaining = 0;
+  for(pid_t pid : pids) if(pid > 0) remaining++;
+
+  int last_status = 0;
+  bool stopped = false;
+  while(remaining > 0) {
+    int status;
+    pid_t pid = waitpid(-pgid, &status, WUNTRACED);
+    if(pid == -1) {
+      if(errno == EINTR) continue;
+      break;
+    }
+
+    if(WIFSTOPPED(status)) {
+      stopped = true;
+      break;
+    }
+
+    for(size_t i = 0; i < pids.size(); i++) {
+      if(pids[i] != pid) continue;
+      codes[i] = status_to_code(status);
+      if(i + 1 == pids.size()) last_status = status;
+      remaining--;
+    }
+  }
+
+  tcsetpgrp(STDIN_FILENO, getpgrp());
+
+  if(stopped) {
+    JobCont::add_job(pgid, cmd, JobCont::State::Stopped, flags, start);
+    io::print(orange + "[Process " + cmd + " stopped]\n" + reset);
+    return 0;
+  }
+
+  if(flags.time) print_elapsed_time(start);
+
+  int code = codes.back();
+  if(WIFSIGNALED(last_status) && WTERMSIG(last_status) != SIGPIPE) {
+    io::print(message(WTERMSIG(last_status), WCOREDUMP(last_status)) + "\n");
+  } else if(flags.exit_code) {
+    if(code == 0) io::print(green + "[Process exited with code 0]" + reset + "\n");
+    else io::print(red + "[Process exited with code " + std::to_string(code) + "]\n" + reset);
+  }
+
+  set_temp_var("PIPESTATUS", join_codes(codes));
+  return code;
+}
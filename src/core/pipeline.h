@@ -0,0 +1,12 @@
+#ifndef SLASH_PIPELINE_H
+#define SLASH_PIPELINE_H
+
+#include <string>
+#include <vector>
+
+// Runs "a | b | c". Every stage is parsed and resolved in the shell before anything is started,
+// the stages share one process group, and their exit statuses end up in $PIPESTATUS.
+// Returns the exit status of the last stage
+int run_pipeline(const std::vector<std::string>& stages, bool bg);
+
+#endif // SLASH_PIPELINE_H
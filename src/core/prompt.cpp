@@ -8,7 +8,7 @@
 #include <cstring>   // For strerror
 #include <optional>
 #include "../abstractions/definitions.h"
-#include "../git/git.h"
+#include "../git/git_worker.h"
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
 #include "../abstractions/json.h"
@@ -18,11 +18,14 @@
 #include "execution.h"
 
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <grp.h>
 #include "parser.h"
 #include "../cmd_highlighter.h"
 #include <algorithm>
 #include "jobs.h"
+#include "history.h"
+#include "history_search.h"
 #include "startup.h"
 #include "exiter.h"
 
@@ -62,11 +65,9 @@ std::string get_battery_interface_path() {
 
 std::string get_prompt_config_path() {
     std::string home = getenv("HOME");
-    auto settings = get_json(home + "/.slash/config/settings.json");
-    if (settings.empty()) return get_prompt_config_path();
-
+    const auto& settings = get_cached_json(home + "/.slash/config/settings.json");
     auto prompt_path = get_string(settings, "pathOfPromptTheme");
-    if (!prompt_path) return get_prompt_config_path();
+    if (!prompt_path) return home + "/.slash/config/prompts/default.json";
 
     // If path is relative, prefix home
     if (prompt_path->starts_with("/")) return *prompt_path;
@@ -101,411 +102,350 @@ SegmentStyle get_segment_style(std::string style, bool first, bool last) {
     if(last) return {"", ""};
     return {"", ""};
   }
-}
-
-// Declared here to solve circular dependency
-std::string get_jobs_segment(bool only_want_unused_or_not = false);
-std::string get_ssh_segment(bool only_want_unused_or_not = false);
-std::string get_git_segment(bool only_want_unused_or_not = false);
-
-std::vector<std::string> get_order() {
-  std::vector<std::string> default_order = {
-      "before-all", "time", "user", "group", "hostname",
-      "currentdir", "git-branch", "jobs", "ssh"
-  };
-
-  auto j = get_json(get_prompt_config_path());
-  if(j.empty()) return default_order;
 
-    std::vector<std::string> order;
-    if (j.contains("order") && j["order"].is_array()) {
-        for (auto& elm : j["order"]) {
-            if (elm.is_string()) order.push_back(elm.get<std::string>());
-        }
-    } else {
-        order = default_order;
-    }
+  return {"", ""};
+}
 
-    order.erase(std::remove_if(order.begin(), order.end(), [j](std::string s){
-      return !get_bool(j, "enabled", s).value_or(false);
-    }));
+#pragma region layout
+
+enum SegmentPosition { First, Middle, Last };
+
+// A single prompt segment with every escape sequence already rendered.
+// Only `value` runs on each draw, everything else is built once per theme load
+struct SegmentDescriptor {
+  std::string name;
+  std::string head[3]; // Before the content, indexed by SegmentPosition
+  std::string tail[3]; // After the content
+  std::string bg_as_bg; // Used by the previous segment when the style is arrow
+  std::string arrow_end;
+  bool arrow = false;
+
+  // `repaint` is set when only redrawing the segments after a late git result, nothing should be recomputed then
+  std::string (*value)(const SegmentDescriptor&, bool repaint) = nullptr; // nullptr: static_value is used
+  std::string static_value;
+
+  // Options of the dynamic segments
+  bool show_seconds = false;
+  bool use_24hr = false;
+  std::string homechar;
+  std::string separator;
+  bool shorten = false;
+  std::chrono::milliseconds git_timeout{0};
+  std::string stale_indicator;
+  bool show_ahead_behind = false;
+  bool show_dirty = false;
+};
 
-    for(auto& seg : order) {
-      if(seg == "git-branch" && get_git_segment(true) == "<UNUSED>") {
-        order.erase(std::remove_if(order.begin(), order.end(), [](std::string& s) {
-          return s == "git-branch";
-        }));
-      }
+struct PromptLayout {
+  std::string theme_path;
+  unsigned long generation = 0;
+  bool compiled = false;
 
-      if(seg == "ssh" && get_ssh_segment(true) == "<UNUSED>") {
-        order.erase(std::remove_if(order.begin(), order.end(), [](std::string& s) {
-          return s == "ssh";
-        }));
-      }
+  std::vector<SegmentDescriptor> segments;
 
-      if(seg == "jobs" && get_jobs_segment(true) == "<UNUSED>") {
-        order.erase(std::remove_if(order.begin(), order.end(), [](std::string& s) {
-          return s == "jobs";
-        }));
-      }
-    }
+  bool prompt_enabled = false;
+  bool newline_before = false;
+  std::string prompt_chars;
+  std::string prompt_segment;
+};
 
-    return order;
+std::string get_time_value(const SegmentDescriptor& seg, bool) {
+  time_t t = time(nullptr);
+  struct tm* now = localtime(&t);
+  char buffer[16];
+  if(seg.show_seconds) strftime(buffer,sizeof(buffer),seg.use_24hr?"%H:%M:%S":"%I:%M:%S %p",now);
+  else strftime(buffer,sizeof(buffer),seg.use_24hr?"%H:%M":"%I:%M %p",now);
+  return buffer;
 }
 
-std::string print_segment(std::string seg_name, std::string content, std::string after, std::string before, bool bold, std::string nerd_icon, std::array<int, 3> fg, std::array<int, 3> bg,  SegmentStyle style, std::string style_name, bool next_segment_unused) {
-  auto j = get_json(get_prompt_config_path());
-  if(j.empty()) return "";
+std::string get_cwd_value(const SegmentDescriptor& seg, bool) {
+  char buffer[PATH_MAX];
+  if(getcwd(buffer, sizeof(buffer)) == nullptr) return "<UNUSED>";
+  std::string cwd = buffer;
+  if(cwd.starts_with(home)) cwd.replace(0, home.size(), seg.homechar);
 
-  std::string bg_as_fg = rgb_to_ansi(bg, false);
-  std::string fg_as_bg = rgb_to_ansi(fg, true);
+  io::replace_all(cwd, "/", seg.separator);
+  if(seg.shorten) cwd = io::split(cwd, seg.separator).back();
+  return cwd;
+}
 
-  auto padding_enabled = get_bool(j, "enabled", "padding").value_or(true);
-  auto padding_spaces = get_int(j, "spaces", "padding").value_or(1);
+std::string get_git_value(const SegmentDescriptor& seg, bool repaint) {
+  char cwd_buffer[PATH_MAX];
+  if(getcwd(cwd_buffer, sizeof(cwd_buffer)) == nullptr) return "<UNUSED>";
 
-  std::stringstream ss;
-  if(style_name == "chip" || style_name == "chip-rectangle" || style_name == "rectangle") {
-    ss << before
-       << bg_as_fg << style.begin << reset
-       << rgb_to_ansi(fg) << rgb_to_ansi(bg, true);
-    if(padding_enabled && padding_spaces > 0) ss << std::string(padding_spaces, ' ');
-    ss << (bold ? "\x1b[1m" : "") << nerd_icon << content;
-    if(padding_enabled && padding_spaces > 0) ss << std::string(padding_spaces, ' ');
-    ss << reset
-       << bg_as_fg << style.end << reset
-       << after;
-
-  } else if(style_name == "arrow") {
-    auto order = get_order();
-    auto it = std::find(order.begin(), order.end(), seg_name);
-
-    std::array<int, 3> next_seg_bg = {256, 256, 256};
-
-    if (it != order.end() && std::next(it) != order.end()) {
-        std::string next_seg = *std::next(it);
-        next_seg_bg = get_int_array3(j, "background", next_seg).value_or(std::array<int,3>{256, 256, 256});
-    }
+  // The worker gets a short time budget, after which the last known status is shown and repainted once the real one arrives
+  bool fresh = true;
+  GitStatus status = repaint ? GitWorker::peek_status(cwd_buffer)
+                             : GitWorker::get_status(cwd_buffer, seg.git_timeout, fresh);
+  if(!status.in_repo || status.branch.empty()) return "<UNUSED>";
 
-    ss << before
-       << rgb_to_ansi(fg) << rgb_to_ansi(bg, true);
-    if(padding_enabled && padding_spaces > 0) ss << std::string(padding_spaces, ' ');
-    ss << (bold ? "\x1b[1m" : "") << nerd_icon << content;
-    if(padding_enabled && padding_spaces > 0) ss << std::string(padding_spaces, ' ');
-    ss << reset
-       << bg_as_fg;
-    if(!next_segment_unused) ss << rgb_to_ansi(next_seg_bg, true);
-    ss << style.end << reset;
-  } else {
-      ss << before << rgb_to_ansi(fg) << rgb_to_ansi(bg, true) << (bold ? "\x1b[1m" : "") << nerd_icon << content << after << reset;
+  std::string value = status.branch;
+  if(seg.show_ahead_behind) {
+    if(status.ahead > 0) value += " ↑" + std::to_string(status.ahead);
+    if(status.behind > 0) value += " ↓" + std::to_string(status.behind);
   }
-
-  return ss.str();
+  if(seg.show_dirty && status.dirty > 0) value += " ●" + std::to_string(status.dirty);
+  if(!fresh) value += seg.stale_indicator;
+  return value;
 }
 
-bool is_next_segment_unused(std::string seg_name) {
-    auto order = get_order();
-    auto it = std::find(order.begin(), order.end(), seg_name);
-
-    if(it == order.end() || std::next(it) == order.end()) return true;
-
-    std::string next_seg = *std::next(it);
-
-    if(next_seg == "git-branch" && get_git_segment() == "<UNUSED>") return true;
-    if(next_seg == "jobs" && get_jobs_segment() == "<UNUSED>") return true;
-    if(next_seg == "ssh" && get_ssh_segment() == "<UNUSED>") return true;
-
-    return false;
+std::string get_jobs_value(const SegmentDescriptor&, bool) {
+  int uncompleted_jobs = 0;
+  for(auto& job : JobCont::jobs) if(job.jobstate != JobCont::State::Completed) ++uncompleted_jobs;
+  return uncompleted_jobs == 0 ? "<UNUSED>" : std::to_string(uncompleted_jobs);
 }
 
-
-std::string get_jobs_segment(bool only_want_unused_or_not) {
-    int uncompleted_jobs = [&](){
-        int res = 0;
-        for(auto& job : JobCont::jobs) if(job.jobstate != JobCont::State::Completed) ++res;
-        return res;
-    }();
-    if(uncompleted_jobs == 0) return "<UNUSED>";
-
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","jobs").value_or(false)) return "";
-    if(only_want_unused_or_not) return "<SUCCESS>";
-
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order()[0] == "jobs";
-    auto last  = get_order().back() == "jobs";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
-
-    auto before = get_string(j,"before","jobs").value_or("");
-    auto after  = get_string(j,"after","jobs").value_or("");
-    auto fg     = get_int_array3(j,"foreground","jobs").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","jobs").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","jobs").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","jobs").value_or("");
-
-    bool next_unused = is_next_segment_unused("jobs");
-    return print_segment("jobs", std::to_string(uncompleted_jobs), after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
+std::string get_static_value(const nlohmann::json& j, const std::string& name) {
+  if(name == "before-all") return get_string(j,"chars","before-all").value_or("");
+  if(name == "user") return getenv("USER") ? getenv("USER") : "";
+  if(name == "group") {
+    struct group* grp = getgrgid(getgid());
+    return grp ? grp->gr_name : "";
+  }
+  if(name == "hostname") {
+    char hostname[256] = {};
+    gethostname(hostname, sizeof(hostname) - 1);
+    return hostname;
+  }
+  if(name == "ssh") {
+    if(!is_ssh_server()) return "<UNUSED>";
+    return get_string(j,"text","ssh").value_or("ssh");
+  }
+  return "<UNUSED>";
 }
 
+SegmentDescriptor compile_segment(const nlohmann::json& j, const std::string& name) {
+  SegmentDescriptor seg;
+  seg.name = name;
+
+  if(name == "time") {
+    seg.value = get_time_value;
+    seg.show_seconds = get_bool(j,"showSeconds","time").value_or(false);
+    seg.use_24hr = get_bool(j,"twentyfourhr","time").value_or(false);
+  } else if(name == "currentdir") {
+    seg.value = get_cwd_value;
+    seg.homechar = get_string(j,"homechar","currentdir").value_or("~");
+    seg.separator = get_string(j,"separator","currentdir").value_or("/");
+    seg.shorten = get_bool(j,"shorten","currentdir").value_or(false);
+  } else if(name == "git-branch") {
+    seg.value = get_git_value;
+    seg.git_timeout = std::chrono::milliseconds(get_int(j, "timeout", "git-branch").value_or(50));
+    seg.stale_indicator = get_string(j,"staleIndicator","git-branch").value_or(" …");
+    seg.show_ahead_behind = get_bool(j,"showAheadBehind","git-branch").value_or(true);
+    seg.show_dirty = get_bool(j,"showDirty","git-branch").value_or(true);
+  } else if(name == "jobs") {
+    seg.value = get_jobs_value;
+  } else {
+    seg.static_value = get_static_value(j, name);
+  }
 
-std::string get_ssh_segment(bool only_want_unused_or_not) {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","ssh").value_or(false) || !is_ssh_server()) return "<UNUSED>";
-    
-    if(only_want_unused_or_not) return "<SUCCESS>";
-
-    auto text = get_string(j,"text","ssh").value_or("ssh");
+  if(name == "before-all") return seg; // Printed as is, without any styling
 
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order()[0] == "ssh";
-    auto last  = get_order().back() == "ssh";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
+  // The current directory has always defaulted to the unstyled segment
+  auto style_name = get_string(j,"segment-style").value_or(name == "currentdir" ? "hardcoded" : "rectangle");
 
-    auto before = get_string(j,"before","ssh").value_or("");
-    auto after  = get_string(j,"after","ssh").value_or("");
-    auto fg     = get_int_array3(j,"foreground","ssh").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","ssh").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","ssh").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","ssh").value_or("");
+  auto before = get_string(j,"before",name).value_or("");
+  auto after  = get_string(j,"after",name).value_or("");
+  auto fg     = get_int_array3(j,"foreground",name).value_or(std::array<int,3>{256,256,256});
+  auto bg     = get_int_array3(j,"background",name).value_or(std::array<int,3>{256,256,256});
+  auto bold   = get_bool(j,"bold",name).value_or(false);
+  auto nerd_i = get_string(j,"nerd-icon",name).value_or("");
 
-    bool next_unused = is_next_segment_unused("ssh");
-    return print_segment("ssh", text, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
-}
+  auto padding_enabled = get_bool(j, "enabled", "padding").value_or(true);
+  auto padding_spaces = get_int(j, "spaces", "padding").value_or(1);
+  std::string padding = padding_enabled && padding_spaces > 0 ? std::string(padding_spaces, ' ') : "";
 
-std::string get_git_segment(bool only_want_unused_or_not) {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","git-branch").value_or(false)) return "";
-    if(only_want_unused_or_not) return "<SUCCESS>";
-
-    char cwd_buffer[PATH_MAX];
-    std::string cwd = getcwd(cwd_buffer,sizeof(cwd_buffer));
-    GitRepo repo(cwd);
-    std::string branch = repo.get_branch_name();
-    if(branch.empty()) return "<UNUSED>";
-    else if(only_want_unused_or_not) return "<SUCCESS>";
-
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order().at(0) == "git-branch";
-    auto last  = get_order().back() == "git-branch";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
-
-    auto before = get_string(j,"before","git-branch").value_or("");
-    auto after  = get_string(j,"after","git-branch").value_or("");
-    auto fg     = get_int_array3(j,"foreground","git-branch").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","git-branch").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","git-branch").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","git-branch").value_or("");
-
-    bool next_unused = is_next_segment_unused("git-branch");
-    return print_segment("git-branch", branch, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
-}
+  std::string fg_ansi = rgb_to_ansi(fg);
+  std::string bg_ansi = rgb_to_ansi(bg, true);
+  std::string bg_as_fg = rgb_to_ansi(bg, false);
+  std::string bold_ansi = bold ? "\x1b[1m" : "";
+  seg.bg_as_bg = bg_ansi;
+
+  for(int pos = First; pos <= Last; pos++) {
+    SegmentStyle style = get_segment_style(style_name, pos == First, pos == Last);
+    std::stringstream head, tail;
+
+    if(style_name == "chip" || style_name == "chip-rectangle" || style_name == "rectangle") {
+      head << before << bg_as_fg << style.begin << reset << fg_ansi << bg_ansi << padding << bold_ansi << nerd_i;
+      tail << padding << reset << bg_as_fg << style.end << reset << after;
+    } else if(style_name == "arrow") {
+      head << before << fg_ansi << bg_ansi << padding << bold_ansi << nerd_i;
+      tail << padding << reset << bg_as_fg;
+      seg.arrow = true;
+      seg.arrow_end = style.end + reset;
+    } else {
+      head << before << fg_ansi << bg_ansi << bold_ansi << nerd_i;
+      tail << after << reset;
+    }
 
-std::string get_beforeall_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","before-all").value_or(false)) return "";
+    seg.head[pos] = head.str();
+    seg.tail[pos] = tail.str();
+  }
 
-    auto characters = get_string(j,"chars","before-all").value_or("");
-    return characters;
+  return seg;
 }
 
-std::string get_time_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","time").value_or(false)) return "";
-
-    auto showSeconds = get_bool(j, "showSeconds","time").value_or(false);
-    auto use24hr = get_bool(j,"twentyfourhr","time").value_or(false);
-
-    time_t t = time(nullptr);
-    struct tm* now = localtime(&t);
-    char buffer[16];
-    if(showSeconds) strftime(buffer,sizeof(buffer),use24hr?"%H:%M:%S":"%I:%M:%S %p",now);
-    else strftime(buffer,sizeof(buffer),use24hr?"%H:%M":"%I:%M %p",now);
-
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order()[0] == "time";
-    auto last  = get_order().back() == "time";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
-
-    auto before = get_string(j,"before","time").value_or("");
-    auto after  = get_string(j,"after","time").value_or("");
-    auto fg     = get_int_array3(j,"foreground","time").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","time").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","time").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","time").value_or("");
-
-    bool next_unused = is_next_segment_unused("time");
-    return print_segment("time", buffer, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
+std::string compile_prompt_segment(const nlohmann::json& j) {
+  auto before = get_string(j,"before","prompt").value_or("");
+  auto after = get_string(j,"after","prompt").value_or("");
+  auto fg = get_int_array3(j,"foreground","prompt").value_or(std::array<int,3>{256,256,256});
+  auto bg = get_int_array3(j,"background","prompt").value_or(std::array<int,3>{256,256,256});
+  auto bold = get_bool(j,"bold","prompt").value_or(false);
+  auto newlineBefore = get_bool(j,"newlineBefore","prompt").value_or(false);
+  auto newlineAfter = get_bool(j,"newlineAfter","prompt").value_or(false);
+  auto character = get_string(j,"character","prompt").value_or(">");
+
+  std::string ansi;
+  if(fg != std::array<int,3>{256,256,256}) ansi += rgb_to_ansi(fg);
+  if(bg != std::array<int,3>{256,256,256}) ansi += rgb_to_ansi(bg,true);
+  if(bold) ansi = "\x1b[1m" + ansi;
+
+  std::stringstream out;
+  if(newlineBefore) out << "\n" << "\x1b[2K";
+    out << before
+        << ansi << character << reset
+        << after;
+  if(newlineAfter) out << "\n";
+
+  return out.str();
 }
 
-std::string get_user_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","user").value_or(false)) return "";
-
-    std::string user = getenv("USER") ? getenv("USER") : "";
+std::vector<std::string> get_order(const nlohmann::json& j) {
+  std::vector<std::string> order = {
+      "before-all", "time", "user", "group", "hostname",
+      "currentdir", "git-branch", "jobs", "ssh"
+  };
 
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order()[0] == "user";
-    auto last  = get_order().back() == "user";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
+  if (j.contains("order") && j["order"].is_array()) {
+    order.clear();
+    for (auto& elm : j["order"]) {
+      if (elm.is_string()) order.push_back(elm.get<std::string>());
+    }
+  }
 
-    auto before = get_string(j,"before","user").value_or("");
-    auto after  = get_string(j,"after","user").value_or("");
-    auto fg     = get_int_array3(j,"foreground","user").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","user").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","user").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","user").value_or("");
+  order.erase(std::remove_if(order.begin(), order.end(), [&j](const std::string& s){
+    return !get_bool(j, "enabled", s).value_or(false);
+  }), order.end());
 
-    bool next_unused = is_next_segment_unused("user");
-    return print_segment("user", user, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
+  return order;
 }
 
-std::string get_group_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","group").value_or(false)) return "";
-
-    gid_t gid = getgid();
-    struct group* grp = getgrgid(gid);
-    std::string group = grp ? grp->gr_name : "";
+// Rebuilds the layout only when the theme path changes or one of the config files was re-parsed
+const PromptLayout& get_prompt_layout() {
+  static PromptLayout layout;
 
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order()[0] == "group";
-    auto last  = get_order().back() == "group";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
+  std::string theme_path = get_prompt_config_path();
+  const auto& j = get_cached_json(theme_path);
+  unsigned long generation = get_json_cache_generation();
+  if(layout.compiled && layout.theme_path == theme_path && layout.generation == generation) return layout;
 
-    auto before = get_string(j,"before","group").value_or("");
-    auto after  = get_string(j,"after","group").value_or("");
-    auto fg     = get_int_array3(j,"foreground","group").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","group").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","group").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","group").value_or("");
-
-    bool next_unused = is_next_segment_unused("group");
-    return print_segment("group", group, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
-}
+  layout = PromptLayout{};
+  layout.theme_path = theme_path;
+  layout.generation = generation;
+  layout.compiled = true;
+  if(j.empty()) return layout;
 
-std::string get_hostname_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","hostname").value_or(false)) return "";
+  std::vector<std::string> known = {
+      "before-all", "time", "user", "group", "hostname",
+      "currentdir", "git-branch", "jobs", "ssh"
+  };
+  for(auto& name : get_order(j)) {
+    if(!io::vecContains(known, name)) continue;
+    layout.segments.push_back(compile_segment(j, name));
+  }
 
-    char hostname[256];
-    gethostname(hostname,sizeof(hostname));
+  layout.prompt_enabled = get_bool(j,"enabled","prompt").value_or(false);
+  layout.newline_before = get_bool(j,"newlineBefore","prompt").value_or(false);
+  layout.prompt_chars = get_string(j,"character","prompt").value_or("");
+  if(layout.prompt_enabled) layout.prompt_segment = compile_prompt_segment(j);
 
-    auto segmentstyle = get_string(j,"segment-style").value_or("rectangle");
-    auto first = get_order()[0] == "hostname";
-    auto last  = get_order().back() == "hostname";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
+  return layout;
+}
 
-    auto before = get_string(j,"before","hostname").value_or("");
-    auto after  = get_string(j,"after","hostname").value_or("");
-    auto fg     = get_int_array3(j,"foreground","hostname").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","hostname").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","hostname").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","hostname").value_or("");
+#pragma endregion
 
-    bool next_unused = is_next_segment_unused("hostname");
-    return print_segment("hostname", hostname, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
+std::string get_prompt_segment() {
+  return get_prompt_layout().prompt_segment;
 }
 
-std::string get_cwd_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty() || !get_bool(j,"enabled","currentdir").value_or(false)) return "";
+std::string render_segments(const PromptLayout& layout, bool repaint) {
+  // Segments that have nothing to show are dropped first, so the first/last shapes and arrow colors follow the visible ones
+  std::vector<std::pair<const SegmentDescriptor*, std::string>> visible;
+  visible.reserve(layout.segments.size());
+  for(auto& seg : layout.segments) {
+    std::string value = seg.value ? seg.value(seg, repaint) : seg.static_value;
+    if(value != "<UNUSED>") visible.emplace_back(&seg, std::move(value));
+  }
 
-    char buffer[512];
-    std::string cwd = getcwd(buffer,sizeof(buffer));
-    std::string home_str = getenv("HOME");
-    if(cwd.starts_with(home_str)) cwd.replace(0,home_str.size(), get_string(j, "homechar", "currentdir").value_or("~"));
+  std::string prompt;
+  for(size_t i = 0; i < visible.size(); i++) {
+    auto& [seg, value] = visible[i];
+    if(seg->name == "before-all") {
+      prompt += value;
+      continue;
+    }
 
-    auto segmentstyle = get_string(j,"segment-style").value_or("hardcoded");
-    auto first = get_order()[0] == "currentdir";
-    auto last  = get_order().back() == "currentdir";
-    SegmentStyle sstyle = get_segment_style(segmentstyle, first, last);
+    int pos = i == 0 ? First : (i + 1 == visible.size() ? Last : Middle);
+    prompt += seg->head[pos];
+    prompt += value;
+    prompt += seg->tail[pos];
 
-    auto before = get_string(j,"before","currentdir").value_or("");
-    auto after  = get_string(j,"after","currentdir").value_or("");
-    auto fg     = get_int_array3(j,"foreground","currentdir").value_or(std::array<int,3>{256,256,256});
-    auto bg     = get_int_array3(j,"background","currentdir").value_or(std::array<int,3>{256,256,256});
-    auto bold   = get_bool(j,"bold","currentdir").value_or(false);
-    auto nerd_i = get_string(j,"nerd-icon","currentdir").value_or("");
+    if(seg->arrow) {
+      if(i + 1 < visible.size()) prompt += visible[i + 1].first->bg_as_bg;
+      prompt += seg->arrow_end;
+    }
+  }
 
-    auto separator = get_string(j, "separator", "currentdir").value_or("/");
-    auto shorten = get_bool(j, "shorten", "currentdir").value_or(false);
+  return prompt;
+}
 
-    io::replace_all(cwd, "/", separator);
-    if(shorten) cwd = io::split(cwd, separator).back();
+void draw_prompt() {
+  const auto& layout = get_prompt_layout();
+  if(!layout.compiled) return;
 
-    bool next_unused = is_next_segment_unused("currentdir");
-    return print_segment("currentdir", cwd, after, before, bold, nerd_i, fg, bg, sstyle, segmentstyle, next_unused);
+  io::print(render_segments(layout, false) + layout.prompt_segment);
 }
 
-
-std::string get_prompt_segment() {
-    auto j = get_json(get_prompt_config_path());
-    if(j.empty()) return "";
-    if(!get_bool(j,"enabled","prompt").value_or(false)) return "";
-
-    auto before = get_string(j,"before","prompt").value_or("");
-    auto after = get_string(j,"after","prompt").value_or("");
-    auto fg = get_int_array3(j,"foreground","prompt").value_or(std::array<int,3>{256,256,256});
-    auto bg = get_int_array3(j,"background","prompt").value_or(std::array<int,3>{256,256,256});
-    auto bold = get_bool(j,"bold","prompt").value_or(false);
-    auto newlineBefore = get_bool(j,"newlineBefore","prompt").value_or(false);
-    auto newlineAfter = get_bool(j,"newlineAfter","prompt").value_or(false);
-    auto character = get_string(j,"character","prompt").value_or(">");
-
-    std::string ansi;
-    if(fg != std::array<int,3>{256,256,256}) ansi += rgb_to_ansi(fg);
-    if(bg != std::array<int,3>{256,256,256}) ansi += rgb_to_ansi(bg,true);
-    if(bold) ansi = "\x1b[1m" + ansi;
-
-    std::stringstream out;
-    if(newlineBefore) out << "\n" << "\x1b[2K";
-      out << before
-          << ansi << character << reset
-          << after;
-    if(newlineAfter) out << "\n";
-
-    return out.str();
+// Counts characters rather than bytes, so the prompt character and icons are one column each
+int visible_length(const std::string& str) {
+  int len = 0;
+  for(unsigned char c : io::strip_ansi(str)) {
+    if((c & 0xC0) != 0x80) len++;
+  }
+  return len;
 }
 
+// Called when the git worker finishes after the prompt was drawn, to redraw the segments without touching the input
+void repaint_segments(const std::string& buffer, int char_pos) {
+  const auto& layout = get_prompt_layout();
+  if(!layout.compiled) return;
 
-void draw_prompt() {
-    auto j = get_json(get_prompt_config_path());
-    if (j.empty()) return;
-    std::stringstream prompt;
-
-    for (auto& elm : get_order()) {
-        std::string seg_str;
-        if(elm == "before-all") seg_str = get_beforeall_segment();
-        else if(elm == "time") seg_str = get_time_segment();
-        else if(elm == "user") seg_str = get_user_segment();
-        else if(elm == "group") seg_str = get_group_segment();
-        else if(elm == "hostname") seg_str = get_hostname_segment();
-        else if(elm == "currentdir") seg_str = get_cwd_segment();
-        else if(elm == "git-branch") seg_str = get_git_segment();
-        else if(elm == "jobs") seg_str = get_jobs_segment();
-        else if(elm == "ssh") seg_str = get_ssh_segment();
-
-        if(seg_str != "<UNUSED>") prompt << seg_str;
-    }
+  std::string segments = render_segments(layout, true);
+  std::stringstream out;
 
+  if(layout.newline_before) {
+    int width = get_terminal_width();
+    if(width <= 0) width = 80;
 
-    io::print(prompt.str());
+    std::string prompt_line = layout.prompt_segment.substr(layout.prompt_segment.find_last_of('\n') + 1);
+    int rows_up = 1 + (visible_length(prompt_line) + char_pos) / width;
 
-    if (get_bool(j, "enabled", "prompt") == true) {
-        io::print(get_prompt_segment());
-    }
-}
+    out << "\0337" << "\x1b[" << rows_up << "A" << "\r\x1b[2K" << segments << "\0338"; // Save and restore the cursor around the repaint
+  } else {
+    out << "\r\x1b[2K" << segments << layout.prompt_segment << highl(buffer);
+    int cursor_back = buffer.length() - char_pos;
+    if(cursor_back > 0) out << "\x1b[" << cursor_back << "D";
+  }
 
+  io::print(out.str());
+}
 
 void redraw_prompt(std::string content, int char_pos = -1) { // -1: not specified
-  std::string home = getenv("HOME");
-  auto j = get_json(get_prompt_config_path());
-  if (j.empty()) return;
-
-  auto newline_before = get_bool(j, "newlineBefore", "prompt");
-  auto prompt_chars = get_string(j, "character", "prompt");
+  const auto& layout = get_prompt_layout();
+  if (layout.segments.empty() && !layout.prompt_enabled) return;
 
-  if(newline_before && *newline_before) {
-    int content_rows = (int)ceil(((double)io::strip_ansi(content).length() + io::strip_ansi(prompt_chars.value_or("")).length()) / get_terminal_width());
+  if(layout.newline_before) {
+    int content_rows = (int)ceil(((double)io::strip_ansi(content).length() + io::strip_ansi(layout.prompt_chars).length()) / get_terminal_width());
     if(content_rows == 0) {
       io::print("\r");
       io::print(get_prompt_segment() + content);
@@ -523,12 +463,63 @@ void redraw_prompt(std::string content, int char_pos = -1) { // -1: not specifie
       }
     }
   } else {
-    io::print("\x1b[2K\r");
-    draw_prompt();
+    // Same line as the input, so this runs on every keypress and must not wait for git
+    io::print("\x1b[2K\r" + render_segments(layout, true) + layout.prompt_segment);
   }
 }
 
 
+// Ctrl+R. Returns the chosen command, or the original buffer if cancelled.
+// `run` is set when Enter was pressed, so the command runs right away like in other shells
+std::string reverse_search(const std::string& buffer, bool& run) {
+  auto& search = HistorySearch::get();
+  search.reset();
+
+  std::string query;
+  size_t match_index = 0;
+  run = false;
+  char c = 0;
+
+  while(true) {
+    const auto& matches = search.search(query);
+    if(match_index >= matches.size() && !matches.empty()) match_index = matches.size() - 1;
+    std::string match = matches.empty() ? "" : std::string(search.entry(matches[match_index]));
+
+    std::string label = (!query.empty() && matches.empty() ? red + "(failing reverse-i-search)" : cyan + "(reverse-i-search)") + reset;
+    redraw_prompt(label + "`" + query + "': " + highl(match));
+
+    if(read(STDIN_FILENO, &c, 1) != 1) continue;
+
+    if(c == 3 || c == 7) return buffer; // Ctrl+C and Ctrl+G cancel
+    if(c == 18) { // Ctrl+R again goes to the next match
+      if(match_index + 1 < matches.size()) match_index++;
+      continue;
+    }
+    if(c == '\n' || c == '\r') {
+      run = !match.empty();
+      return matches.empty() ? buffer : match;
+    }
+    if(c == 127 || c == 8) {
+      if(!query.empty()) query.pop_back();
+      match_index = 0;
+      continue;
+    }
+    if(c == 27) { // Any other key leaves the search with the match in the buffer, ready to be edited
+      char seq[10];
+      int n = 0;
+      while(n < 9 && read(STDIN_FILENO, &seq[n], 1) == 1) {
+        n++;
+        if(isalpha(static_cast<unsigned char>(seq[n - 1]))) break;
+      }
+      return matches.empty() ? buffer : match;
+    }
+    if(isprint(static_cast<unsigned char>(c))) {
+      query += c;
+      match_index = 0;
+    }
+  }
+}
+
 std::variant<std::string, int> read_input(int& history_index) {
   std::string buffer = "";
   std::string backup_buffer = buffer; // To retrieve the command when browsing history if nothing was typed
@@ -537,6 +528,16 @@ std::variant<std::string, int> read_input(int& history_index) {
   char c = 0;
 
   while(true) {
+    // Wait for either a key or a late git status that needs the segments repainted
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {GitWorker::get_notify_fd(), POLLIN, 0}};
+    if(poll(fds, 2, -1) < 0) continue;
+
+    if(fds[1].revents & POLLIN) {
+      GitWorker::drain_notify_fd();
+      repaint_segments(buffer, char_pos);
+    }
+
+    if(!(fds[0].revents & (POLLIN | POLLHUP))) continue;
     if(read(STDIN_FILENO, &c, 1) != 1) continue;
 
     if(c == 3) { // Ctrl+C, discard input
@@ -571,6 +572,21 @@ std::variant<std::string, int> read_input(int& history_index) {
       continue;
     }
 
+    if(c == 18) { // Ctrl+R
+      bool run = false;
+      buffer = reverse_search(buffer, run);
+      char_pos = buffer.length();
+      history_index = -1;
+      redraw_prompt(highl(buffer), char_pos);
+      backup_buffer = buffer;
+
+      if(run) {
+        io::print("\n");
+        break;
+      }
+      continue;
+    }
+
     if(c == 12) { // Ctrl+L
       io::print("\033[H\033[2J");
       draw_prompt();
@@ -607,49 +623,27 @@ std::variant<std::string, int> read_input(int& history_index) {
 
       std::string seq_str(seq, n);
 
-      if (seq_str == "[A") {
-          const char *home = getenv("HOME");
-          auto history = io::read_file(std::string(home) + "/.slash/.slash_history");
-          if (std::holds_alternative<int>(history)) {
-              std::string err = std::string("Failed to fetch history: ") + strerror(errno);
-              info::error(err, errno, "~/.slash/.slash_history");
-              return errno;
-          }
-          std::vector<std::string> commands = io::split(std::get<std::string>(history), "\n");
-          while (!commands.empty() && commands.back().empty()) commands.pop_back();
-          if (commands.empty()) continue;
+      if (seq_str == "[A") { // Up arrow
+          auto& history = HistoryStore::get();
+          if (history.size() == 0) continue;
 
           if (history_index == -1) {
               backup_buffer = buffer; // save what was typed
               history_index = 0;       // jump into newest history
-          } else if (history_index + 1 < (int)commands.size()) {
+          } else if (history_index + 1 < (int)history.size()) {
               history_index++;
           }
 
-          std::string command = commands[commands.size() - 1 - history_index];
+          std::string command(history.from_newest(history_index));
           redraw_prompt(highl(command));
           char_pos = (int)command.length();
           buffer = command;
-} else if (seq_str == "[B") { // Down arrow
-        const char *home = getenv("HOME");
-        auto history = io::read_file(std::string(home) + "/.slash/.slash_history");
-        if (std::holds_alternative<int>(history)) {
-            std::string err = std::string("Failed to fetch history: ") + strerror(errno);
-            info::error(err, errno, "~/.slash/.slash_history");
-            return errno;
-        }
-        std::vector<std::string> commands = io::split(std::get<std::string>(history), "\n");
-        if (commands.empty()) continue;
-        while(commands.back() == "\n" || commands.back().empty()) commands.pop_back();
-
-        if (history_index < commands.size() && history_index > -1)
-            history_index--;
-        else redraw_prompt(highl(buffer));
-
-        std::string command;
-        if(history_index > -1) {
-          command = commands[commands.size() - history_index];
-        } else command = backup_buffer;
+    } else if (seq_str == "[B") { // Down arrow
+        if (history_index == -1) continue;
+        history_index--;
+
+        auto& history = HistoryStore::get();
+        std::string command = history_index > -1 ? std::string(history.from_newest(history_index)) : backup_buffer;
         redraw_prompt(highl(command));
         char_pos = (int)command.length();
         buffer = command;
@@ -7,7 +7,7 @@
 #include "../abstractions/info.h"
 #include "execution.h"
 #include "parser.h"
-#include "cnf.h"
+#include "command_table.h"
 
 void enable_canonical_mode() {
     struct termios t;
@@ -81,7 +81,7 @@ std::string interpret_escapes(const std::string& input) {
 }
 
 void execute_startup_commands() {
-  fill_commands();
+  CommandTable::refresh(true);
   auto startup_commands = io::read_file(slash_dir + "/.slashrc");
 
   if(std::holds_alternative<int>(startup_commands)) {
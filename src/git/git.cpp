@@ -51,7 +51,14 @@ std::string GitRepo::get_root_path() {
     return "";  // or throw or handle error
 }
 
-std::string GitRepo::get_file_status(std::string filepath) {
+bool GitRepo::is_ignored(const std::string& relpath) {
+  if (!repo) return false;
+  int ignored = 0;
+  if (git_ignore_path_is_ignored(&ignored, repo, relpath.c_str()) != 0) return false;
+  return ignored == 1;
+}
+
+std::string GitRepo::status_char(unsigned int status_flags) {
 
   // Characters:
   // N: Untracked
@@ -60,13 +67,7 @@ std::string GitRepo::get_file_status(std::string filepath) {
   // S: Staged
   // I: Ignored
 
-  unsigned int status_flags = 0;
-  int error = git_status_file(&status_flags, repo, filepath.c_str());
-if (error != 0) {
-    return "";
-}
-
-if (status_flags & GIT_STATUS_CURRENT) {
+if (status_flags == GIT_STATUS_CURRENT) {
     return "U";
 }
 if (status_flags & GIT_STATUS_WT_NEW) {
@@ -89,6 +90,47 @@ if (status_flags & GIT_STATUS_WT_RENAMED) {
 return "U";
 }
 
+std::string GitRepo::get_file_status(std::string filepath) {
+  unsigned int status_flags = 0;
+  int error = git_status_file(&status_flags, repo, filepath.c_str());
+  if (error != 0) {
+    return "";
+  }
+  return status_char(status_flags);
+}
+
+std::unordered_map<std::string, std::string> GitRepo::get_statuses(const std::string& subdir) {
+  std::unordered_map<std::string, std::string> statuses;
+  if (!repo) return statuses;
+
+  git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+  opts.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+  opts.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_INCLUDE_IGNORED | GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
+
+  std::string spec = subdir;
+  char* specs[] = {spec.data()};
+  if (!spec.empty()) {
+    opts.pathspec.strings = specs;
+    opts.pathspec.count = 1;
+  }
+
+  git_status_list* list = nullptr;
+  if (git_status_list_new(&list, repo, &opts) != 0) return statuses;
+
+  size_t count = git_status_list_entrycount(list);
+  statuses.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    const git_status_entry* entry = git_status_byindex(list, i);
+    const git_diff_delta* delta = entry->index_to_workdir ? entry->index_to_workdir : entry->head_to_index;
+    if (!delta) continue;
+    const char* file = delta->new_file.path ? delta->new_file.path : delta->old_file.path;
+    if (file) statuses[file] = status_char(entry->status);
+  }
+
+  git_status_list_free(list);
+  return statuses;
+}
+
 std::vector<std::pair<std::string, std::string>> GitRepo::get_file_changes(std::string filepath) {
     if(get_file_status(filepath) == "N") {
       info::error("File is not tracked.");
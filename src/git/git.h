@@ -3,6 +3,7 @@
 
 #include <git2.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class GitRepo {
@@ -10,13 +11,21 @@ class GitRepo {
   git_repository* repo;
   std::string path;
 
+  static std::string status_char(unsigned int status_flags);
+
   public:
   GitRepo(std::string repo_path);
   ~GitRepo();
 
   bool has_git_repo();
   std::string get_root_path();
+  // Whether the ignore rules leave relpath out. It's relative to the root, with a trailing "/" for directories.
+  // A repo handle can't be shared between threads, so each thread asking needs its own GitRepo
+  bool is_ignored(const std::string& relpath);
   std::string get_file_status(std::string filepath);
+  // Status of every file that isn't unmodified, by path relative to the root, from one pass over the repo.
+  // Untracked and ignored directories show up once, as "dir/". With a subdir, only that part is looked at
+  std::unordered_map<std::string, std::string> get_statuses(const std::string& subdir = "");
   std::vector<std::pair<std::string, std::string>> get_file_changes(std::string filepath);
   std::string get_branch_name();
 
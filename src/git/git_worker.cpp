@@ -0,0 +1,145 @@
+#include "git_worker.h"
+
+#include <git2.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+namespace {
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  bool started = false;
+  int notify_pipe[2] = {-1, -1};
+
+  std::string pending_cwd;
+  unsigned long requested_id = 0;
+  unsigned long done_id = 0;
+  bool notify_when_done = false;
+
+  std::unordered_map<std::string, GitStatus> statuses; // cwd -> last known status
+
+  // Only touched by the worker thread
+  std::unordered_map<std::string, git_repository*> repos; // git dir -> open repository
+
+  git_repository* open_repo(const std::string& cwd) {
+    git_buf gitdir = GIT_BUF_INIT;
+    if(git_repository_discover(&gitdir, cwd.c_str(), 0, nullptr) != 0) return nullptr;
+    std::string key(gitdir.ptr, gitdir.size);
+    git_buf_dispose(&gitdir);
+
+    auto it = repos.find(key);
+    if(it != repos.end()) return it->second;
+
+    git_repository* repo = nullptr;
+    if(git_repository_open(&repo, key.c_str()) != 0) return nullptr;
+    repos[key] = repo;
+    return repo;
+  }
+
+  GitStatus compute_status(const std::string& cwd) {
+    GitStatus status;
+    git_repository* repo = open_repo(cwd);
+    if(!repo) return status;
+
+    git_reference* head = nullptr;
+    if(git_repository_head(&head, repo) != 0) return status; // Unborn branch, nothing to show yet
+
+    const char* branch_name = nullptr;
+    if(git_branch_name(&branch_name, head) != 0 || !branch_name) { // Detached HEAD
+      git_reference_free(head);
+      return status;
+    }
+    status.in_repo = true;
+    status.branch = branch_name;
+
+    git_reference* upstream = nullptr;
+    if(git_branch_upstream(&upstream, head) == 0) {
+      const git_oid* local = git_reference_target(head);
+      const git_oid* remote = git_reference_target(upstream);
+      if(local && remote) git_graph_ahead_behind(&status.ahead, &status.behind, repo, local, remote);
+      git_reference_free(upstream);
+    }
+    git_reference_free(head);
+
+    git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+    opts.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+    opts.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
+
+    git_status_list* list = nullptr;
+    if(git_status_list_new(&list, repo, &opts) == 0) {
+      status.dirty = git_status_list_entrycount(list);
+      git_status_list_free(list);
+    }
+
+    return status;
+  }
+
+  void run() {
+    git_libgit2_init();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+      cv.wait(lock, []{ return requested_id != done_id; });
+
+      std::string cwd = pending_cwd;
+      unsigned long id = requested_id;
+
+      lock.unlock();
+      GitStatus status = compute_status(cwd);
+      lock.lock();
+
+      statuses[cwd] = status;
+      done_id = id;
+      cv.notify_all();
+
+      if(notify_when_done && done_id == requested_id) {
+        notify_when_done = false;
+        char c = 1;
+        write(notify_pipe[1], &c, 1);
+      }
+    }
+  }
+
+  void start() {
+    if(started) return;
+    started = true;
+
+    if(pipe2(notify_pipe, O_NONBLOCK | O_CLOEXEC) != 0) notify_pipe[0] = notify_pipe[1] = -1;
+    std::thread(run).detach();
+  }
+}
+
+GitStatus GitWorker::get_status(const std::string& cwd, std::chrono::milliseconds budget, bool& fresh) {
+  std::unique_lock<std::mutex> lock(mutex);
+  start();
+
+  unsigned long id = ++requested_id;
+  pending_cwd = cwd;
+  cv.notify_all();
+
+  fresh = cv.wait_for(lock, budget, [id]{ return done_id >= id; });
+  if(!fresh) notify_when_done = notify_pipe[1] != -1;
+
+  auto it = statuses.find(cwd);
+  return it != statuses.end() ? it->second : GitStatus{};
+}
+
+GitStatus GitWorker::peek_status(const std::string& cwd) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = statuses.find(cwd);
+  return it != statuses.end() ? it->second : GitStatus{};
+}
+
+int GitWorker::get_notify_fd() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return notify_pipe[0];
+}
+
+void GitWorker::drain_notify_fd() {
+  char buffer[64];
+  while(read(notify_pipe[0], buffer, sizeof(buffer)) > 0);
+}
@@ -0,0 +1,31 @@
+#ifndef SLASH_GIT_WORKER_H
+#define SLASH_GIT_WORKER_H
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+
+struct GitStatus {
+  bool in_repo = false;
+  std::string branch;
+  size_t ahead = 0;
+  size_t behind = 0;
+  size_t dirty = 0; // Changed, staged and untracked files
+};
+
+// Computes git status for the prompt on a background thread.
+// Repositories are opened once and kept open for the lifetime of the shell
+namespace GitWorker {
+  // Asks for a refresh of the repository containing `cwd` and waits up to `budget` for it.
+  // If the worker doesn't finish in time, the last known status is returned with `fresh` set to false,
+  // and the notify fd becomes readable once the refresh is done
+  GitStatus get_status(const std::string& cwd, std::chrono::milliseconds budget, bool& fresh);
+
+  // Returns the last known status without asking for a refresh
+  GitStatus peek_status(const std::string& cwd);
+
+  int get_notify_fd(); // -1 until the worker is started
+  void drain_notify_fd();
+}
+
+#endif // SLASH_GIT_WORKER_H
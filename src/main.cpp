@@ -2,9 +2,12 @@
 #include "core/prompt.h"
 #include "core/startup.h"
 #include "core/parser.h"
+#include "core/command_table.h"
+#include "cmd_highlighter.h"
 #include "abstractions/json.h"
 
 #include "builtin-cmds/cd.h"
+#include "builtin-cmds/alias.h"
 
 #include <signal.h>
 
@@ -39,7 +42,7 @@ int main(int argc, char* argv[]) {
 
         auto original_args = args;
         args = parse_arguments(io::join(args, " "));
-        save_to_history(args, io::join(args, " "));
+        save_to_history(io::join(args, " "));
 
         exec(args, io::join(original_args, " "));
         return 0;
@@ -48,12 +51,17 @@ int main(int argc, char* argv[]) {
     execute_startup_commands();
     enable_raw_mode();
 
+    // Commands that don't exist are highlighted as you type them
+    set_command_checker([](const std::string& cmd) {
+        return CommandTable::is_builtin(cmd) || !CommandTable::lookup(cmd, false).empty() || get_alias(cmd, false) != "UNKNOWN";
+    });
+
     while(true) {
         std::string input = print_prompt(cnt);
         if(input.empty() || input.starts_with("#")) continue;
 
         std::vector<std::string> args = parse_arguments(input);
-        if(!args.empty()) save_to_history(args, input);
+        if(!args.empty()) save_to_history(input);
 
         exec(args, input);
 
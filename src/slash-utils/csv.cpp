@@ -1,83 +1,171 @@
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
+#include "../abstractions/csv.h"
+#include "../tui/tui.h"
 
 
 #include <vector>
 #include <string>
-#include <regex>
+#include <unistd.h>
 #include "../help_helper.h"
 
+// Rows read to size the columns unless --exact is given. Cells in later rows that are wider than
+// their column get cut short with a …
+const size_t SAMPLE_ROWS = 1000;
+
 class Csv {
   private:
-  
-std::string strip_ansi(const std::string& str) {
-    static const std::regex ansi_regex("\x1B\\[[0-9;]*[mK]");
-    return std::regex_replace(str, ansi_regex, "");
-}
-
-std::string print_csv_table(std::string csv, std::string separator) {
-    csv = io::trim(csv);
-    std::vector<std::vector<std::string>> table;
-    auto rows = io::split(csv, "\n");
-    for (auto& row : rows) {
-        table.push_back(io::split(row, separator));
-    }
-
-    if (table.empty()) return "";
-
-    int cols = table[0].size();
-    std::vector<int> col_widths(cols, 0);
-
-    // Calculate max width per column (using visible length)
-    for (auto& row : table) {
-        for (int i = 0; i < cols; i++) {
-            if (i < row.size()) {
-                int len = strip_ansi(row[i]).length();
-                if (len > col_widths[i])
-                    col_widths[i] = len;
-            }
+
+  std::string out; // Written out in big pieces instead of a write() per cell
+
+  void flush(bool force = false) {
+    if (!force && out.size() < 64 * 1024) return;
+    io::print(out);
+    out.clear();
+  }
+
+  // Quoted fields can have newlines in them, which would break the table. Most cells have none and are
+  // used as they are, the rest are copied into scratch
+  static std::string_view displayed(std::string_view cell, std::string& scratch) {
+    if (cell.find_first_of("\r\n") == std::string_view::npos) return cell;
+    scratch.clear();
+    for (char c : cell) {
+      if (c == '\n') scratch += "↵";
+      else if (c != '\r') scratch += c;
+    }
+    return scratch;
+  }
+
+  // Plain ASCII, which most cells are, is one column per byte
+  static int visible_width(std::string_view cell) {
+    for (unsigned char c : cell) {
+      if (c < 0x20 || c >= 0x7F) return Tui::Screen::text_width(cell);
+    }
+    return cell.size();
+  }
+
+  static bool is_blank(const std::vector<std::string_view>& fields) {
+    return fields.size() == 1 && fields[0].empty();
+  }
+
+  // Pads cell to width, or cuts it at width - 1 columns and puts a … there
+  void add_cell(std::string_view cell, int width) {
+    int visible = visible_width(cell);
+    if (visible <= width) {
+      out += cell;
+      out.append(width - visible, ' ');
+      return;
+    }
+
+    int col = 0;
+    bool styled = false;
+    for (size_t i = 0; i < cell.size();) {
+      // Colours carry through, only text is cut
+      if (cell[i] == '\x1b') {
+        styled = true;
+        size_t end = i + 1;
+        if (end < cell.size() && cell[end] == '[') {
+          end++;
+          while (end < cell.size() && !(cell[end] >= 0x40 && cell[end] <= 0x7E)) end++;
         }
+        end = std::min(end + 1, cell.size());
+        out += cell.substr(i, end - i);
+        i = end;
+        continue;
+      }
+
+      size_t len = 1;
+      while (i + len < cell.size() && (cell[i + len] & 0xC0) == 0x80) len++;
+      int w = Tui::Screen::text_width(cell.substr(i, len));
+      if (col + w > width - 1) break;
+      out += cell.substr(i, len);
+      col += w;
+      i += len;
     }
+    if (styled) out += reset; // So the … isn't in whatever colour the cell left on
+    out += "…" + std::string(width - 1 - col, ' ');
+  }
+
+  void add_row(const std::vector<std::string_view>& cells, const std::vector<int>& col_widths, bool header) {
+    std::string scratch;
+    for (size_t j = 0; j < col_widths.size(); j++) {
+      if (header) out += green;
+      add_cell(j < cells.size() ? displayed(cells[j], scratch) : "", col_widths[j]);
+      if (header) out += reset;
+      if (j < col_widths.size() - 1) out += header ? green + " │ " + reset : " │ ";
+    }
+    out += "\n";
+    flush();
+  }
+
+  // Streams the table out: the columns are sized from the first SAMPLE_ROWS rows, or from all of them
+  // with exact, which reads the input twice
+  int print_csv_table(io::CsvReader& reader, bool exact) {
+    std::vector<std::string_view> fields;
+    std::vector<std::vector<std::string>> sample; // Rows read while sizing, header first
+    std::vector<int> col_widths;
+    std::string scratch;
+
+    auto measure = [&]() {
+      for (size_t i = 0; i < col_widths.size() && i < fields.size(); i++) {
+        col_widths[i] = std::max(col_widths[i], visible_width(displayed(fields[i], scratch)));
+      }
+    };
+
+    while (sample.size() < (exact ? 1 : SAMPLE_ROWS) && reader.next_row(fields)) {
+      if (is_blank(fields)) continue;
+      sample.emplace_back(fields.begin(), fields.end());
+      if (sample.size() == 1) col_widths.assign(fields.size(), 1); // At least room for a …
+      measure();
+    }
+
+    if (exact) {
+      while (reader.next_row(fields)) {
+        if (!is_blank(fields)) measure();
+      }
+      reader.rewind();
+    }
+
+    if (!reader.ok()) {
+      info::error("Failed to read file: " + std::string(strerror(reader.error())), reader.error());
+      return reader.error();
+    }
+    if (sample.empty()) return 0;
 
     // Calculate total width including separators " │ " (3 chars each)
+    int cols = col_widths.size();
     int total_width = 0;
     for (int w : col_widths) total_width += w;
     total_width += 3 * (cols - 1);
 
-    // Print top border
-    for (int i = 0; i < total_width; i++) io::print(green + "─" + reset);
-    io::print("\n");
-
-    // Print header row
-    for (int j = 0; j < cols; j++) {
-        std::string cell = j < table[0].size() ? table[0][j] : "";
-        int visible_len = strip_ansi(cell).length();
-        io::print(green + cell + std::string(col_widths[j] - visible_len, ' ') + reset);
-        if (j < cols - 1) io::print(green + " │ " + reset);
-    }
-    io::print("\n");
-
-    // Print header separator
-    for (int i = 0; i < total_width; i++) io::print(green + "─" + reset);
-    io::print("\n");
-
-    // Print remaining rows
-    for (int i = 1; i < table.size(); i++) {
-        for (int j = 0; j < cols; j++) {
-            std::string cell = j < table[i].size() ? table[i][j] : "";
-            int visible_len = strip_ansi(cell).length();
-            io::print(cell + std::string(col_widths[j] - visible_len, ' '));
-            if (j < cols - 1) io::print(" │ ");
-        }
-        io::print("\n");
+    std::string border;
+    for (int i = 0; i < total_width; i++) border += "─";
+
+    // With exact only the header is kept and the rest is read again from the start
+    if (exact) {
+      while (reader.next_row(fields) && is_blank(fields));
     }
 
-    // Print bottom border
-    for (int i = 0; i < total_width; i++) io::print("─");
-    io::print("\n");
+    out += green + border + reset + "\n";
+    for (size_t i = 0; i < sample.size(); i++) {
+      add_row(std::vector<std::string_view>(sample[i].begin(), sample[i].end()), col_widths, i == 0);
+      if (i == 0) out += green + border + reset + "\n";
+    }
+    sample.clear();
 
-    return "";
-}
+    while (reader.next_row(fields)) {
+      if (!is_blank(fields)) add_row(fields, col_widths, false);
+    }
+
+    out += border + "\n";
+    flush(true);
+
+    if (!reader.ok()) {
+      info::error("Failed to read file: " + std::string(strerror(reader.error())), reader.error());
+      return reader.error();
+    }
+    return 0;
+  }
 
 
   public:
@@ -93,11 +181,13 @@ std::string print_csv_table(std::string csv, std::string separator) {
           },
           {
             {"-s", "--separator", "Specifies the separator " + yellow + "(NOTE: Use \\| and \\; for these two delimiters)" + reset},
-            {"-t", "--text", "The next argument is text (useful for piping)"}
+            {"-t", "--text", "The next argument is text (useful for piping)"},
+            {"-e", "--exact", "Sizes columns to fit every row instead of the first " + std::to_string(SAMPLE_ROWS) + ", reading the input twice"}
           },
           {
             {"csv table.csv", "Prints table for table.csv data"},
-            {"csv -s ; table.csv", "Prints table, knowing the separator is ;"}
+            {"csv -s ; table.csv", "Prints table, knowing the separator is ;"},
+            {"csv -e export.csv", "Prints table with no cells cut short"}
           },
           "",
           ""
@@ -106,20 +196,19 @@ std::string print_csv_table(std::string csv, std::string separator) {
       }
 
       std::vector<std::string> valid_args = {
-        "-s", "-t",
-        "--separator", "--text"
+        "-s", "-t", "-e",
+        "--separator", "--text", "--exact"
       };
 
       bool is_text = false;
+      bool exact = false;
       std::string separator = ",";
       std::string arg;
 
     for (size_t i = 0; i < args.size(); ++i) {
         const std::string& current = args[i];
 
-        if (current.starts_with("-") &&
-            current != "-s" && current != "--separator" &&
-            current != "-t" && current != "--text") {
+        if (current.starts_with("-") && !io::vecContains(valid_args, current)) {
             info::error("Invalid argument \"" + current + "\"\n");
             return EINVAL;
         }
@@ -133,6 +222,15 @@ std::string print_csv_table(std::string csv, std::string separator) {
             separator = args[++i]; // use the next argument
             if (separator == "\\|") separator = "|";
             else if (separator == "\\;") separator = ";";
+            if (separator.size() != 1) {
+                info::error("Separator has to be a single character");
+                return EINVAL;
+            }
+            continue;
+        }
+
+        if (current == "-e" || current == "--exact") {
+            exact = true;
             continue;
         }
 
@@ -153,18 +251,21 @@ std::string print_csv_table(std::string csv, std::string separator) {
         }
     }
 
-    std::string content;
-    if(is_text) content = arg;
-    else {
-      auto cnt = io::read_file(arg);
-      if(!std::holds_alternative<std::string>(cnt)) {
-        info::error("Failed to read file: " + std::string(strerror(errno)), errno);
-        return errno;
-      }
-      content = std::get<std::string>(cnt);
+    if(is_text) {
+      io::CsvReader reader(io::CsvReader::Text{arg}, separator[0]);
+      return print_csv_table(reader, exact);
     }
-    io::print(print_csv_table(content, separator));
-    return 0;
+
+    io::CsvReader reader(arg, separator[0], exact);
+    if(!reader.ok()) {
+      info::error("Failed to read file: " + std::string(strerror(reader.error())), reader.error());
+      return reader.error();
+    }
+    if(exact && !reader.seekable()) {
+      info::error("--exact needs a regular file, " + arg + " can only be read once");
+      return EINVAL;
+    }
+    return print_csv_table(reader, exact);
   }
 };
 
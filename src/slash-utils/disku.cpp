@@ -7,14 +7,394 @@
 #include <string>
 #include <sys/statvfs.h>
 
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "../abstractions/info.h"
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/definitions.h"
+#include "../abstractions/filestream.h"
+#include "../abstractions/walker.h"
+#include "../abstractions/watcher.h"
 #include "../help_helper.h"
 #include <algorithm>
 
+// One row of the tree disku builds while scanning. Directories are filled in concurrently by the
+// workers and finish once all of their subdirectories have
+struct UsageNode {
+  std::string name;
+  bool is_dir = false;
+  std::atomic<uint64_t> bytes{0};  // Used on disk by this entry and everything below it
+  std::atomic<uint64_t> own{0};    // Only by the directory itself and the files directly in it
+  std::atomic<size_t> pending{1};  // This directory being read, plus each subdirectory that isn't finished
+  bool done = false;               // Guarded by the scan's mutex
+  dev_t dev = 0;                   // For the index, directories only
+  ino_t ino = 0;
+  struct timespec mtime{};
+  UsageNode* parent = nullptr;
+  std::vector<std::unique_ptr<UsageNode>> children; // Subdirectories, and for the root also the files in it
+};
+
+// (dev, inode) pairs of hardlinked files that were already counted. Sharded so the workers rarely
+// wait on each other, and only files with more than one link ever get in here
+class InodeSet {
+  private:
+  struct Hash {
+    size_t operator()(const std::pair<dev_t, ino_t>& key) const {
+      return std::hash<uint64_t>()(key.second * 31 + key.first);
+    }
+  };
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_set<std::pair<dev_t, ino_t>, Hash> inodes;
+  };
+  static const size_t SHARDS = 64;
+  Shard shards[SHARDS];
+
+  public:
+  bool insert(dev_t dev, ino_t ino) { // False if it was already there
+    Shard& shard = shards[ino % SHARDS];
+    std::lock_guard lock(shard.mutex);
+    return shard.inodes.insert({dev, ino}).second;
+  }
+};
+
+#pragma region index
+
+// The usage index, kept in ~/.slash/cache/disku/ with one file per scanned directory. It's plain text:
+//
+//   slash-disku-index 1
+//   root <absolute path that was scanned>
+//   one-file-system <0 or 1>
+//   <dev> <inode> <mtime sec> <mtime nsec> <own bytes> <total bytes> <path>
+//   ...
+//
+// with one line per directory, parents before their children. <path> is relative to the root ("." for
+// the root itself, "./a/b" below it), with "\n" and "\\" escaped. <own bytes> covers the directory and
+// the files directly in it, <total bytes> everything below it and is only there for people reading it.
+//
+// A directory whose dev, inode and mtime still match isn't read again: its own bytes and subdirectories
+// come from the index, and only the subdirectories are checked. A directory's mtime changes when entries
+// are added, removed or renamed in it, but not when a file in it grows, which is what --rescan is for
+struct IndexEntry {
+  dev_t dev = 0;
+  ino_t ino = 0;
+  struct timespec mtime{};
+  uint64_t own = 0;
+  std::vector<std::string> subdirs; // Names
+};
+
+class UsageIndex {
+  private:
+  static std::string escape(const std::string& s) {
+    std::string out;
+    for(char c : s) {
+      if(c == '\\') out += "\\\\";
+      else if(c == '\n') out += "\\n";
+      else out += c;
+    }
+    return out;
+  }
+
+  static std::string unescape(const std::string& s) {
+    std::string out;
+    for(size_t i = 0; i < s.size(); i++) {
+      if(s[i] == '\\' && i + 1 < s.size()) {
+        out += s[i + 1] == 'n' ? '\n' : s[i + 1];
+        i++;
+      } else out += s[i];
+    }
+    return out;
+  }
+
+  void write_node(std::string& out, const UsageNode& node, const std::string& rel) const {
+    out += std::to_string(node.dev) + " " + std::to_string(node.ino) + " "
+      + std::to_string(node.mtime.tv_sec) + " " + std::to_string(node.mtime.tv_nsec) + " "
+      + std::to_string(node.own.load()) + " " + std::to_string(node.bytes.load()) + " "
+      + (rel.empty() ? "." : "./" + escape(rel)) + "\n";
+
+    for(auto& child : node.children) {
+      if(child->is_dir) write_node(out, *child, rel.empty() ? child->name : rel + "/" + child->name);
+    }
+  }
+
+  public:
+  std::unordered_map<std::string, IndexEntry> dirs; // By path relative to the root, "" for the root
+  bool one_file_system = false;
+
+  static std::string file_for(const std::string& root) {
+    return slash_dir + "/cache/disku/" + std::to_string(std::hash<std::string>()(root)) + ".idx";
+  }
+
+  // False if there's no index for this root yet or it can't be used
+  bool load(const std::string& root) {
+    dirs.clear();
+    io::FileView file(file_for(root));
+    if(!file.ok()) return false;
+
+    std::vector<std::string> order;
+    size_t line_no = 0;
+    for(std::string_view line : io::Lines(file.view())) {
+      line_no++;
+      if(line_no == 1) {
+        if(line != "slash-disku-index 1") return false;
+        continue;
+      }
+      if(line_no == 2) {
+        if(line != "root " + root) return false; // Hash collision
+        continue;
+      }
+      if(line_no == 3) {
+        one_file_system = line == "one-file-system 1";
+        continue;
+      }
+
+      std::istringstream ss{std::string(line)};
+      IndexEntry entry;
+      uint64_t total;
+      std::string path;
+      if(!(ss >> entry.dev >> entry.ino >> entry.mtime.tv_sec >> entry.mtime.tv_nsec >> entry.own >> total)) return false;
+      ss.get();
+      std::getline(ss, path);
+      path = unescape(path);
+      if(path == ".") path = "";
+      else if(path.starts_with("./")) path = path.substr(2);
+      else return false;
+
+      order.push_back(path);
+      dirs[path] = std::move(entry);
+    }
+
+    for(auto& path : order) {
+      if(path.empty()) continue;
+      size_t slash = path.rfind('/');
+      std::string parent = slash == std::string::npos ? "" : path.substr(0, slash);
+      auto it = dirs.find(parent);
+      if(it != dirs.end()) it->second.subdirs.push_back(path.substr(slash == std::string::npos ? 0 : slash + 1));
+    }
+    return !dirs.empty();
+  }
+
+  // Same as saving the tree and loading it back
+  void load(const UsageNode& root, bool one_file_system) {
+    dirs.clear();
+    this->one_file_system = one_file_system;
+
+    std::vector<std::pair<const UsageNode*, std::string>> stack = {{&root, ""}};
+    while(!stack.empty()) {
+      auto [node, rel] = stack.back();
+      stack.pop_back();
+
+      IndexEntry& entry = dirs[rel];
+      entry.dev = node->dev;
+      entry.ino = node->ino;
+      entry.mtime = node->mtime;
+      entry.own = node->own;
+      for(auto& child : node->children) {
+        if(!child->is_dir) continue;
+        entry.subdirs.push_back(child->name);
+        stack.push_back({child.get(), rel.empty() ? child->name : rel + "/" + child->name});
+      }
+    }
+  }
+
+  // Written next to the old one and renamed over it, so a crash never leaves half an index behind
+  bool save(const std::string& root, const UsageNode& node, bool one_file_system) const {
+    std::string dir = slash_dir + "/cache/disku";
+    for(const std::string& d : {slash_dir, slash_dir + "/cache", dir}) {
+      if(mkdir(d.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+
+    std::string out = "slash-disku-index 1\nroot " + root + "\none-file-system " + (one_file_system ? "1" : "0") + "\n";
+    write_node(out, node, "");
+
+    std::string path = file_for(root);
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) return false;
+    size_t written = 0;
+    while(written < out.size()) {
+      ssize_t n = write(fd, out.data() + written, out.size() - written);
+      if(n < 0 && errno == EINTR) continue;
+      if(n <= 0) break;
+      written += n;
+    }
+    bool ok = written == out.size();
+    close(fd);
+    if(!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+      unlink(tmp.c_str());
+      return false;
+    }
+    return true;
+  }
+};
+
+#pragma endregion
+
 class Disku {
   private:
+    struct ScanOptions {
+      unsigned threads = 0;
+      bool one_file_system = false;
+    };
+
+    // Everything the workers share during a scan
+    struct Scan {
+      UsageNode root;
+      dev_t root_dev = 0;
+      ScanOptions options;
+      InodeSet seen;
+      std::string root_path;
+      const UsageIndex* index = nullptr;                  // Directories that didn't change since are taken from here
+      const std::unordered_set<std::string>* dirty = nullptr; // Read again even if they look unchanged
+      std::atomic<size_t> reused{0};
+
+      std::mutex mutex; // Guards everything below, and is what cv waits with
+      std::condition_variable cv;
+      bool listed = false; // The root has been read, root.children is complete
+      bool done = false;
+      std::vector<std::string> errors; // Printed after the table, so they don't end up in the middle of it
+    };
+
+    // Called when a directory and everything below it has been counted. Its total goes up
+    // into the parent, which may finish in turn
+    void finish(Scan& scan, UsageNode* node) {
+      while(node != nullptr && node->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        UsageNode* parent = node->parent;
+        if(parent != nullptr) parent->bytes.fetch_add(node->bytes.load(), std::memory_order_relaxed);
+
+        if(node == &scan.root || parent == &scan.root) {
+          std::lock_guard lock(scan.mutex);
+          node->done = true;
+          scan.cv.notify_all();
+        }
+        node = parent;
+      }
+    }
+
+    void scan_tree(Scan& scan, const std::string& dirpath) {
+      walk::Options options;
+      options.threads = scan.options.threads;
+
+      options.visit = [&](walk::Entry& entry, unsigned) {
+        UsageNode* dir = static_cast<UsageNode*>(entry.dir_data);
+        const struct stat* st = entry.stat();
+        if(st == nullptr) {
+          std::lock_guard lock(scan.mutex);
+          scan.errors.push_back("Failed to stat: " + entry.path() + " (" + strerror(entry.stat_error()) + ")");
+          return false;
+        }
+
+        if(S_ISDIR(st->st_mode)) {
+          if(scan.options.one_file_system && st->st_dev != scan.root_dev) return false;
+
+          auto child = std::make_unique<UsageNode>();
+          child->name = entry.name;
+          child->is_dir = true;
+          child->parent = dir;
+          child->bytes = st->st_blocks * 512ULL;
+          child->own = st->st_blocks * 512ULL;
+          child->dev = st->st_dev;
+          child->ino = st->st_ino;
+          child->mtime = st->st_mtim;
+          dir->pending.fetch_add(1, std::memory_order_relaxed);
+
+          entry.child_data = child.get();
+          dir->children.push_back(std::move(child)); // Only this worker reads this directory, so no lock
+          return true;
+        }
+
+        // Every name of a hardlinked file points at the same blocks, only the first one found counts them
+        bool counted = st->st_nlink > 1 && !scan.seen.insert(st->st_dev, st->st_ino);
+        uint64_t bytes = counted ? 0 : st->st_blocks * 512ULL;
+        dir->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        dir->own.fetch_add(bytes, std::memory_order_relaxed);
+
+        if(dir == &scan.root) { // Files at the top get their own row
+          auto child = std::make_unique<UsageNode>();
+          child->name = entry.name;
+          child->parent = dir;
+          child->bytes = bytes;
+          child->pending = 0;
+          child->done = true;
+          dir->children.push_back(std::move(child));
+        }
+        return false;
+      };
+
+      options.error = [&](const std::string& path, int err) {
+        std::lock_guard lock(scan.mutex);
+        scan.errors.push_back("Failed to open dir: " + path + " (" + strerror(err) + ")");
+      };
+
+      options.expand = [&](const std::string& path, void* data, std::vector<walk::Subdir>& subdirs) {
+        UsageNode* node = static_cast<UsageNode*>(data);
+        if(scan.index == nullptr || node == &scan.root) return false; // The root is always read, for the table
+
+        if(node->ino == 0) { // Its parent came from the index too, so nobody has looked at it yet
+          struct stat st;
+          if(lstat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+          node->dev = st.st_dev;
+          node->ino = st.st_ino;
+          node->mtime = st.st_mtim;
+          node->own = st.st_blocks * 512ULL;
+          node->bytes = st.st_blocks * 512ULL;
+        }
+
+        std::string rel = path.substr(scan.root_path.size());
+        if(rel.starts_with("/")) rel.erase(0, 1);
+        if(scan.dirty && scan.dirty->contains(rel)) return false;
+
+        auto it = scan.index->dirs.find(rel);
+        if(it == scan.index->dirs.end()) return false;
+        const IndexEntry& cached = it->second;
+        if(cached.dev != node->dev || cached.ino != node->ino || cached.mtime.tv_sec != node->mtime.tv_sec
+          || cached.mtime.tv_nsec != node->mtime.tv_nsec) return false;
+
+        node->own = cached.own;
+        node->bytes = cached.own;
+        for(auto& name : cached.subdirs) {
+          auto child = std::make_unique<UsageNode>();
+          child->name = name;
+          child->is_dir = true;
+          child->parent = node;
+          node->pending.fetch_add(1, std::memory_order_relaxed);
+          subdirs.push_back({path + "/" + name, child.get()});
+          node->children.push_back(std::move(child));
+        }
+        scan.reused.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      };
+
+      options.leave = [&](void* data) {
+        UsageNode* node = static_cast<UsageNode*>(data);
+        if(node == &scan.root) {
+          std::lock_guard lock(scan.mutex);
+          scan.listed = true;
+          scan.cv.notify_all();
+        }
+        finish(scan, node);
+      };
+
+      if(walk::parallel_walk(dirpath, options, &scan.root) != 0) {
+        std::lock_guard lock(scan.mutex);
+        scan.listed = true;
+        scan.root.done = true;
+      }
+
+      std::lock_guard lock(scan.mutex);
+      scan.done = true;
+      scan.cv.notify_all();
+    }
+
     std::string get_type(std::string name) {
       std::vector<std::string> videos = {
           ".mp4", ".mkv", ".mov", ".mpg", ".mpeg", ".avi", ".flv", ".wmv", ".webm", ".vob",
@@ -92,7 +472,7 @@ class Disku {
       return st.f_blocks * st.f_frsize;
     }
 
-    std::vector<std::vector<int>> get_dir_usages(std::string dirpath, bool no_dirs) {
+    std::vector<std::vector<uint64_t>> get_dir_usages(std::string dirpath, bool no_dirs) {
       DIR* dir = opendir(dirpath.c_str());
       if(dir == nullptr) {
         std::string error = std::string("Failed to open dir: ") + strerror(errno);
@@ -100,13 +480,13 @@ class Disku {
         return {};
       }
 
-      std::vector<int> videos;
-      std::vector<int> audios;
-      std::vector<int> images;
-      std::vector<int> documents;
-      std::vector<int> code;
-      std::vector<int> archive;
-      std::vector<int> other;
+      std::vector<uint64_t> videos;
+      std::vector<uint64_t> audios;
+      std::vector<uint64_t> images;
+      std::vector<uint64_t> documents;
+      std::vector<uint64_t> code;
+      std::vector<uint64_t> archive;
+      std::vector<uint64_t> other;
 
 
       struct dirent* entry;
@@ -130,7 +510,7 @@ class Disku {
 
         if(S_ISREG(st.st_mode)) {
           std::string type = get_type(name);
-          int size = st.st_size;
+          uint64_t size = st.st_size;
           if (type == "vid") videos.push_back(size);
           else if (type == "audio") audios.push_back(size);
           else if (type == "img") images.push_back(size);
@@ -151,7 +531,7 @@ class Disku {
           buf[len] = '\0';
           std::string target = buf.data();
           std::string type = get_type(name);
-          int size = st.st_size;
+          uint64_t size = st.st_size;
           if (type == "vid") videos.push_back(size);
           else if (type == "audio") audios.push_back(size);
           else if (type == "img") images.push_back(size);
@@ -168,31 +548,6 @@ class Disku {
       };
     }
 
-    unsigned long long get_size(std::string path) {
-        struct stat st;
-        if (lstat(path.c_str(), &st) < 0) return 0;
-
-        if (!S_ISDIR(st.st_mode)) {
-            // It's a file or link: return its size
-            return st.st_size;
-        }
-
-        int total = 0;
-        DIR *dir = opendir(path.c_str());
-        if (!dir) return 0;
-
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
-                continue;
-
-            std::string fullpath = path + "/" + entry->d_name;
-            total += get_size(fullpath);
-        }
-        closedir(dir);
-        return total;
-    }
-
     std::string to_human_readable(uint64_t size) {
       uint64_t divisor = 1;
       std::string prefix;
@@ -217,25 +572,13 @@ class Disku {
       return std::to_string(size / divisor) + prefix;
     }
 
-  void print_table(std::string dirpath, bool no_dirs) {
-    DIR* d = opendir(dirpath.c_str());
-    if (d == nullptr) {
-      std::string error = std::string("Failed to open dir: ") + strerror(errno);
-      return;
-    }
-
-    struct dirent* entry;
-    std::vector<std::tuple<std::string, std::string, int, std::string>> entries;
-
-    while ((entry = readdir(d)) != nullptr) {
-      std::string name = entry->d_name;
-      if (name == "." || name == "..") continue;
 
-      std::string type;
-      std::string fullpath = dirpath + "/" + name;
-
-      std::string filetype = get_type(name);
-      std::string color;
+  std::string format_row(size_t i, const UsageNode& node, size_t num_width, size_t name_width) {
+    std::string num = std::to_string(i);
+    std::string color;
+    if(node.is_dir) color = bold + white;
+    else {
+      std::string filetype = get_type(node.name);
       if (filetype == "vid") color = magenta;
       else if (filetype == "audio") color = cyan;
       else if (filetype == "img") color = yellow;
@@ -243,80 +586,89 @@ class Disku {
       else if (filetype == "code") color = blue;
       else if (filetype == "arch") color = red;
       else color = gray;
+    }
+    std::string name = color + node.name + reset;
 
-      switch (entry->d_type) {
-        case DT_DIR: {
-          if(no_dirs) continue;
-          type = "dir"; color = bold + white;
-          break;
-        }
-        default: type = "file"; break;
-      }
-
-      struct stat st;
-      if (stat(fullpath.c_str(), &st) == -1) {
-        std::string error = std::string("Failed to stat file: ") + strerror(errno);
-        info::error(error, errno);
-        return;
-      }
-      int size = st.st_size;
+    num.resize(num_width, ' ');
+    name.resize(name_width + color.length() + reset.length(), ' '); // adjust for color codes
 
-      entries.push_back(std::make_tuple(name, type, size, color));
-    }
+    std::string size = node.done ? to_human_readable(node.bytes.load()) : gray + "..." + reset;
+    return num + " │ " + name + " │ " + size;
+  }
 
-    int longest_name_length = 0;
-    int longest_num_length = 0;
+  // Prints one row per entry in the scanned directory. On a terminal the rows show up as soon as the
+  // directory is listed and each size is filled in when its subtree is done, otherwise it's printed at the end
+  void print_table(Scan& scan, bool no_dirs) {
+    std::unique_lock lock(scan.mutex);
+    scan.cv.wait(lock, [&]() { return scan.listed; });
 
-    for (int i = 0; i < entries.size(); i++) {
-      if (std::to_string(i).length() > longest_num_length)
-        longest_num_length = std::to_string(i).length();
-      if (std::get<0>(entries[i]).length() > longest_name_length)
-        longest_name_length = std::get<0>(entries[i]).length();
+    std::vector<UsageNode*> rows;
+    for(auto& child : scan.root.children) {
+      if(no_dirs && child->is_dir) continue;
+      rows.push_back(child.get());
     }
 
-    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
-      bool a_is_dir = std::get<1>(a) == "dir";
-      bool b_is_dir = std::get<1>(b) == "dir";
-
-      if (a_is_dir != b_is_dir) {
-        return a_is_dir;
+    std::sort(rows.begin(), rows.end(), [](const UsageNode* a, const UsageNode* b) {
+      if (a->is_dir != b->is_dir) {
+        return a->is_dir;
       }
-
-      return std::get<0>(a) < std::get<0>(b); // sort by name after dirs
+      return a->name < b->name; // sort by name after dirs
     });
 
-    for (int i = 0; i < entries.size(); i++) {
-      std::string num = std::to_string(i);
-      std::string color = std::get<3>(entries[i]);
-      std::string name = color + std::get<0>(entries[i]) + reset;
-      std::string fullpath = dirpath + "/" + std::get<0>(entries[i]);
+    size_t num_width = std::to_string(rows.empty() ? 0 : rows.size() - 1).length();
+    size_t name_width = 0;
+    for(auto* row : rows) name_width = std::max(name_width, row->name.length());
+
+    struct winsize w{};
+    bool live = isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0
+      && rows.size() + 1 < w.ws_row; // Rows that scrolled off can't be updated anymore
 
-      num.resize(longest_num_length, ' ');
-      name.resize(longest_name_length + color.length() + reset.length(), ' '); // adjust for color codes
+    if(!live) scan.cv.wait(lock, [&]() { return scan.done; });
 
-      io::print(num + " │ " + name + " │ " + to_human_readable(get_size(fullpath)) + "\n");
+    std::vector<bool> drawn(rows.size());
+    std::string out;
+    for(size_t i = 0; i < rows.size(); i++) {
+      out += format_row(i, *rows[i], num_width, name_width) + "\n";
+      drawn[i] = rows[i]->done;
+    }
+    io::print(out);
+
+    while(live) {
+      bool finished = scan.done;
+      out.clear();
+      for(size_t i = 0; i < rows.size(); i++) {
+        if(drawn[i] || !rows[i]->done) continue;
+        size_t up = rows.size() - i;
+        out += "\x1b[" + std::to_string(up) + "A\r\x1b[2K" + format_row(i, *rows[i], num_width, name_width)
+          + "\r\x1b[" + std::to_string(up) + "B";
+        drawn[i] = true;
+      }
+      if(!out.empty()) io::print(out);
+      if(finished) break;
+      scan.cv.wait(lock);
     }
   }
 
-  void print_usage(std::string dirpath, bool no_dirs) {
+  std::unique_ptr<Scan> print_usage(std::string dirpath, bool no_dirs, const ScanOptions& options,
+                                    const UsageIndex* index = nullptr, const std::unordered_set<std::string>* dirty = nullptr) {
     auto usages = get_dir_usages(dirpath, no_dirs);
-    std::string total_usage = to_human_readable(get_size(dirpath));
+    if(usages.empty()) return nullptr;
 
-    auto sum_sizes = [](const std::vector<int>& vec) {
-      int size = 0;
+    auto sum_sizes = [](const std::vector<uint64_t>& vec) {
+      uint64_t size = 0;
       for(auto& s : vec) size += s;
       return size;
     };
 
-    int video_size = sum_sizes(usages[0]);
-    int audio_size = sum_sizes(usages[1]);
-    int image_size = sum_sizes(usages[2]);
-    int document_size = sum_sizes(usages[3]);
-    int code_size = sum_sizes(usages[4]);
-    int archive_size = sum_sizes(usages[5]);
-    int other_size = sum_sizes(usages[6]);
+    uint64_t video_size = sum_sizes(usages[0]);
+    uint64_t audio_size = sum_sizes(usages[1]);
+    uint64_t image_size = sum_sizes(usages[2]);
+    uint64_t document_size = sum_sizes(usages[3]);
+    uint64_t code_size = sum_sizes(usages[4]);
+    uint64_t archive_size = sum_sizes(usages[5]);
+    uint64_t other_size = sum_sizes(usages[6]);
 
-    std::vector<std::tuple<int, std::string, std::string>> all_sizes = {
+    std::vector<std::tuple<uint64_t, std::string, std::string>> all_sizes = {
       {video_size, bg_magenta, "Video"},
       {audio_size, bg_cyan, "Audio"},
       {image_size, bg_yellow, "Image"},
@@ -331,29 +683,122 @@ class Disku {
     });
 
     for (size_t i = 0; i < all_sizes.size(); ++i) {
-      int size = std::get<0>(all_sizes[i]);
+      uint64_t size = std::get<0>(all_sizes[i]);
       std::string color = std::get<1>(all_sizes[i]);
       std::string label = std::get<2>(all_sizes[i]);
 
       io::print(color + "  " + reset);
       io::print(" " + label + ": " + to_human_readable(size) + "   ");
     }
+    io::print("\n\n");
 
-    int total_size = get_size(dirpath);
-    float percent_used = ((float)total_size / get_disk_storage("/")) * 100;
+    struct stat st;
+    if(stat(dirpath.c_str(), &st) != 0) {
+      info::error("Failed to stat: " + dirpath + " (" + strerror(errno) + ")", errno);
+      return nullptr;
+    }
 
-    io::print("\n\n");
+    auto scan = std::make_unique<Scan>();
+    scan->options = options;
+    scan->root_path = dirpath;
+    scan->index = index;
+    scan->dirty = dirty;
+    scan->root_dev = st.st_dev;
+    scan->root.is_dir = true;
+    scan->root.bytes = st.st_blocks * 512ULL;
+    scan->root.own = st.st_blocks * 512ULL;
+    scan->root.dev = st.st_dev;
+    scan->root.ino = st.st_ino;
+    scan->root.mtime = st.st_mtim;
+
+    std::thread scanner([&]() { scan_tree(*scan, dirpath); });
+    print_table(*scan, no_dirs);
+    scanner.join();
+
+    for(auto& error : scan->errors) info::error(error);
+
+    uint64_t total_size = scan->root.bytes.load();
+    double percent_used = (static_cast<double>(total_size) / get_disk_storage(dirpath)) * 100;
+
+    io::print("\n");
     io::print("Total usage: ");
-    io::print(cyan + to_human_readable(get_size(dirpath)) + reset + "\n");
+    io::print(cyan + to_human_readable(total_size) + reset + "\n");
 
     io::print("Disk % used: ");
     std::stringstream ss;
     ss << cyan << std::setprecision(5) << std::to_string(percent_used) << "%" << reset;
     io::print(ss.str());
 
-    io::print("\n\n");
+    io::print("\n");
+    if(index != nullptr) {
+      io::print(gray + "Reused " + std::to_string(scan->reused.load()) + " of " + std::to_string(index->dirs.size())
+        + " indexed directories" + reset + "\n");
+    }
+    return scan;
+  }
 
-    print_table(dirpath, no_dirs);
+  void add_watches(io::Watcher& watcher, const std::string& path, const UsageNode& node, const std::string& rel,
+                   std::unordered_map<int, std::string>& watched, bool& warned) {
+    int wd = watcher.add(path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE
+                               | IN_ONLYDIR | IN_DONT_FOLLOW);
+    if(wd == -1) {
+      if(errno == ENOSPC && !warned) {
+        info::warning("Ran out of inotify watches, some directories won't be watched (see fs.inotify.max_user_watches)\n");
+        warned = true;
+      }
+      return;
+    }
+    watched[wd] = rel;
+
+    for(auto& child : node.children) {
+      if(!child->is_dir) continue;
+      add_watches(watcher, path + "/" + child->name, *child, rel.empty() ? child->name : rel + "/" + child->name,
+                  watched, warned);
+    }
+  }
+
+  // Keeps the index up to date with inotify, and prints the usage again whenever something changed.
+  // Only directories that got an event are read again, since a file growing doesn't change its directory's mtime
+  int watch(const std::string& root, bool no_dirs, const ScanOptions& options, std::unique_ptr<Scan> scan) {
+    io::Watcher watcher;
+    if(!watcher.ok()) {
+      info::error(std::string("Failed to initialize watching: ") + strerror(watcher.error()), watcher.error());
+      return 1;
+    }
+
+    UsageIndex index;
+    bool warned = false;
+    while(scan != nullptr) {
+      index.load(scan->root, options.one_file_system);
+
+      // inotify hands back the same descriptor for a directory that's already watched
+      std::unordered_map<int, std::string> watched;
+      add_watches(watcher, root, scan->root, "", watched, warned);
+
+      std::unordered_set<std::string> dirty;
+      bool overflow = false;
+      int timeout = -1; // Wait for the first change, then until things have been quiet for a moment
+      while(true) {
+        int count = watcher.wait(timeout, [&](const io::WatchEvent& event) {
+          if(event.mask & IN_Q_OVERFLOW) overflow = true;
+          auto it = watched.find(event.wd);
+          if(it != watched.end()) dirty.insert(it->second);
+        });
+        if(count < 0) {
+          info::error(std::string("Failed to watch: ") + strerror(errno), errno);
+          return 1;
+        }
+        if(count == 0 && timeout != -1) break;
+        if(count > 0) timeout = 300;
+      }
+
+      if(isatty(STDOUT_FILENO)) io::print("\x1b[H\x1b[2J");
+      scan = print_usage(root, no_dirs, options, overflow ? nullptr : &index, &dirty);
+      if(scan != nullptr && !index.save(root, scan->root, options.one_file_system)) {
+        info::error(std::string("Failed to save the index: ") + strerror(errno), errno);
+      }
+    }
+    return 1;
   }
 
 
@@ -362,31 +807,53 @@ class Disku {
 
     int exec(std::vector<std::string> args) {
       std::string path;
-      if(args.empty()) {
-        char buffer[PATH_MAX];
-        if(!getcwd(buffer, PATH_MAX)) {
-          std::string error = std::string("Failed to get current directory: ") + strerror(errno);
-          info::error(error, errno);
-          return errno;
-        }
-        path = buffer;
-      }
 
       std::vector<std::string> validArgs = {
-        "--no-dirs"
+        "--no-dirs",
+        "-x", "--one-file-system",
+        "-j", "--jobs",
+        "-i", "--index",
+        "--rescan",
+        "-w", "--watch",
+        "-h", "--help"
       };
 
       bool no_dirs = false;
-
-      for(auto& arg : args) {
-        if(io::vecContains(validArgs, arg)) {
+      bool use_index = false;
+      bool rescan = false;
+      bool watching = false;
+      ScanOptions options;
+
+      for(size_t i = 0; i < args.size(); i++) {
+        std::string& arg = args[i];
+        if(!io::vecContains(validArgs, arg) && arg.starts_with("-")) {
           info::error("Invalid argument \"" + arg + "\"!");
           return EINVAL;
         }
         if(arg == "--no-dirs") {
           no_dirs = true;
-        }
-        if(arg == "-h" || arg == "--help") {
+        } else if(arg == "-x" || arg == "--one-file-system") {
+          options.one_file_system = true;
+        } else if(arg == "-i" || arg == "--index") {
+          use_index = true;
+        } else if(arg == "--rescan") {
+          use_index = true;
+          rescan = true;
+        } else if(arg == "-w" || arg == "--watch") {
+          use_index = true;
+          watching = true;
+        } else if(arg == "-j" || arg == "--jobs") {
+          if(i + 1 >= args.size()) {
+            info::error("Missing number of threads.");
+            return EINVAL;
+          }
+          try {
+            options.threads = std::stoul(args[++i]);
+          } catch(...) {
+            info::error("Invalid number of threads \"" + args[i] + "\"");
+            return EINVAL;
+          }
+        } else if(arg == "-h" || arg == "--help") {
           io::print(get_helpmsg({
             "Prints the disk usage of each file and directory",
             {
@@ -395,22 +862,61 @@ class Disku {
             },
             {
               {"", "--no-dirs", "Do not include directories"},
+              {"-x", "--one-file-system", "Skip directories on other file systems"},
+              {"-j", "--jobs", "Number of threads to scan with, one per core by default"},
+              {"-i", "--index", "Keep the scan in ~/.slash/cache/disku and only read changed directories next time"},
+              {"", "--rescan", "Read everything again and replace the index, for files that grew in place"},
+              {"-w", "--watch", "Keep the index up to date and show the usage again whenever something changes"},
               {"-h", "--help", "Show this help message"}
             },
             {
               {"disku", "Show disk usage of each file and directory"},
-              {"disku --no-dirs", "Show disk usage of each file only"}
+              {"disku --no-dirs", "Show disk usage of each file only"},
+              {"disku / -x", "Show disk usage of the root file system, without other mounts"},
+              {"disku ~ --index", "Show disk usage of the home directory, reusing the last scan"}
             },
             "",
             ""
           }));
           return 0;
-        }
-        if(!arg.starts_with("-")) {
+        } else if(!arg.starts_with("-")) {
           path = arg;
         }
       }
-      print_usage(path, no_dirs);
+
+      if(path.empty()) {
+        char buffer[PATH_MAX];
+        if(!getcwd(buffer, PATH_MAX)) {
+          std::string error = std::string("Failed to get current directory: ") + strerror(errno);
+          info::error(error, errno);
+          return errno;
+        }
+        path = buffer;
+      }
+
+      if(!use_index) {
+        print_usage(path, no_dirs, options);
+        return 0;
+      }
+
+      // The index is keyed by the absolute path, "." and the full path should share one
+      char resolved[PATH_MAX];
+      if(realpath(path.c_str(), resolved) == nullptr) {
+        info::error("Failed to resolve \"" + path + "\": " + strerror(errno), errno);
+        return errno;
+      }
+      path = resolved;
+
+      UsageIndex index;
+      bool loaded = !rescan && index.load(path) && index.one_file_system == options.one_file_system;
+      auto scan = print_usage(path, no_dirs, options, loaded ? &index : nullptr);
+      if(scan == nullptr) return 1;
+
+      if(!index.save(path, scan->root, options.one_file_system)) {
+        info::error(std::string("Failed to save the index: ") + strerror(errno), errno);
+      }
+
+      if(watching) return watch(path, no_dirs, options, std::move(scan));
       return 0;
     }
 };
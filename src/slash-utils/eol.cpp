@@ -1,5 +1,6 @@
 #include "../abstractions/info.h"
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/filestream.h"
 #include "../help_helper.h"
 
 
@@ -28,31 +29,29 @@ class Eol {
       return 0;
     }
 
-    int count_occurences(std::string content, std::string str) {
-      size_t pos = 0;
-      int count = 0;
-
-      while((pos = content.find(str, pos)) != std::string::npos) {
-        count++;
-        pos += str.length();
-      }
-
-      return count;
-    }
-
     int print_occurences(std::string filepath, bool seq) {
-      auto content = io::read_file(filepath);
-      if (!std::holds_alternative<std::string>(content)) {
-        info::error("Failed to read file: " + std::string(strerror(errno)), errno);
-        return errno;
+      io::FileView file(filepath);
+      if (!file.ok()) {
+        info::error("Failed to read file: " + std::string(strerror(file.error())), file.error());
+        return file.error();
       }
 
-      std::string cnt = std::get<std::string>(content);
+      // One pass over the mapped file, without copying it or rewriting it to count LFs and CRs separately
+      std::string_view cnt = file.view();
+      size_t lf_count = 0, crlf_count = 0, cr_count = 0;
+      for (size_t i = 0; i < cnt.size(); i++) {
+        if (cnt[i] == '\n') lf_count++;
+        else if (cnt[i] == '\r') {
+          if (i + 1 < cnt.size() && cnt[i + 1] == '\n') {
+            crlf_count++;
+            i++;
+          } else cr_count++;
+        }
+      }
 
-      std::string crlf = std::to_string(count_occurences(cnt, "\r\n"));
-      io::replace_all(cnt, "\r\n", ""); // remove CRLFs
-      std::string lf = std::to_string(count_occurences(cnt, "\n"));
-      std::string cr = std::to_string(count_occurences(cnt, "\r"));
+      std::string crlf = std::to_string(crlf_count);
+      std::string lf = std::to_string(lf_count);
+      std::string cr = std::to_string(cr_count);
 
       std::stringstream ss;
 
@@ -2,144 +2,523 @@
 
 #include <vector>
 #include <string>
-#include <filesystem>
 #include <dirent.h>
+#include <fnmatch.h>
 #include <pwd.h>
 #include <grp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <regex>
+#include <thread>
 
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
+#include "../abstractions/walker.h"
 
 #include "../help_helper.h"
 
+#pragma region predicates
+
+// One node of a filter expression. The expression is parsed into a tree of these and then compiled:
+// the operands of every -and/-or get sorted by cost, so an entry is only stat'd or readlink'd
+// when all the checks that come for free with getdents couldn't already decide it
+struct Predicate {
+  enum Kind { AND, OR, NOT, NAME, GLOB, REGEX, EXT, TYPE, INODE, OWNER, GROUP, SIZE, MTIME, TARGET, PRUNE };
+
+  Kind kind;
+  std::vector<size_t> children; // AND, OR, NOT
+  std::string text;             // NAME, GLOB, EXT, TYPE, TARGET
+  std::regex regex;
+  uint64_t min = 0, max = UINT64_MAX; // INODE, OWNER and GROUP use min, SIZE and MTIME (age in seconds) the range
+  int cost = 0;
+  bool prunes = false; // Has a side effect, so it can't be moved around
+};
 
-class Fnd {
+// Rough cost of a check, in "how much does it take to get the data" terms
+enum Cost {
+  COST_DIRENT = 1,  // Name, d_type and d_ino come with getdents
+  COST_MATCH = 2,   // Globbing the name
+  COST_REGEX = 4,
+  COST_STAT = 50,   // One fstatat, shared by all the checks that need it
+  COST_READLINK = 60
+};
+
+struct EvalState {
+  time_t now;
+  bool prune = false; // Set by --prune, the current directory isn't descended into
+  std::mutex& err_mutex;
+};
+
+class Plan {
   private:
-    std::string get_owner_name(int owner_id) {
-      struct passwd* pw = getpwuid(owner_id);
-      if(pw) return pw->pw_name;
-      return "UNKNOWN";
+  std::vector<Predicate> nodes;
+  size_t root = 0;
+  bool empty = true;
+
+  static std::string_view extension_of(std::string_view name) {
+    size_t dot = name.rfind('.');
+    if(dot == std::string_view::npos || dot == 0) return {};
+    return name.substr(dot);
+  }
+
+  const struct stat* stat_of(walk::Entry& entry, EvalState& state) {
+    const struct stat* st = entry.stat();
+    if(st == nullptr) {
+      std::lock_guard lock(state.err_mutex);
+      info::error("Stat failed for \"" + entry.path() + "\": " + strerror(entry.stat_error()), entry.stat_error());
     }
+    return st;
+  }
+
+  int compile(size_t i) {
+    Predicate& node = nodes[i];
+    switch(node.kind) {
+      case Predicate::AND:
+      case Predicate::OR: {
+        node.cost = 0;
+        for(size_t child : node.children) {
+          node.cost += compile(child);
+          node.prunes |= nodes[child].prunes;
+        }
 
-    std::string get_group_name(int group_id) {
-      struct group* g = getgrgid(group_id);
-      if(g) return g->gr_name;
-      return "UNKNOWN";
+        // Cheapest first, but nothing moves past a --prune, where the order decides what gets pruned
+        auto begin = node.children.begin();
+        while(begin != node.children.end()) {
+          auto end = std::find_if(begin, node.children.end(), [&](size_t c) { return nodes[c].prunes; });
+          std::stable_sort(begin, end, [&](size_t a, size_t b) { return nodes[a].cost < nodes[b].cost; });
+          begin = end == node.children.end() ? end : end + 1;
+        }
+        break;
+      }
+      case Predicate::NOT:
+        node.cost = compile(node.children[0]);
+        node.prunes = nodes[node.children[0]].prunes;
+        break;
+      case Predicate::NAME:
+      case Predicate::EXT:
+      case Predicate::INODE:
+      case Predicate::TYPE: node.cost = COST_DIRENT; break; // TYPE only needs a stat on filesystems without d_type
+      case Predicate::GLOB: node.cost = COST_MATCH; break;
+      case Predicate::REGEX: node.cost = COST_REGEX; break;
+      case Predicate::OWNER:
+      case Predicate::GROUP:
+      case Predicate::SIZE:
+      case Predicate::MTIME: node.cost = COST_STAT; break;
+      case Predicate::TARGET: node.cost = COST_READLINK; break;
+      case Predicate::PRUNE:
+        node.cost = 0;
+        node.prunes = true;
+        break;
     }
+    return node.cost;
+  }
 
-  int find(std::string inode_id, std::string dir, std::string name, std::string extension, std::string type, std::string owner, std::string group, std::string target) {
-    std::string cwd;
-    if (dir.empty()) {
-        char buffer[512];
-        if (!getcwd(buffer, 511)) {
-            std::string error = std::string("Failed to get current directory: ") + strerror(errno);
-            info::error(error, errno);
-            return -1;
+  bool eval(size_t i, walk::Entry& entry, EvalState& state) {
+    const Predicate& node = nodes[i];
+    switch(node.kind) {
+      case Predicate::AND:
+        for(size_t child : node.children) if(!eval(child, entry, state)) return false;
+        return true;
+      case Predicate::OR:
+        for(size_t child : node.children) if(eval(child, entry, state)) return true;
+        return false;
+      case Predicate::NOT:
+        return !eval(node.children[0], entry, state);
+      case Predicate::NAME:
+        return entry.name == node.text;
+      case Predicate::GLOB:
+        return fnmatch(node.text.c_str(), entry.name.data(), 0) == 0; // d_name is null-terminated
+      case Predicate::REGEX:
+        return std::regex_search(entry.name.begin(), entry.name.end(), node.regex);
+      case Predicate::EXT:
+        return extension_of(entry.name) == node.text;
+      case Predicate::TYPE:
+        return type_name(entry.type()) == node.text;
+      case Predicate::INODE:
+        return entry.ino == node.min;
+      case Predicate::OWNER:
+      case Predicate::GROUP:
+      case Predicate::SIZE:
+      case Predicate::MTIME: {
+        const struct stat* st = stat_of(entry, state);
+        if(st == nullptr) return false;
+        if(node.kind == Predicate::OWNER) return st->st_uid == node.min;
+        if(node.kind == Predicate::GROUP) return st->st_gid == node.min;
+
+        uint64_t value = node.kind == Predicate::SIZE ? st->st_size : std::max<time_t>(0, state.now - st->st_mtime);
+        return value >= node.min && value <= node.max;
+      }
+      case Predicate::TARGET: {
+        if(entry.type() != DT_LNK) return false;
+        char buffer[4096];
+        ssize_t bytesRead = readlinkat(entry.dir_fd, entry.name.data(), buffer, sizeof(buffer));
+        if(bytesRead < 0) {
+          std::lock_guard lock(state.err_mutex);
+          info::error(std::string("Failed to get symlink target path: ") + strerror(errno), errno);
+          return false;
         }
-        dir = buffer;
-        cwd = buffer;
+        return node.text == std::string_view(buffer, bytesRead);
+      }
+      case Predicate::PRUNE:
+        state.prune = true;
+        return false;
     }
+    return false;
+  }
 
-    DIR* d = opendir(dir.c_str());
-    if (d == nullptr) {
-        std::string error = std::string("Failed to open directory \"" + dir + "\": ") + strerror(errno);
-        info::error(error, errno);
-        return -1;
+  public:
+  static std::string_view type_name(unsigned char d_type) {
+    switch(d_type) {
+      case DT_REG: return "file";
+      case DT_DIR: return "dir";
+      case DT_FIFO: return "fifo";
+      case DT_SOCK: return "sock";
+      case DT_LNK: return "link";
+      default: return "unknown";
     }
+  }
 
-    struct dirent* entry;
-    while ((entry = readdir(d)) != nullptr) {
-        std::string nm = entry->d_name;
-        if (nm == "." || nm == "..") continue;
+  size_t add(Predicate&& node) {
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+  }
 
-        std::string fullpath = dir.ends_with("/") ? dir + nm : dir + "/" + nm;
+  void compile_from(size_t root) {
+    this->root = root;
+    empty = false;
+    compile(root);
+  }
 
-        struct stat st;
-        if (stat(fullpath.c_str(), &st) != 0) {
-            std::string error = std::string("Stat failed for \"" + fullpath + "\": ") + strerror(errno);
-            info::error(error, errno);
-            continue;
-        }
+  // Whether the entry should be printed. A pruned entry never is, state.prune tells the walker to skip it too
+  bool matches(walk::Entry& entry, EvalState& state) {
+    if(empty) return true;
+    bool result = eval(root, entry, state);
+    return result && !state.prune;
+  }
+};
 
-        unsigned long long f_id = st.st_ino;
-        std::string f_ext = std::filesystem::path(fullpath).extension();
-        std::string f_type = [entry]() {
-            switch (entry->d_type) {
-                case DT_REG: return "file";
-                case DT_DIR: return "dir";
-                case DT_FIFO: return "fifo";
-                case DT_SOCK: return "sock";
-                case DT_LNK: return "link";
-                default: return "unknown";
-            }
-        }();
-        std::string f_owner = get_owner_name(st.st_uid);
-        std::string f_group = get_group_name(st.st_gid);
-        std::string f_target = [f_type, fullpath]() -> std::string {
-            if (f_type != "link") return "NONE";
-            char buffer[512];
-            ssize_t bytesRead = readlink(fullpath.c_str(), buffer, 511);
-            if (bytesRead < 0) {
-                std::string error = std::string("Failed to get symlink target path: ") + strerror(errno);
-                info::error(error, errno);
-                return "";
-            }
-            buffer[bytesRead] = '\0';
-            return {buffer};
-        }();
-
-        if(!extension.starts_with(".")) extension.insert(extension.begin(), '.');
-
-        // ---- FILTER CHECK ----
-        bool matches = true;
-        if (!inode_id.empty() && std::stoull(inode_id) != f_id) matches = false;
-        if (!name.empty() && name != nm) matches = false;
-        if (!extension.empty() && extension != f_ext) matches = false;
-        if (!type.empty() && type != f_type) matches = false;
-        if (!owner.empty() && owner != f_owner) matches = false;
-        if (!group.empty() && group != f_group) matches = false;
-        if (!target.empty() && f_type == "link" && target != f_target) matches = false;
-
-        if (matches) {
-            std::string display_path = fullpath;
-            if (!cwd.empty() && display_path.starts_with(cwd + "/")) {
-                display_path = "." + display_path.substr(cwd.length());
-            }
-
-            std::string color;
-
-            std::vector<std::string> segs = io::split(display_path, "/");
-            if(isatty(STDOUT_FILENO)) {
-              if (f_type == "dir") color = bold + blue;
-              else if (f_type == "link") color = bold + orange;
-              else if (f_type == "fifo") color = bold + red;
-              else if (f_type == "sock") color = bold + magenta;
-              else if (f_type == "file") color = green;
-              else color = gray;
-
-              for (size_t i = 0; i < segs.size() - 1; i++) {
-                segs[i] = blue + segs[i] + "/" + reset;
-              }
-              if (!segs.empty()) {
-                  segs.back() = color + segs.back() + reset;
-              }
-            }
-
-            std::string path;
-            for (auto& seg : segs) {
-                path += seg;
-            }
-
-            io::print(path + "\n");
-        }
+#pragma endregion
+
+#pragma region parsing
 
-        // ---- ALWAYS RECURSE ----
-        if (f_type == "dir") {
-            find(inode_id, fullpath, name, extension, type, owner, group, target);
+// Parses the expression part of the arguments, with the usual precedence:
+// --not binds tightest, then --and (also implied between two checks), then --or
+class ExprParser {
+  private:
+  const std::vector<std::string>& tokens;
+  size_t pos = 0;
+  Plan& plan;
+
+  bool at(const std::string& tok) const { return pos < tokens.size() && tokens[pos] == tok; }
+
+  // "10", "10k", "1.5M", suffixes are powers of 1024
+  static bool parse_size(const std::string& s, uint64_t& out) {
+    try {
+      size_t idx = 0;
+      double value = std::stod(s, &idx);
+      std::string unit = s.substr(idx);
+      double mul = 1;
+      if(unit == "" || unit == "c" || unit == "b") mul = 1;
+      else if(unit == "k" || unit == "K") mul = 1024.0;
+      else if(unit == "M") mul = 1024.0 * 1024;
+      else if(unit == "G") mul = 1024.0 * 1024 * 1024;
+      else if(unit == "T") mul = 1024.0 * 1024 * 1024 * 1024;
+      else return false;
+      if(value < 0) return false;
+      out = static_cast<uint64_t>(value * mul);
+      return true;
+    } catch(...) {
+      return false;
+    }
+  }
+
+  // "30", "30s", "15m", "2h", "7d", "2w", a number alone is in days
+  static bool parse_age(const std::string& s, uint64_t& out) {
+    try {
+      size_t idx = 0;
+      double value = std::stod(s, &idx);
+      std::string unit = s.substr(idx);
+      double mul = 86400;
+      if(unit == "s") mul = 1;
+      else if(unit == "m") mul = 60;
+      else if(unit == "h") mul = 3600;
+      else if(unit == "d" || unit == "") mul = 86400;
+      else if(unit == "w") mul = 7 * 86400;
+      else return false;
+      if(value < 0) return false;
+      out = static_cast<uint64_t>(value * mul);
+      return true;
+    } catch(...) {
+      return false;
+    }
+  }
+
+  // "+N" more than N, "-N" less than N, "A..B" between A and B inclusive, "N" about N
+  // (more than the next smaller unit, at most N, like find's rounding)
+  static bool parse_range(const std::string& spec, bool (*parse)(const std::string&, uint64_t&),
+                          uint64_t& min, uint64_t& max) {
+    if(spec.empty()) return false;
+
+    size_t dots = spec.find("..");
+    if(dots != std::string::npos) {
+      std::string lo = spec.substr(0, dots), hi = spec.substr(dots + 2);
+      if(!lo.empty() && !parse(lo, min)) return false;
+      if(!hi.empty() && !parse(hi, max)) return false;
+      return min <= max;
+    }
+
+    uint64_t value;
+    if(spec[0] == '+') {
+      if(!parse(spec.substr(1), value)) return false;
+      min = value + 1;
+    } else if(spec[0] == '-') {
+      if(!parse(spec.substr(1), value) || value == 0) return false;
+      max = value - 1;
+    } else {
+      if(!parse(spec, value)) return false;
+      // The unit is whatever follows the number, "2M" matches everything rounding up to 2M
+      size_t idx = spec.find_first_not_of("0123456789.");
+      uint64_t unit = 1;
+      if(idx != std::string::npos) parse("1" + spec.substr(idx), unit);
+      else if(parse == parse_age) unit = 86400;
+      min = value >= unit ? value - unit + 1 : 0;
+      max = value;
+    }
+    return true;
+  }
+
+  bool fail(const std::string& msg) {
+    info::error(msg);
+    return false;
+  }
+
+  bool operand(std::string& out, const std::string& what) {
+    if(pos + 1 >= tokens.size()) return fail("Missing " + what + ".");
+    pos++;
+    out = tokens[pos++];
+    return true;
+  }
+
+  bool primary(size_t& out) {
+    if(pos >= tokens.size()) return fail("Expected a check at the end of the expression.");
+    const std::string tok = tokens[pos];
+
+    if(tok == "(") {
+      pos++;
+      if(!or_expr(out)) return false;
+      if(!at(")")) return fail("Missing \")\".");
+      pos++;
+      return true;
+    }
+
+    Predicate node;
+    std::string value;
+    if(tok == "-n" || tok == "--name") {
+      if(!operand(value, "name")) return false;
+      bool glob = value.find_first_of("*?[") != std::string::npos;
+      node.kind = glob ? Predicate::GLOB : Predicate::NAME;
+      node.text = value;
+    } else if(tok == "--regex") {
+      if(!operand(value, "regex")) return false;
+      node.kind = Predicate::REGEX;
+      try {
+        node.regex = std::regex(value, std::regex::ECMAScript | std::regex::optimize);
+      } catch(const std::regex_error& e) {
+        return fail("Invalid regex \"" + value + "\": " + e.what());
+      }
+    } else if(tok == "-e" || tok == "--ext") {
+      if(!operand(value, "extension")) return false;
+      node.kind = Predicate::EXT;
+      node.text = value.empty() || value.starts_with(".") ? value : "." + value;
+    } else if(tok == "-t" || tok == "--type") {
+      if(!operand(value, "type")) return false;
+      static const std::vector<std::string> types = {"file", "dir", "fifo", "sock", "link", "unknown"};
+      if(!io::vecContains(types, value)) return fail("Invalid type \"" + value + "\", expected file, dir, fifo, sock, link or unknown.");
+      node.kind = Predicate::TYPE;
+      node.text = value;
+    } else if(tok == "-i" || tok == "--inode-id") {
+      if(!operand(value, "inode ID")) return false;
+      node.kind = Predicate::INODE;
+      try {
+        node.min = std::stoull(value);
+      } catch(...) {
+        return fail("Invalid inode ID \"" + value + "\"");
+      }
+    } else if(tok == "-o" || tok == "--owner") {
+      if(!operand(value, "owner")) return false;
+      struct passwd* pw = getpwnam(value.c_str());
+      if(!pw) return fail("No such user \"" + value + "\"");
+      node.kind = Predicate::OWNER;
+      node.min = pw->pw_uid;
+    } else if(tok == "-g" || tok == "--group") {
+      if(!operand(value, "group")) return false;
+      struct group* g = getgrnam(value.c_str());
+      if(!g) return fail("No such group \"" + value + "\"");
+      node.kind = Predicate::GROUP;
+      node.min = g->gr_gid;
+    } else if(tok == "-s" || tok == "--size") {
+      if(!operand(value, "size")) return false;
+      node.kind = Predicate::SIZE;
+      if(!parse_range(value, parse_size, node.min, node.max)) return fail("Invalid size \"" + value + "\"");
+    } else if(tok == "-m" || tok == "--mtime") {
+      if(!operand(value, "modification time")) return false;
+      node.kind = Predicate::MTIME;
+      if(!parse_range(value, parse_age, node.min, node.max)) return fail("Invalid modification time \"" + value + "\"");
+    } else if(tok == "--target") {
+      if(!operand(value, "target")) return false;
+      node.kind = Predicate::TARGET;
+      node.text = value;
+    } else if(tok == "--prune") {
+      pos++;
+      node.kind = Predicate::PRUNE;
+    } else {
+      return fail("Invalid argument \"" + tok + "\"");
+    }
+
+    out = plan.add(std::move(node));
+    return true;
+  }
+
+  bool unary(size_t& out) {
+    if(at("--not") || at("!")) {
+      pos++;
+      size_t child;
+      if(!unary(child)) return false;
+      Predicate node;
+      node.kind = Predicate::NOT;
+      node.children = {child};
+      out = plan.add(std::move(node));
+      return true;
+    }
+    return primary(out);
+  }
+
+  bool and_expr(size_t& out) {
+    Predicate node;
+    node.kind = Predicate::AND;
+    size_t child;
+    if(!unary(child)) return false;
+    node.children.push_back(child);
+
+    while(pos < tokens.size() && !at("--or") && !at(")")) {
+      if(at("--and")) pos++;
+      if(!unary(child)) return false;
+      node.children.push_back(child);
+    }
+
+    out = node.children.size() == 1 ? node.children[0] : plan.add(std::move(node));
+    return true;
+  }
+
+  bool or_expr(size_t& out) {
+    Predicate node;
+    node.kind = Predicate::OR;
+    size_t child;
+    if(!and_expr(child)) return false;
+    node.children.push_back(child);
+
+    while(at("--or")) {
+      pos++;
+      if(!and_expr(child)) return false;
+      node.children.push_back(child);
+    }
+
+    out = node.children.size() == 1 ? node.children[0] : plan.add(std::move(node));
+    return true;
+  }
+
+  public:
+  ExprParser(const std::vector<std::string>& tokens, Plan& plan) : tokens(tokens), plan(plan) {}
+
+  bool parse() {
+    if(tokens.empty()) return true; // Everything matches
+
+    size_t root;
+    if(!or_expr(root)) return false;
+    if(pos < tokens.size()) return fail("Unexpected \"" + tokens[pos] + "\"");
+    plan.compile_from(root);
+    return true;
+  }
+};
+
+#pragma endregion
+
+class Fnd {
+  private:
+    std::string colorize(const std::string& path, std::string_view f_type) {
+      if (!isatty(STDOUT_FILENO)) return path;
+
+      std::string color;
+      if (f_type == "dir") color = bold + blue;
+      else if (f_type == "link") color = bold + orange;
+      else if (f_type == "fifo") color = bold + red;
+      else if (f_type == "sock") color = bold + magenta;
+      else if (f_type == "file") color = green;
+      else color = gray;
+
+      std::vector<std::string> segs = io::split(path, "/");
+      for (size_t i = 0; i + 1 < segs.size(); i++) {
+        segs[i] = blue + segs[i] + "/" + reset;
+      }
+      if (!segs.empty()) segs.back() = color + segs.back() + reset;
+
+      std::string result;
+      for (auto& seg : segs) result += seg;
+      return result;
+    }
+
+  int find(std::string dir, Plan& plan, unsigned threads) {
+    if (dir.empty()) dir = "."; // Results then print as ./path, relative to the current directory
+
+    walk::ResultQueue results;
+    std::atomic<bool> done = false;
+    std::mutex err_mutex;
+    time_t now = time(nullptr);
+
+    // Matches are collected per worker and handed to the writer in batches, so workers never wait on the terminal
+    walk::Options options;
+    options.threads = threads;
+    std::vector<std::string> batches(walk::thread_count(options));
+
+    options.visit = [&](walk::Entry& entry, unsigned worker) {
+      EvalState state{now, false, err_mutex};
+      if (plan.matches(entry, state)) {
+        std::string& batch = batches[worker];
+        batch += colorize(entry.path(), Plan::type_name(entry.type()));
+        batch += '\n';
+        if (batch.size() >= 64 * 1024) {
+          results.push(std::move(batch));
+          batch.clear();
         }
+      }
+      return !state.prune;
+    };
+    options.error = [&](const std::string& path, int err) {
+      std::lock_guard lock(err_mutex);
+      info::error("Failed to open directory \"" + path + "\": " + strerror(err), err);
+    };
+
+    std::thread writer([&]() {
+      while (true) {
+        bool finished = done.load();
+        for (auto& batch : results.take_all()) io::print(batch);
+        if (finished) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+    });
+
+    int res = walk::parallel_walk(dir, options);
+
+    for (auto& batch : batches) {
+      if (!batch.empty()) results.push(std::move(batch));
     }
-    closedir(d);
-    return 0;
+    done = true;
+    writer.join();
+
+    return res;
   }
 
 
@@ -150,21 +529,31 @@ class Fnd {
     int exec(std::vector<std::string> args) {
       if(args.empty()) {
         io::print(get_helpmsg({
-          "Find files based on their name, extension, type, owner, group, inode ID, or for links, target.",
+          "Find files based on their name, extension, type, owner, group, inode ID, size, modification time, or for links, target. Checks can be combined with --and, --or, --not and parentheses.",
           {
-            "fnd [options]"
+            "fnd [dir] [expression]"
           },
           {
-            {"-n", "--name", "Specify the name"},
+            {"-n", "--name", "Specify the name, * ? and [] work like in the shell"},
+            {"", "--regex", "Name matches a regular expression"},
             {"-e", "--ext", "Specify the extension"},
-            {"-t", "--type", "Specify the type"},
+            {"-t", "--type", "Specify the type (file, dir, link, fifo, sock)"},
             {"-o", "--owner", "Specify the owner"},
             {"-g", "--group", "Specify the group"},
             {"-i", "--inode-id", "Specifies the inode id"},
-            {"", "--target", "Specify the target (only if type is link)"}
+            {"-s", "--size", "Size, \"+1M\" more, \"-10k\" less, \"1M..2G\" between, \"2M\" about (k, M, G, T)"},
+            {"-m", "--mtime", "Time since last modified, same format as --size (s, m, h, d, w; days by default)"},
+            {"", "--target", "Specify the target (only if type is link)"},
+            {"", "--and", "Both checks must match, same as writing them one after another"},
+            {"", "--or", "Either check must match"},
+            {"", "--not", "Check must not match, also \"!\""},
+            {"", "--prune", "Skip this entry and, for a directory, everything in it"},
+            {"-j", "--jobs", "Number of threads to search with, one per core by default"}
           },
           {
-            {"fnd / -n \"lost.cpp\" -e \"file\" -o \"me\"", "Find a file with owner \"me\" called lost.cpp in the entire system"}
+            {"fnd / -n \"lost.cpp\" -e \"file\" -o \"me\"", "Find a file with owner \"me\" called lost.cpp in the entire system"},
+            {"fnd . -n \"*.cpp\" --or -n \"*.h\"", "Find C++ sources and headers"},
+            {"fnd . -n .git --prune --or -s +10M -m -7d", "Find files over 10M changed this week, without looking in .git"}
           },
           "",
           ""
@@ -172,76 +561,52 @@ class Fnd {
         return 0;
       }
 
-      std::vector<std::string> valid_args = { 
+      std::vector<std::string> with_operand = {
         "-n", "--name",
+        "--regex",
         "-e", "--ext",
         "-t", "--type",
         "-o", "--owner",
         "-g", "--group",
         "-i", "--inode-id",
+        "-s", "--size",
+        "-m", "--mtime",
         "--target"
       };
 
-      std::string name, dir, extension, type, owner, group, inode_id, target;
+      // The directory and -j can be anywhere, everything else is the expression
+      std::string dir;
+      std::vector<std::string> expr;
+      unsigned threads = 0;
 
       for(int i = 0; i < args.size(); i++) {
-        if(!io::vecContains(valid_args, args[i]) && args[i].starts_with("-")) {
-          info::error("Invalid argument \"" + args[i] + "\"\n");
-          return EINVAL;
-        }
-
-        if(!args[i].starts_with("-")) {
-          dir = args[i];
-        }
-
-        if(args[i] == "-n" || args[i] == "--name") {
-          if(i + 1 >= args.size()) {
-            info::error("Missing name.");
-            return EINVAL;
-          }
-          name = args[++i];
-        } else if(args[i] == "-e" || args[i] == "--ext") {
-          if(i + 1 >= args.size()) {
-            info::error("Missing extension.");
-            return EINVAL;
-          }
-          extension = args[++i];
-        } else if(args[i] == "-t" || args[i] == "--type") {
+        if(args[i] == "-j" || args[i] == "--jobs") {
           if(i + 1 >= args.size()) {
-            info::error("Missing type.");
+            info::error("Missing number of threads.");
             return -1;
           }
-          type = args[++i];
-        } else if(args[i] == "-o" || args[i] == "--owner") {
-          if(i + 1 >= args.size()) {
-            info::error("Missing owner.");
-            return -1;
-          }
-          owner = args[++i];
-        } else if(args[i] == "-g" || args[i] == "--group") {
-          if(i + 1 >= args.size()) {
-            info::error("Missing group.");
-            return -1;
-          }
-          group = args[++i];
-        } else if(args[i] == "-i" || args[i] == "--inode-id") {
-          if(i + 1 >= args.size()) {
-            info::error("Missing inode ID.");
-            return -1;
-          }
-          inode_id = args[++i];
-        } else if(args[i] == "--target") {
-          if(i + 1 >= args.size()) {
-            info::error("Missing target.");
-            return -1;
+          try {
+            threads = std::stoul(args[++i]);
+          } catch(...) {
+            info::error("Invalid number of threads \"" + args[i] + "\"");
+            return EINVAL;
           }
-          target = args[++i];
-        } else if(!args[i].starts_with("-")) {
+        } else if(io::vecContains(with_operand, args[i])) {
+          expr.push_back(args[i]);
+          if(i + 1 < args.size()) expr.push_back(args[++i]);
+        } else if(!args[i].starts_with("-") && args[i] != "(" && args[i] != ")" && args[i] != "!") {
           dir = args[i];
+        } else {
+          expr.push_back(args[i]);
         }
       }
 
-      return find(inode_id, dir, name, extension, type, owner, group, target);
+      // Parsed and resolved once here, then evaluated for every entry
+      Plan plan;
+      ExprParser parser(expr, plan);
+      if(!parser.parse()) return EINVAL;
+
+      return find(dir, plan, threads);
     }
 };
 
@@ -8,6 +8,7 @@
 
 #include "../abstractions/info.h"
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/watcher.h"
 #include "../help_helper.h"
 #include "../cmd_highlighter.h"
 
@@ -26,13 +27,10 @@ class Listen {
     }
 
     int listen(std::string filepath, bool creation, bool mod, bool del, bool rd, bool open, bool cl) {
-      #define EVENT_SIZE  (sizeof(struct inotify_event))
-      #define BUF_LEN     (1024 * (EVENT_SIZE + 16))
-
-      int fd = inotify_init();
-      if (fd < 0) {
-          std::string error = std::string("Failed to initialize listening: ") + strerror(errno);
-          info::error(error, errno);
+      io::Watcher watcher;
+      if (!watcher.ok()) {
+          std::string error = std::string("Failed to initialize listening: ") + strerror(watcher.error());
+          info::error(error, watcher.error());
           return 1;
       }
 
@@ -44,57 +42,49 @@ class Listen {
       if (open)     flags |= IN_OPEN;
       if (cl)       flags |= IN_CLOSE_WRITE | IN_CLOSE_NOWRITE;
 
-      int wd = inotify_add_watch(fd, filepath.c_str(), flags);
+      int wd = watcher.add(filepath, flags);
 
       if (wd == -1) {
           auto error = std::string("Failed to start watching file: ") + strerror(errno);
           info::error(error, errno);
-          close(fd);
           return 1;
       }
 
-      char buffer[BUF_LEN];
+      bool enable_colors = isatty(STDOUT_FILENO);
 
-      while (true) {
-          int length = read(fd, buffer, BUF_LEN);
-          if (length < 0) {
-              auto error = std::string("Failed to watch file: ") + strerror(errno);
-              info::error(error, errno);
-              break;
-          }
+      auto colorize = [&](const std::string &text, const std::string &color) {
+          return enable_colors ? color + text + reset : text;
+      };
 
-          for (int i = 0; i < length;) {
-              struct inotify_event* event = (struct inotify_event*)&buffer[i];
-              std::string name = event->len ? event->name : filepath;
+      while (true) {
+          int count = watcher.wait(-1, [&](const io::WatchEvent& event) {
+              std::string name = event.name.empty() ? filepath : std::string(event.name);
               std::string msg;
 
-              bool enable_colors = isatty(STDOUT_FILENO);
-
-              auto colorize = [&](const std::string &text, const std::string &color) {
-                  return enable_colors ? color + text + reset : text;
-              };
-
-              if (event->mask & IN_CREATE)        msg += "- Created file";
-              if (event->mask & IN_MODIFY)        msg += colorize("- Modified file", cyan);
-              if (event->mask & IN_DELETE)        msg += colorize("- Deleted file", red);
-              if (event->mask & IN_DELETE_SELF)   msg += colorize("- Watched file deleted", red);
-              if (event->mask & IN_ATTRIB)        msg += colorize("- File metadata changed", yellow);
-              if (event->mask & IN_OPEN)          msg += colorize("- Opened file", green);
-              if (event->mask & IN_CLOSE_WRITE)   msg += colorize("- Closed file (write)", blue);
-              if (event->mask & IN_CLOSE_NOWRITE) msg += colorize("- Closed file (no write)", blue);
-              if (event->mask & IN_MOVED_FROM)    msg += colorize("- Moved file from", magenta);
-              if (event->mask & IN_MOVED_TO)      msg += colorize("- Moved file to", magenta);
+              if (event.mask & IN_CREATE)        msg += "- Created file";
+              if (event.mask & IN_MODIFY)        msg += colorize("- Modified file", cyan);
+              if (event.mask & IN_DELETE)        msg += colorize("- Deleted file", red);
+              if (event.mask & IN_DELETE_SELF)   msg += colorize("- Watched file deleted", red);
+              if (event.mask & IN_ATTRIB)        msg += colorize("- File metadata changed", yellow);
+              if (event.mask & IN_OPEN)          msg += colorize("- Opened file", green);
+              if (event.mask & IN_CLOSE_WRITE)   msg += colorize("- Closed file (write)", blue);
+              if (event.mask & IN_CLOSE_NOWRITE) msg += colorize("- Closed file (no write)", blue);
+              if (event.mask & IN_MOVED_FROM)    msg += colorize("- Moved file from", magenta);
+              if (event.mask & IN_MOVED_TO)      msg += colorize("- Moved file to", magenta);
 
 
               if (!msg.empty())
                   io::print(msg + " → " + name + "\n");
+          });
 
-              i += EVENT_SIZE + event->len;
+          if (count < 0) {
+              auto error = std::string("Failed to watch file: ") + strerror(errno);
+              info::error(error, errno);
+              break;
           }
       }
 
-      inotify_rm_watch(fd, wd);
-      close(fd);
+      watcher.remove(wd);
       return 0;
     }
 
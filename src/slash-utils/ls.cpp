@@ -1,6 +1,7 @@
 
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
+#include "../abstractions/walker.h"
 #include "../git/git.h"
 
 #include "../help_helper.h"
@@ -15,7 +16,11 @@
 #include <math.h>
 
 #include <unordered_map>
-#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string_view>
 #include <sys/ioctl.h>
 #include <regex>
 
@@ -33,6 +38,7 @@ private:
 
     std::string unknown_file = "\uea7b";
     std::string dir          = "\uf4d3";
+    std::string broken_link  = "\uf127";
     std::unordered_map<std::string, std::string> icon_map = {
         {".cpp",  "\ue646"},
         {".c",    "\ue61e"},
@@ -66,296 +72,405 @@ private:
         {".pdf",  "\U000f0219"}   // PDF bright red
     };
 
-    std::string get_with_icon(std::string path) {
-        std::filesystem::path p(path);
-        std::string name = p.filename().string();
-        struct stat st;
-        if (stat(path.c_str(), &st) != 0) {
-            std::string error = std::string("Failed to stat \"" + name + "\": ") + strerror(errno);
-            info::error(error, errno);
-            return "";
+    // Type of an entry, from d_type when the filesystem fills it in, otherwise from a statx that asks for nothing else
+    unsigned char entry_type(int dir_fd, const char* name, unsigned char d_type, bool follow = false) {
+        if (d_type != DT_UNKNOWN && !follow) return d_type;
+
+        struct statx stx;
+        int flags = AT_STATX_DONT_SYNC | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+        if (statx(dir_fd, name, flags, STATX_TYPE, &stx) != 0) return DT_UNKNOWN;
+        return IFTODT(stx.stx_mode);
+    }
+
+    std::string icon_for(std::string_view name, unsigned char type) {
+        switch (type) {
+            case DT_DIR: return dir;
+            case DT_FIFO: return "\U000f07e5";
+            case DT_SOCK: return "\U000f0427"; // literally what does a socket look like
+            case DT_REG: {
+                size_t dot = name.rfind('.');
+                if (dot == std::string_view::npos || dot == 0) return unknown_file;
+                auto it = icon_map.find(std::string(name.substr(dot)));
+                return it != icon_map.end() ? it->second : unknown_file;
+            }
+            default: return unknown_file;
+        }
+    }
+
+    std::string get_with_icon(int dir_fd, const char* name, unsigned char type) {
+        if (type != DT_LNK) return icon_for(name, type);
+
+        // A link gets the icon of whatever it points to
+        unsigned char target_type = entry_type(dir_fd, name, type, true);
+        char buf[PATH_MAX];
+        ssize_t bytesRead = readlinkat(dir_fd, name, buf, PATH_MAX - 1);
+        if (target_type == DT_UNKNOWN || bytesRead < 0) return broken_link;
+
+        std::string_view target(buf, bytesRead);
+        size_t slash = target.rfind('/');
+        if (slash != std::string_view::npos) target.remove_prefix(slash + 1);
+        return icon_for(target, target_type);
+    }
+
+    // Git status of everything below dir_path, fetched once. rel_dir is dir_path relative to the repo root
+    bool load_git_statuses(const std::string& dir_path, std::unordered_map<std::string, std::string>& statuses, std::string& rel_dir) {
+        GitRepo repo(dir_path);
+        if (repo.get_repo() == nullptr) {
+            info::error("The directory is not a git repository.");
+            return false;
         }
-        std::string type = [name, st]() -> std::string {
-            if (S_ISREG(st.st_mode))  return "file";
-            if (S_ISDIR(st.st_mode))  return "dir";
-            if (S_ISLNK(st.st_mode))  return "link";
-            if (S_ISFIFO(st.st_mode)) return "fifo";
-            if (S_ISSOCK(st.st_mode)) return "sock";
-            return "unknown";
-        }();
-
-        std::string icon = unknown_file, color = "";
-        std::string name_to_be_pushed;
-
-        if (type == "file") {
-            if (p.has_extension()) {
-                auto it = icon_map.find(p.extension());
-                if (it != icon_map.end()) {
-                    icon = icon_map[p.extension()];
+
+        std::string repo_root = repo.get_root_path();
+        char resolved[PATH_MAX];
+        if (repo_root.empty() || realpath(dir_path.c_str(), resolved) == nullptr) {
+            info::error("Failed to get Git root path.");
+            return false;
+        }
+
+        std::string abs = std::string(resolved) + "/";
+        rel_dir = abs.starts_with(repo_root) ? abs.substr(repo_root.size()) : "";
+        if (!rel_dir.empty()) rel_dir.pop_back();
+
+        statuses = repo.get_statuses(rel_dir);
+        return true;
+    }
+
+    // Anything missing from the map is unmodified, unless it's inside an untracked or ignored directory
+    std::string git_status_of(const std::unordered_map<std::string, std::string>& statuses, const std::string& rel, bool is_dir) {
+        std::string key = is_dir ? rel + "/" : rel;
+        auto it = statuses.find(key);
+        if (it != statuses.end()) return it->second;
+
+        for (size_t slash = rel.rfind('/'); slash != std::string::npos && slash > 0; slash = rel.rfind('/', slash - 1)) {
+            it = statuses.find(rel.substr(0, slash + 1));
+            if (it != statuses.end()) return it->second;
+        }
+        return is_dir ? "" : "U"; // Directories aren't exactly "tracked" like files
+    }
+
+    std::string git_color(const std::string& git_char) {
+        if (git_char == "U") {
+            return blue;  // Red (unmodified)
+        } else if (git_char == "M") {
+            return "\033[33m";  // Yellow (modified)
+        } else if (git_char == "S") {
+            return "\033[32m";  // Green (staged)
+        } else if (git_char == "I") {
+            return "\033[90m";  // Gray (ignored)
+        } else if (git_char == "R") {
+            return "\033[36m";  // Cyan (renamed)
+        } else if (git_char == "N") {
+            return gray;   // Reset (untracked)
+        }
+        return "\033[0m";   // Fallback/reset
+    }
+
+    struct Listing;
+
+    struct Row {
+        std::string name;
+        std::string text;
+        size_t width;              // Without the escape codes
+        Listing* child = nullptr;  // The directory's own listing, when listing recursively
+    };
+
+    // One directory of a recursive listing. Filled in by whichever walker thread reads it, printed by the main thread
+    struct Listing {
+        std::string path;
+        std::string rel;    // Relative to the repository root, for --git
+        std::vector<Row> rows;
+        std::vector<std::unique_ptr<Listing>> subdirs;
+        std::string block;  // The grid, for -R
+        int error = 0;
+        bool ready = false; // Guarded by the printer's mutex
+    };
+
+    struct ListOptions {
+        bool hidden = false;
+        bool icons = false;
+        bool git = false;
+        bool tree = false;
+        const std::unordered_map<std::string, std::string>* statuses = nullptr;
+    };
+
+    Row make_row(int dir_fd, const std::string& name, unsigned char type, const std::string& rel, const ListOptions& opts) {
+        std::string color;
+        std::string git_char;
+
+        if(opts.git) {
+            git_char = git_status_of(*opts.statuses, rel, type == DT_DIR);
+            if(use_colors) color = git_color(git_char);
+        } else {
+            if(use_colors) {
+                switch(type) {
+                    case DT_REG: color = green; break;
+                    case DT_DIR: color = blue; break;
+                    case DT_LNK: color = orange; break;
+                    case DT_FIFO: color = "\x1b[35m"; break;
+                    default: color = gray; 
                 }
             }
         }
 
-        if (type == "dir") {
-            color = "\x1b[38;5;3m";
-            icon  = dir;
+        std::string fullname;
+        if(opts.icons) fullname += color + get_with_icon(dir_fd, name.c_str(), type) + " " + reset;
+        fullname += color + name + reset;
+        if(opts.git) {
+            if(!git_char.empty()) fullname += color + " (" + git_char + ") " + reset;
         }
 
-        if (type == "link") {
-            struct stat tmp;
-            if (stat(path.c_str(), &tmp) != 0) { // Broken symlink
-                icon = "\uf127";
-                color = "\x1b[38;5;1m";
-            } else {
-                char buf[PATH_MAX];
-                ssize_t bytesRead = readlink(path.c_str(), buf, PATH_MAX - 1);
-                if (bytesRead < 0) {
-                    icon = "\uf127";
-                    color = "\x1b[38;5;1m";
+        size_t width = io::strip_ansi(fullname).length();
+        return {name, std::move(fullname), width};
+    }
+
+    // Same row, the way --tree shows it
+    Row make_tree_row(int dir_fd, const std::string& name, unsigned char type, const std::string& rel, const ListOptions& opts) {
+        std::string text;
+        if(!opts.git) {
+            if (type == DT_DIR) {
+                text = bold + blue + name + reset;
+            } else if (type == DT_LNK) {
+                char buf[1024];
+                ssize_t len = readlinkat(dir_fd, name.c_str(), buf, sizeof(buf) - 1);
+                if (len != -1) {
+                    buf[len] = '\0';
+                    text = bold + orange + name + reset + " -> " + buf;
+                } else {
+                    text = orange + name + reset + " -> [unreadable]";
                 }
-                icon = get_with_icon(buf);
-                buf[bytesRead] = '\0';
+            } else if (type == DT_SOCK) {
+                text = bold + magenta + name + reset;
+            } else if (type == DT_FIFO) {
+                text = bold + red + name + reset;
+            } else {
+                text = green + name + reset;
+            }
+        } else {
+            if(type == DT_DIR) {
+                // Directories arent exactly "tracked" like files
+                text = bold + magenta + name + " ()" + reset;
+            } else {
+                std::string status = git_status_of(*opts.statuses, rel, false);
+                text = git_color(status) + name + " (" + status + ")" + reset;
             }
         }
+        return {name, std::move(text), 0};
+    }
 
-        if (type == "fifo") {
-            icon = "\U000f07e5";
-            color = "\x1b[38;5;13m";
-        }
+    // Lays the rows out in a grid, with the column width taken from this directory alone
+    std::string format_grid(std::vector<Row>& entries, int terminal_width) {
+        int current_width_available = terminal_width;
+        size_t longest_name_length = 0;
 
-        if (type == "sock") {
-            icon = "\U000f0427"; // literally what does a socket look like
-            color = "\x1b[38;5;50m";
+        for(auto& row : entries) {
+            if(row.width > longest_name_length) longest_name_length = row.width + 1; // +1 for padding
         }
 
-        return icon;
+        std::string out;
+        for(auto& row : entries) {
+            if (row.width < longest_name_length) {
+                row.text.append(longest_name_length - row.width, ' ');
+                row.width = longest_name_length;
+            }
+
+            if(static_cast<int>(row.width) > current_width_available) {
+                out += "\n";
+                current_width_available = terminal_width;
+            }
+            out += row.text;
+            current_width_available -= row.width;
+        }    
+
+        out += "\n";
+        return out;
     }
 
     int default_print(std::string dir_path, bool print_hidden, bool with_icons, bool with_git) {
         DIR* d = opendir(dir_path.c_str());
         if(!d) {
-            std::string error = std::string("Failed to open directory" + dir_path + ": ") + strerror(errno);
+            std::string error = std::string("Failed to open directory " + dir_path + ": ") + strerror(errno);
             info::error(error, errno);
+            return -1;
         }
+        int dir_fd = dirfd(d);
 
-        std::vector<std::tuple<std::string, int, std::string>> entries;
+        ListOptions opts;
+        opts.hidden = print_hidden;
+        opts.icons = with_icons;
+        opts.git = with_git;
 
-        struct dirent* entry;
-        GitRepo repo(dir_path);
+        std::unordered_map<std::string, std::string> statuses;
+        std::string rel_dir;
+        if(with_git && !load_git_statuses(dir_path, statuses, rel_dir)) {
+            closedir(d);
+            return -1;
+        }
+        opts.statuses = &statuses;
+
+        std::vector<Row> entries;
 
+        struct dirent* entry;
         while((entry = readdir(d)) != NULL) {
             std::string name = entry->d_name;
-            std::string fullpath = dir_path + "/" + name;
-            std::string color;
-            std::string git_char;
 
             if((name == "." || name == ".." || name.starts_with(".")) && !print_hidden) continue;
 
-            if(with_git) {
-                if(repo.get_repo() == nullptr) {
-                    info::error("The directory is not a git repository.");
-                    return -1;
-                }
-
-                std::string repo_root = repo.get_root_path();
-                if (!repo_root.empty()) {
-                    std::filesystem::path file_path = std::filesystem::absolute(fullpath);
-                    std::filesystem::path root_path = std::filesystem::path(repo_root);
-                    std::string relative_path = std::filesystem::relative(file_path, root_path).string();
-
-                    std::string status = repo.get_file_status(relative_path);
-                    git_char = status;
-
-                    if(use_colors) {
-                        if (git_char == "U") {
-                            color = blue;  // Red (unmodified)
-                        } else if (git_char == "M") {
-                            color = "\033[33m";  // Yellow (modified)
-                        } else if (git_char == "S") {
-                            color = "\033[32m";  // Green (staged)
-                        } else if (git_char == "I") {
-                            color = "\033[90m";  // Gray (ignored)
-                        } else if (git_char == "R") {
-                            color = "\033[36m";  // Cyan (renamed)
-                        } else if (git_char == "N") {
-                            color = gray;   // Reset (untracked)
-                        } else {
-                            color = "\033[0m";   // Fallback/reset
-                        }
-                    }
-                } else {
-                    info::error("Failed to get Git root path.");
-                    return -1;
-                }
-            } else {
-                if(use_colors) {
-                    switch(entry->d_type) {
-                        case DT_REG: color = green; break;
-                        case DT_DIR: color = blue; break;
-                        case DT_LNK: color = orange; break;
-                        case DT_FIFO: color = "\x1b[35m"; break;
-                        default: color = gray; 
-                    }
-                }
-            }
+            // Only stat when d_type doesn't say, and when the type is needed at all
+            unsigned char type = entry->d_type;
+            if(type == DT_UNKNOWN && (use_colors || with_icons || with_git)) type = entry_type(dir_fd, entry->d_name, type);
 
-    std::stringstream fullname;
-    if(with_icons) fullname << color << get_with_icon(fullpath) + " " << reset;
-    fullname << color << name << reset;
-    if(with_git) {
-        if(!git_char.empty()) fullname << color << " (" << git_char << ") " << reset;
-    } 
+            entries.push_back(make_row(dir_fd, name, type, rel_dir.empty() ? name : rel_dir + "/" + name, opts));
+        }
+        closedir(d);
 
-    entries.push_back({fullname.str(), fullname.str().length(), git_char});
-}
-        std::sort(entries.begin(), entries.end(), [](std::tuple<std::string, int, std::string>& a, std::tuple<std::string, int, std::string>& b) {
-            auto first = io::strip_ansi(std::get<0>(a));
-            auto sec = io::strip_ansi(std::get<0>(b));
-            return io::strip_ansi(first) < io::strip_ansi(sec);
+        std::sort(entries.begin(), entries.end(), [](const Row& a, const Row& b) {
+            return a.name < b.name;
         });
- 
-        int current_width_available = get_terminal_width();
-        int longest_name_length = 0;
 
-        for(auto& [name, nlength, git_char] : entries) {
-            int length_excluding_ansi = io::strip_ansi(name).length();
-            if(length_excluding_ansi > longest_name_length) longest_name_length = length_excluding_ansi + 1; // +1 for padding
+        io::print(format_grid(entries, get_terminal_width()));
+        return 0;
+    }
+
+    // Prints a listing once it's ready and then its subdirectories, in order, waiting on whichever
+    // isn't read yet. Everything before it is flushed first, so output shows up as soon as it can
+    void print_listing(Listing* node, const ListOptions& opts, std::vector<bool>& last_entry_stack, std::string& out,
+                       std::mutex& mutex, std::condition_variable& cv, bool& walk_done) {
+        {
+            std::unique_lock lock(mutex);
+            if(!node->ready) {
+                lock.unlock();
+                io::print(out);
+                out.clear();
+                lock.lock();
+                cv.wait(lock, [&]() { return node->ready || walk_done; });
+            }
+            if(!node->ready) return; // The walk gave up before getting here
         }
 
-        for(auto& [name, nlength, git_char] : entries) {
-            int stripped_len = io::strip_ansi(name).length();
-            if (stripped_len < longest_name_length)
-                name.append(longest_name_length - stripped_len, ' ');
+        if(node->error != 0) {
+            io::print(out);
+            out.clear();
+            info::error(strerror(node->error), node->error, node->path);
+        }
 
-            if(io::strip_ansi(name).length() > current_width_available) {
-                io::print("\n");
-                current_width_available = get_terminal_width();
+        if(!opts.tree) {
+            out += node->block;
+            for(auto& row : node->rows) {
+                if(row.child) print_listing(row.child, opts, last_entry_stack, out, mutex, cv, walk_done);
             }
-            io::print(name);
-            current_width_available -= io::strip_ansi(name).length();
-        }    
+        } else {
+            for(size_t i = 0; i < node->rows.size(); i++) {
+                bool is_last = i == node->rows.size() - 1;
+
+                // Indentation and vertical lines for ancestor levels
+                for(bool last : last_entry_stack) out += last ? "  " : "│ ";
+                out += is_last ? "└─" : "├─";
+                out += node->rows[i].text + "\n";
+
+                if(node->rows[i].child) {
+                    last_entry_stack.push_back(is_last);
+                    print_listing(node->rows[i].child, opts, last_entry_stack, out, mutex, cv, walk_done);
+                    last_entry_stack.pop_back();
+                }
+            }
+        }
 
-        io::print("\n");
-        return 0;
+        if(out.size() > 64 * 1024) {
+            io::print(out);
+            out.clear();
+        }
+        // Printed, so it's not needed anymore
+        std::vector<Row>().swap(node->rows);
+        node->subdirs.clear();
     }
 
-    int tree_print(std::string dir_path, bool print_hidden, bool git, std::vector<bool> last_entry_stack = {}) {
-        DIR *dir = opendir(dir_path.c_str());
-        if (!dir) {
-            info::error(strerror(errno), errno, dir_path);
-            return -1;
-        }
+    // -R and --tree. Directories are read concurrently by the walker, each one sorted and laid out as soon
+    // as it's read, while this thread prints them in order. The printed order is the same as a serial walk
+    int recursive_print(std::string dir_path, ListOptions opts) {
+        auto root = std::make_unique<Listing>();
+        root->path = dir_path;
 
-        struct dirent *entry;
-        std::vector<std::string> names;
+        std::unordered_map<std::string, std::string> statuses;
+        if(opts.git) {
+            if(!load_git_statuses(dir_path, statuses, root->rel)) return -1;
+            opts.statuses = &statuses;
+        }
 
-        // Collect entries
-        while ((entry = readdir(dir)) != nullptr) {
-            std::string name = entry->d_name;
-            if ((name == "." || name == "..") || (!print_hidden && name.starts_with("."))) {
-                continue;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool walk_done = false;
+        std::unordered_map<std::string, int> errors; // By path, picked up in leave
+        int terminal_width = get_terminal_width();
+
+        walk::Options options;
+        options.visit = [&](walk::Entry& entry, unsigned) {
+            Listing* node = static_cast<Listing*>(entry.dir_data);
+            std::string name(entry.name);
+            if(!opts.hidden && name.starts_with(".")) return false;
+
+            unsigned char type = entry.type();
+            std::string rel = opts.git ? (node->rel.empty() ? name : node->rel + "/" + name) : "";
+            Row row = opts.tree ? make_tree_row(entry.dir_fd, name, type, rel, opts) : make_row(entry.dir_fd, name, type, rel, opts);
+            if(type != DT_DIR) {
+                node->rows.push_back(std::move(row));
+                return false;
             }
-            names.push_back(name);
-        }
 
-        GitRepo repo(dir_path);
+            auto child = std::make_unique<Listing>();
+            child->path = entry.path();
+            child->rel = rel;
+            row.child = child.get();
+            entry.child_data = child.get();
+            node->subdirs.push_back(std::move(child));
+            node->rows.push_back(std::move(row));
+            return true;
+        };
 
-        std::sort(names.begin(), names.end());
-        for (size_t i = 0; i < names.size(); ++i) {
-            bool is_last = (i == names.size() - 1);
-            std::string name = names[i];
-            std::string path = dir_path + "/" + name;
+        options.error = [&](const std::string& path, int err) {
+            std::lock_guard lock(mutex);
+            errors[path] = err;
+        };
 
-            struct stat path_stat;
-            if (lstat(path.c_str(), &path_stat) == -1) {
-                perror("lstat");
-                continue;
+        options.leave = [&](void* data) {
+            Listing* node = static_cast<Listing*>(data);
+            std::sort(node->rows.begin(), node->rows.end(), [](const Row& a, const Row& b) {
+                return a.name < b.name;
+            });
+
+            if(!opts.tree) {
+                std::string header = node->path + ":";
+                if(use_colors) header = bold + blue + header + reset;
+                node->block = (node == root.get() ? "" : "\n") + header + "\n";
+                if(!node->rows.empty()) node->block += format_grid(node->rows, terminal_width);
             }
 
-            // Print indentation and vertical lines for ancestor levels
-            for (size_t lvl = 0; lvl < last_entry_stack.size(); ++lvl) {
-                if (last_entry_stack[lvl]) {
-                    io::print("  ");    // no vertical line, last entry at this level
-                } else {
-                    io::print("│ ");
-                }
-            }
+            std::lock_guard lock(mutex);
+            auto it = errors.find(node->path);
+            if(it != errors.end()) node->error = it->second;
+            node->ready = true;
+            cv.notify_all();
+        };
 
-            // Print branch for current entry
-            io::print(is_last ? "└─" : "├─");
-
-            if(!git) {
-                if (S_ISDIR(path_stat.st_mode)) {
-                    io::print(bold + blue + name + reset + "\n");
-                    auto new_stack = last_entry_stack;
-                    new_stack.push_back(is_last);
-                    tree_print(path, print_hidden, git, new_stack);
-                } else if (S_ISLNK(path_stat.st_mode)) {
-                    char buf[1024];
-                    ssize_t len = readlink(path.c_str(), buf, sizeof(buf) - 1);
-                    if (len != -1) {
-                        buf[len] = '\0';
-                        io::print(bold + orange + name + reset + " -> " + buf + "\n");
-                    } else {
-                        io::print(orange + name + reset + " -> [unreadable]\n");
-                    }
-                } else if (S_ISSOCK(path_stat.st_mode)) {
-                    io::print(bold + magenta + name + reset + "\n");
-                } else if (S_ISFIFO(path_stat.st_mode)) {
-                    io::print(bold + red + name + reset + "\n");
-                } else {
-                    io::print(green + name + reset + "\n");
-                }
-            } else {
-                if(repo.get_repo() == nullptr) {
-                    info::error("The directory is not a git repository.");
-                    return -1;
-                }
-                
-                std::string color;
-
-                std::string repo_root = repo.get_root_path();
-                if (!repo_root.empty()) {
-                    std::filesystem::path file_path = std::filesystem::absolute(dir_path + "/" + name);
-                    std::filesystem::path root_path = std::filesystem::path(repo_root);
-                    std::string relative_path = std::filesystem::relative(file_path, root_path).string();
-
-                    std::string status = repo.get_file_status(relative_path);
-
-                    if (status == "U") {
-                        color = blue;  // Red (unmodified)
-                    } else if (status == "M") {
-                        color = "\033[33m";  // Yellow (modified)
-                    } else if (status == "S") {
-                        color = "\033[32m";  // Green (staged)
-                    } else if (status == "I") {
-                        color = "\033[90m";  // Gray (ignored)
-                    } else if (status == "R") {
-                        color = "\033[36m";  // Cyan (renamed)
-                    } else if (status == "N") {
-                        color = gray;   //  (untracked)
-                    } else {
-                        color = "\033[0m";   // Fallback/reset
-                    }
-
-                    if(S_ISDIR(path_stat.st_mode)) {
-                        // Directories arent exactly "tracked" like files
-                        io::print(bold + magenta + name + " ()" + reset + "\n");
-                        auto new_stack = last_entry_stack;
-                        new_stack.push_back(is_last);
-                        tree_print(path, print_hidden, git, new_stack);
-                    } else {
-                        io::print(color + name + " (" + status + ")" + reset + "\n");
-                    }
-                } else {
-                    info::error("Failed to get Git root path.");
-                    return -1;
-                }
+        int status = 0;
+        std::thread walker([&]() {
+            if(walk::parallel_walk(dir_path, options, root.get()) != 0) {
+                std::lock_guard lock(mutex);
+                int err = errors.empty() ? errno : errors.begin()->second;
+                info::error(strerror(err), err, dir_path);
+                status = -1;
             }
-        }
+            std::lock_guard lock(mutex);
+            walk_done = true;
+            cv.notify_all();
+        });
 
-        closedir(dir);
-        return 0;
+        std::string out;
+        std::vector<bool> last_entry_stack;
+        print_listing(root.get(), opts, last_entry_stack, out, mutex, cv, walk_done);
+        io::print(out);
+
+        walker.join();
+        return status;
     }
 
 public:
@@ -372,13 +487,14 @@ public:
 
         std::string path;
         bool print_tree = false;
+        bool recursive = false;
         bool print_hidden = false;
         bool with_icons = false;
         bool with_git = false;
 
         std::vector<std::string> validArgs = {
-            "-t", "-a", "-i", "-g", "-h"
-            "--tree", "--all", "--icons", "--git", "--help"
+            "-t", "-R", "-a", "-i", "-g", "-h",
+            "--tree", "--recursive", "--all", "--icons", "--git", "--help"
         };
 
         for (auto& arg : args) {
@@ -388,6 +504,7 @@ public:
             }
 
             if (arg == "-t" || arg == "--tree") print_tree = true;
+            if (arg == "-R" || arg == "--recursive") recursive = true;
             if (arg == "-a" || arg == "--all") print_hidden = true;
             if (arg == "-i" || arg == "--icons") with_icons = true;
             if (arg == "-g" || arg == "--git") with_git = true;
@@ -402,6 +519,7 @@ public:
                     },
                     {
                         {"-t", "--tree", "Prints content recursively"},
+                        {"-R", "--recursive", "Lists every subdirectory after its parent"},
                         {"-a", "--all", "Print hidden files too"},
                         {"-i", "--icons", "Print with nerd font icons"},
                         {"-g", "--git", "Print with git statuses"}
@@ -409,6 +527,7 @@ public:
                     {
                         {"ls", "Print all files in the current directory"},
                         {"ls /dev", "Print all files in /dev"},
+                        {"ls -R src", "Print src and everything below it, one directory at a time"},
                         {"ls -t -a /", "Print every single file in the system (Go on try it)"},
                     },
                     "",
@@ -429,9 +548,13 @@ public:
             dirpath = buffer;
         }
 
-        if (print_tree) {
-            tree_print(dirpath, print_hidden, with_git);
-            return 0;
+        if (print_tree || recursive) {
+            ListOptions opts;
+            opts.hidden = print_hidden;
+            opts.icons = with_icons && !print_tree;
+            opts.git = with_git;
+            opts.tree = print_tree;
+            return recursive_print(dirpath, opts);
         } else {
             default_print(dirpath, print_hidden, with_icons, with_git);
             return 0;
@@ -1,41 +1,816 @@
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/filestream.h"
 #include "../abstractions/info.h"
 #include "../help_helper.h"
 
 #include <vector>
-#include <boost/regex.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
 #include <sys/ioctl.h>
 #include <csignal>
 #include <thread>
 #include <termios.h>
 #include "../tui/tui.h"
 
-class Md {
+#pragma region parser
+
+// A CommonMark subset: ATX and setext headings, paragraphs, block quotes, lists (with task boxes), fenced
+// and indented code, thematic breaks, pipe tables and HTML lines for blocks, and emphasis, code spans,
+// links, images and autolinks inline. It's parsed in one pass into blocks of styled spans, which know
+// nothing about the terminal, so they can be laid out again at any width without parsing anything twice
+
+enum SpanStyle : uint16_t {
+  PLAIN     = 0,
+  BOLD      = 1 << 0,
+  ITALIC    = 1 << 1,
+  CODE      = 1 << 2,
+  STRIKE    = 1 << 3,
+  UNDERLINE = 1 << 4,
+  HIGHLIGHT = 1 << 5,
+  LINK      = 1 << 6, // The text of a [link](url)
+  URL       = 1 << 7, // The (url) shown after it, and autolinks
+  IMAGE     = 1 << 8,
+  HEADER    = 1 << 9  // Table header cells
+};
+
+struct Span {
+  uint16_t style = PLAIN;
+  std::string text;
+  std::string link; // Where a LINK goes, empty otherwise
+};
+
+enum class BlockType { PARAGRAPH, HEADING, LIST_ITEM, CODE, RULE, TABLE, HTML };
+
+struct Block {
+  BlockType type = BlockType::PARAGRAPH;
+  int level = 0;                  // Heading level, or how deeply a list item is nested
+  int quote = 0;                  // How many > it's inside of
+  bool blank_before = false;      // The source had an empty line in front of it
+  std::string marker;             // A list item's bullet, number or task box
+  std::vector<Span> spans;        // Paragraphs, headings and list items
+  std::vector<std::string> lines; // Code and HTML, as they are
+  std::vector<std::vector<std::vector<Span>>> rows; // Table cells, row by row with the header first
+  std::vector<char> align;        // 'l', 'c' or 'r' for each table column
+};
+
+// Turns the text of one block into spans. Every kind of delimiter remembers where it last failed to find
+// a closer: it won't find one from anywhere later either, so an unclosed * doesn't make the rest of
+// the block get scanned again for every * in it
+class InlineParser {
   private:
+  std::string_view text;
+  std::vector<Span>& out;
+  std::unordered_map<std::string_view, size_t> unclosed; // Delimiter -> offset it can't be closed after
+
+  void add(std::string_view s, uint16_t style, const std::string& link) {
+    if(s.empty()) return;
+    if(!out.empty() && out.back().style == style && out.back().link == link) out.back().text += s;
+    else out.push_back({style, std::string(s), link});
+  }
+
+  size_t closer(std::string_view delim, size_t from, size_t end) {
+    auto it = unclosed.find(delim);
+    if(it != unclosed.end() && from >= it->second) return std::string_view::npos;
+
+    size_t at = text.find(delim, from);
+    if(at == std::string_view::npos) unclosed[delim] = from;
+    return at != std::string_view::npos && at + delim.size() <= end ? at : std::string_view::npos;
+  }
+
+  // The ] that matches the [ at open, skipping over nested pairs
+  size_t bracket(size_t open, size_t end) {
+    if(closer("]", open, end) == std::string_view::npos) return std::string_view::npos;
+    int depth = 0;
+    for(size_t i = open; i < end; i++) {
+      if(text[i] == '\\') i++;
+      else if(text[i] == '[') depth++;
+      else if(text[i] == ']' && --depth == 0) return i;
+    }
+    return std::string_view::npos;
+  }
+
+  void parse(size_t from, size_t end, uint16_t style, const std::string& link) {
+    static const std::pair<std::string_view, uint16_t> delimiters[] = {
+      {"**", BOLD}, {"__", UNDERLINE}, {"~~", STRIKE}, {"==", HIGHLIGHT}, {"*", ITALIC}, {"_", ITALIC}
+    };
+
+    size_t plain = from; // Start of the text not added yet
+    auto flush = [&](size_t i) { add(text.substr(plain, i - plain), style, link); };
+
+    for(size_t i = from; i < end;) {
+      char c = text[i];
+
+      if(c == '\\' && i + 1 < end && ispunct((unsigned char)text[i + 1])) {
+        flush(i);
+        add(text.substr(i + 1, 1), style, link);
+        i += 2;
+        plain = i;
+        continue;
+      }
+
+      if(c == '`') {
+        size_t run = 1;
+        while(i + run < end && text[i + run] == '`') run++;
+        size_t close = closer(text.substr(i, run), i + run, end);
+        if(close != std::string_view::npos) {
+          flush(i);
+          std::string_view code = text.substr(i + run, close - i - run);
+          if(code.size() > 2 && code.front() == ' ' && code.back() == ' ') code = code.substr(1, code.size() - 2);
+          add(code, style | CODE, link);
+          i = close + run;
+          plain = i;
+        } else i += run;
+        continue;
+      }
+
+      bool matched = false;
+      for(auto& [delim, flag] : delimiters) {
+        if(text.compare(i, delim.size(), delim) != 0) continue;
+        matched = true;
+
+        // Has to hug what it wraps, and _ doesn't count inside_words_like_this
+        size_t inner = i + delim.size();
+        bool underscore = delim[0] == '_';
+        bool opens = inner < end && !isspace((unsigned char)text[inner]) && !(underscore && i > 0 && isalnum((unsigned char)text[i - 1]));
+        size_t close = opens ? closer(delim, inner + 1, end) : std::string_view::npos;
+        bool closes = close != std::string_view::npos && !isspace((unsigned char)text[close - 1])
+          && !(underscore && close + delim.size() < end && isalnum((unsigned char)text[close + delim.size()]));
+
+        if(closes) {
+          flush(i);
+          parse(inner, close, style | flag, link);
+          i = close + delim.size();
+          plain = i;
+        } else i += delim.size();
+        break;
+      }
+      if(matched) continue;
+
+      // [text](url) and ![alt](url)
+      bool image = c == '!' && i + 1 < end && text[i + 1] == '[';
+      if(c == '[' || image) {
+        size_t open = image ? i + 1 : i;
+        size_t close = bracket(open, end);
+        size_t paren = close != std::string_view::npos && close + 1 < end && text[close + 1] == '(' ? closer(")", close + 2, end) : std::string_view::npos;
+        if(paren != std::string_view::npos) {
+          flush(i);
+          std::string url(text.substr(close + 2, paren - close - 2));
+          size_t title = url.find(" \"");
+          if(title != std::string::npos) url.erase(title);
+
+          if(image) {
+            add("[IMG] ", style, link);
+            add(text.substr(open + 1, close - open - 1), style | IMAGE, link);
+            add(" (" + url + ")", style | URL, link);
+          } else {
+            parse(open + 1, close, style | LINK, url);
+            add(" (" + url + ")", style | URL, "");
+          }
+          i = paren + 1;
+          plain = i;
+          continue;
+        }
+      }
+
+      // <https://autolinks>, and HTML tags, which get dropped (<br> breaks the line)
+      if(c == '<') {
+        size_t close = closer(">", i + 1, end);
+        std::string_view inside = close == std::string_view::npos ? "" : text.substr(i + 1, close - i - 1);
+        bool autolink = !inside.empty() && inside.find(' ') == std::string_view::npos
+          && (inside.find("://") != std::string_view::npos || inside.find('@') != std::string_view::npos);
+        bool tag = !inside.empty() && (isalpha((unsigned char)inside[0]) || inside[0] == '/' || inside[0] == '!');
+
+        if(autolink || tag) {
+          flush(i);
+          if(autolink) add(inside, style | URL, std::string(inside.find("://") == std::string_view::npos ? "mailto:" : "") + std::string(inside));
+          else if(inside.starts_with("br")) add("\n", style, link);
+          i = close + 1;
+          plain = i;
+          continue;
+        }
+      }
+
+      i++;
+    }
+    flush(end);
+  }
+
+  public:
+  InlineParser(std::string_view text, std::vector<Span>& out) : text(text), out(out) {}
+  void run() { parse(0, text.size(), PLAIN, ""); }
+};
+
+static bool blank(std::string_view line) {
+  return line.find_first_not_of(" \t") == std::string_view::npos;
+}
+
+// ---, ***, ___ (with spaces in between allowed), at least three of the same
+static bool is_rule(std::string_view line) {
+  char c = line.empty() ? 0 : line[0];
+  if(c != '-' && c != '*' && c != '_') return false;
+  int count = 0;
+  for(char ch : line) {
+    if(ch == c) count++;
+    else if(ch != ' ' && ch != '\t') return false;
+  }
+  return count >= 3;
+}
+
+static std::vector<std::string_view> table_cells(std::string_view line) {
+  while(!line.empty() && (line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+  if(line.starts_with("|")) line.remove_prefix(1);
+  if(line.ends_with("|") && !line.ends_with("\\|")) line.remove_suffix(1);
+
+  std::vector<std::string_view> cells;
+  size_t start = 0;
+  for(size_t i = 0; i <= line.size(); i++) {
+    if(i < line.size() && line[i] == '\\') {
+      i++;
+      continue;
+    }
+    if(i == line.size() || line[i] == '|') {
+      std::string_view cell = line.substr(start, i - start);
+      size_t first = cell.find_first_not_of(' ');
+      cell = first == std::string_view::npos ? "" : cell.substr(first, cell.find_last_not_of(' ') - first + 1);
+      cells.push_back(cell);
+      start = i + 1;
+    }
+  }
+  return cells;
+}
 
-    void draw_statusbar(int current_line, std::vector<std::string> lines) {
-      io::print("\x1b[" + std::to_string(Tui::get_terminal_height()) + ";1H");
-      std::stringstream ss;
-      ss << bg_green << black << " md " << reset << bg_gray << " q to quit ";
+// |---|:--:|---:| under a table's header
+static bool is_table_delimiter(std::string_view line, std::vector<char>& align) {
+  if(line.find('-') == std::string_view::npos || line.find('|') == std::string_view::npos) return false;
+  align.clear();
+  for(std::string_view cell : table_cells(line)) {
+    if(cell.empty() || cell.find_first_not_of(":-") != std::string_view::npos) return false;
+    bool left = cell.front() == ':', right = cell.back() == ':';
+    align.push_back(left && right ? 'c' : right ? 'r' : 'l');
+  }
+  return !align.empty();
+}
+
+std::vector<Block> parse_markdown(std::string_view text) {
+  std::vector<std::string_view> lines;
+  for(std::string_view line : io::Lines(text)) {
+    if(line.ends_with('\r')) line.remove_suffix(1);
+    lines.push_back(line);
+  }
+
+  std::vector<Block> blocks;
+  std::string pending;     // Inline source of the paragraph, heading or list item being collected
+  int pending_block = -1;  // Which block that is
+  bool blank_line = false; // Seen since the last block started
+  bool hard_break = false; // The last line of pending ended with two spaces or a backslash
+
+  // Fenced code being read: its fence and block
+  char fence = 0;
+  size_t fence_length = 0;
+  int fence_block = -1;
+  int indented_block = -1; // The last indented code block, which more indented lines join
+
+  auto finish = [&]() {
+    if(pending_block < 0) return;
+    InlineParser(pending, blocks[pending_block].spans).run();
+    pending_block = -1;
+    pending.clear();
+  };
+
+  auto start = [&](BlockType type, int quote) -> Block& {
+    finish();
+    Block block;
+    block.type = type;
+    block.quote = quote;
+    block.blank_before = blank_line && !blocks.empty();
+    blank_line = false;
+    blocks.push_back(std::move(block));
+    return blocks.back();
+  };
+
+  auto collect = [&](std::string_view content) {
+    pending_block = blocks.size() - 1;
+    pending = content;
+    hard_break = false;
+  };
+
+  for(size_t n = 0; n < lines.size(); n++) {
+    std::string_view rest = lines[n];
+
+    // Block quote markers, each up to 3 spaces in, with the space after them
+    int quote = 0;
+    while(true) {
+      size_t at = rest.find_first_not_of(' ');
+      if(at == std::string_view::npos || at > 3 || rest[at] != '>') break;
+      rest.remove_prefix(at + 1);
+      if(rest.starts_with(' ')) rest.remove_prefix(1);
+      quote++;
+    }
 
+    if(fence) {
+      size_t at = rest.find_first_not_of(' ');
+      std::string_view trimmed = at == std::string_view::npos ? "" : rest.substr(at);
+      size_t run = trimmed.find_first_not_of(fence);
+      if(at != std::string_view::npos && at <= 3 && trimmed[0] == fence && (run == std::string_view::npos ? trimmed.size() : run) >= fence_length
+         && blank(trimmed.substr(run == std::string_view::npos ? trimmed.size() : run))) {
+        fence = 0;
+        continue;
+      }
+      blocks[fence_block].lines.emplace_back(rest);
+      continue;
+    }
 
-      int percent = lines.size() < Tui::get_terminal_height() ? 100 : static_cast<int>((static_cast<double>(current_line) / (int)lines.size()) * 100);
-      int width = Tui::get_terminal_width();
+    if(blank(rest)) {
+      finish();
+      blank_line = true;
+      continue;
+    }
 
-      if (lines.size() == 0) {
-        int space_length = width - 4 - 8 - 11; // 4 for " md ", 8 for "<empty> "
-        ss << std::string(space_length, ' ') << yellow << "<empty> " << reset;
+    size_t indent = 0, at = 0;
+    for(; at < rest.size() && (rest[at] == ' ' || rest[at] == '\t'); at++) indent += rest[at] == '\t' ? 4 - indent % 4 : 1;
+    std::string_view trimmed = rest.substr(at);
+    while(!trimmed.empty() && (trimmed.back() == ' ' || trimmed.back() == '\t')) trimmed.remove_suffix(1);
+
+    Block* open = pending_block >= 0 ? &blocks[pending_block] : nullptr;
+
+    // Indented code, unless it's the continuation of a paragraph or belongs to a list item
+    Block* last = blocks.empty() ? nullptr : &blocks.back();
+    bool in_list = last && (last->type == BlockType::LIST_ITEM || (last->type == BlockType::PARAGRAPH && last->level > 0));
+    int list_level = !in_list ? 0 : last->type == BlockType::LIST_ITEM ? last->level + 1 : last->level;
+    if(indent >= 4 && !open && !in_list) {
+      std::string_view code = rest.substr(std::min<size_t>(at, 4));
+      if(last && indented_block == (int)blocks.size() - 1 && last->quote == quote) {
+        if(blank_line) last->lines.emplace_back();
+        blank_line = false;
       } else {
-        std::string percent_str = std::to_string(percent) + "%";
-        int padding = width - 4 - 11 - static_cast<int>(percent_str.size()) - 1; // 1 for the single trailing space
-        ss << std::string(padding, ' ') << percent_str << ' ';
+        start(BlockType::CODE, quote);
+        indented_block = blocks.size() - 1;
+      }
+      blocks.back().lines.emplace_back(code);
+      continue;
+    }
+
+    if(indent < 4) {
+      if(trimmed.starts_with("```") || trimmed.starts_with("~~~")) {
+        start(BlockType::CODE, quote);
+        fence = trimmed[0];
+        fence_length = std::min(trimmed.find_first_not_of(fence), trimmed.size());
+        fence_block = blocks.size() - 1;
+        continue;
+      }
+
+      size_t hashes = trimmed.find_first_not_of('#');
+      if(hashes == std::string_view::npos) hashes = trimmed.size();
+      if(hashes >= 1 && hashes <= 6 && (hashes == trimmed.size() || trimmed[hashes] == ' ')) {
+        std::string_view content = trimmed.substr(hashes);
+        size_t end = content.find_last_not_of("# ");
+        size_t first = content.find_first_not_of(' ');
+        content = first == std::string_view::npos || end == std::string_view::npos ? "" : content.substr(first, end - first + 1);
+        start(BlockType::HEADING, quote).level = hashes;
+        collect(content);
+        finish();
+        continue;
+      }
+
+      // A line of = or - under a paragraph makes it a heading
+      if(open && open->type == BlockType::PARAGRAPH && open->quote == quote && !blank_line
+         && ((trimmed.find_first_not_of('=') == std::string_view::npos) || (trimmed.size() >= 2 && trimmed.find_first_not_of('-') == std::string_view::npos))) {
+        open->type = BlockType::HEADING;
+        open->level = trimmed[0] == '=' ? 1 : 2;
+        finish();
+        continue;
+      }
+
+      if(is_rule(trimmed)) {
+        start(BlockType::RULE, quote);
+        continue;
+      }
+
+      std::vector<char> align;
+      if(trimmed.find('|') != std::string_view::npos && n + 1 < lines.size() && is_table_delimiter(lines[n + 1], align)) {
+        Block& table = start(BlockType::TABLE, quote);
+        table.align = align;
+        size_t row = n;
+        for(; row < lines.size() && !blank(lines[row]) && lines[row].find('|') != std::string_view::npos; row++) {
+          if(row == n + 1) continue; // The delimiter row
+          std::vector<std::vector<Span>> cells;
+          for(std::string_view cell : table_cells(lines[row])) InlineParser(cell, cells.emplace_back()).run();
+          table.rows.push_back(std::move(cells));
+        }
+        n = row - 1;
+        continue;
+      }
+    }
+
+    // List items: -, *, + or a number followed by . or ), maybe with a [ ] or [x] task box
+    size_t marker_end = 0;
+    std::string marker;
+    if(!trimmed.empty() && (trimmed[0] == '-' || trimmed[0] == '*' || trimmed[0] == '+') && (trimmed.size() == 1 || trimmed[1] == ' ')) {
+      marker = "•";
+      marker_end = 1;
+    } else {
+      size_t digits = trimmed.find_first_not_of("0123456789");
+      if(digits != std::string_view::npos && digits >= 1 && digits <= 9 && (trimmed[digits] == '.' || trimmed[digits] == ')')
+         && (digits + 1 == trimmed.size() || trimmed[digits + 1] == ' ') && !(open && open->type == BlockType::PARAGRAPH && trimmed.substr(0, digits) != "1")) {
+        marker = std::string(trimmed.substr(0, digits + 1));
+        marker_end = digits + 1;
+      }
+    }
+
+    std::string_view content = marker_end ? trimmed.substr(std::min(marker_end + 1, trimmed.size())) : trimmed;
+    std::string task;
+    if(content.starts_with("[ ] ") || content.starts_with("[] ") || content == "[ ]") task = "\U000f0130";
+    else if(content.starts_with("[x] ") || content.starts_with("[X] ") || content == "[x]" || content == "[X]") task = "\U000f0133";
+    if(!task.empty() && (marker_end || !open)) {
+      content = content.substr(std::min(content.find(']') + 2, content.size()));
+      marker = marker.empty() ? task : marker + " " + task;
+    }
+
+    if(!marker.empty()) {
+      Block& item = start(BlockType::LIST_ITEM, quote);
+      item.level = indent / 2;
+      item.marker = marker;
+      collect(content);
+      continue;
+    }
+
+    if(!open && indent < 4 && trimmed.size() > 1 && trimmed[0] == '<' && (isalpha((unsigned char)trimmed[1]) || trimmed[1] == '/' || trimmed[1] == '!')) {
+      if(blocks.empty() || blocks.back().type != BlockType::HTML || blank_line || blocks.back().quote != quote) start(BlockType::HTML, quote);
+      blocks.back().lines.emplace_back(trimmed);
+      continue;
+    }
+
+    // Everything else continues the open paragraph or list item, or starts a paragraph
+    if(open && !blank_line) {
+      if(hard_break) {
+        while(!pending.empty() && (pending.back() == ' ' || pending.back() == '\\')) pending.pop_back();
+        pending += '\n';
+      } else pending += ' ';
+      hard_break = rest.ends_with("  ") || rest.ends_with("\\");
+      pending += trimmed;
+      continue;
+    }
+
+    // Indented under a list item it's another paragraph of that item
+    Block& paragraph = start(BlockType::PARAGRAPH, quote);
+    if(in_list && indent >= 2) paragraph.level = list_level;
+    collect(trimmed);
+    hard_break = rest.ends_with("  ") || rest.ends_with("\\");
+  }
+
+  finish();
+  return blocks;
+}
+
+#pragma endregion
+
+#pragma region layout
+
+const std::string quote_bar  = "\x1b[90m┃" + reset + " ";
+const std::string code_bg    = "\x1b[100m";
+const std::string osc8_start = "\x1b]8;;";
+const std::string osc8_end   = "\x1b]8;;\x1b\\";
+
+const std::string header_colors[6] = {
+  "\x1b[38;5;141m",
+  "\x1b[38;5;135m",
+  "\x1b[38;5;99m",
+  "\x1b[38;5;74m",
+  "\x1b[38;5;37m",
+  "\x1b[38;5;31m"
+};
+
+static std::string span_sgr(const Span& span) {
+  std::string sgr;
+  if(span.style & HEADER) sgr += bold;
+  if(span.style & BOLD) sgr += cyan + bold;
+  if(span.style & ITALIC) sgr += yellow + italic;
+  if(span.style & UNDERLINE) sgr += red + underline;
+  if(span.style & STRIKE) sgr += strikethr;
+  if(span.style & HIGHLIGHT) sgr += bg_yellow;
+  if(span.style & (LINK | IMAGE)) sgr += green;
+  if(span.style & URL) sgr += blue + (span.link.empty() ? "" : underline);
+  if(span.style & CODE) sgr += code_bg + green;
+  return sgr;
+}
+
+// Fills lines up to a width with words, breaking lines at spaces where it can and inside words only when
+// one doesn't fit on a line by itself. Each line starts with a prefix (quote bars, list markers) that is
+// different for the first one
+class Wrapper {
+  private:
+  std::vector<std::string>& out;
+  std::string base;   // SGR every piece starts from, a heading's colour
+  std::string prefix; // For the lines after the first
+  int width;          // Columns left for text after the prefix
+
+  std::string line;
+  int col = 0;
+  std::string word;
+  int word_width = 0;
+  std::string word_open; // What the last character in word was styled with
+  std::string word_close;
+  std::string space;     // A styled space owed before the next word, if any
+
+  void end_word_style() {
+    word += word_close;
+    word_open.clear();
+    word_close.clear();
+  }
+
+  void flush_word() {
+    if(word_width == 0) return;
+    end_word_style();
+    if(col > 0 && col + 1 + word_width > width) new_line();
+    if(col > 0 && !space.empty()) {
+      line += space;
+      col++;
+    }
+    line += word;
+    col += word_width;
+    word.clear();
+    word_width = 0;
+    space.clear();
+  }
+
+  public:
+  Wrapper(std::vector<std::string>& out, const std::string& base, const std::string& first, const std::string& rest, int width)
+    : out(out), base(base), prefix(rest), width(std::max(1, width - Tui::Screen::text_width(rest))), line(first) {}
+
+  void new_line() {
+    out.push_back(std::move(line));
+    line = prefix;
+    col = 0;
+    space.clear();
+  }
+
+  void add(const Span& span) {
+    std::string open = reset + base + span_sgr(span) + (span.link.empty() ? "" : osc8_start + span.link + "\x1b\\");
+    std::string close = (span.link.empty() ? "" : osc8_end) + reset;
+
+    std::string_view text = span.text;
+    for(size_t i = 0; i < text.size();) {
+      char c = text[i];
+      if(c == '\n') {
+        flush_word();
+        new_line();
+        i++;
+        continue;
+      }
+      if(c == ' ' || c == '\t') {
+        flush_word();
+        if(col > 0) space = open + " " + close;
+        i++;
+        continue;
+      }
+
+      size_t len = 1;
+      while(i + len < text.size() && (text[i + len] & 0xC0) == 0x80) len++;
+      std::string_view ch = text.substr(i, len);
+      int w = Tui::Screen::text_width(ch);
+      i += len;
+
+      // Too long for any line: give it the rest of this one and carry on on the next
+      if(word_width + w > width) {
+        if(col > 0) {
+          space.clear();
+          new_line();
+        }
+        if(word_width > 0) {
+          flush_word();
+          new_line();
+        }
+      }
+
+      if(open != word_open) {
+        word += word_close + open;
+        word_open = open;
+        word_close = close;
+      }
+      word += ch;
+      word_width += w;
+    }
+  }
+
+  void finish() {
+    flush_word();
+    out.push_back(std::move(line));
+  }
+};
+
+static std::string quote_prefix(int quote) {
+  std::string prefix;
+  for(int i = 0; i < quote; i++) prefix += quote_bar;
+  return prefix;
+}
+
+static std::vector<std::string> layout_table(const Block& block, const std::string& quote) {
+  // Each cell laid out on one line, then padded to its column's width
+  std::vector<std::vector<std::pair<std::string, int>>> cells;
+  std::vector<int> widths(block.align.size(), 0);
+  for(size_t r = 0; r < block.rows.size(); r++) {
+    auto& row = cells.emplace_back();
+    for(size_t c = 0; c < block.align.size(); c++) {
+      std::vector<std::string> text;
+      Wrapper wrapper(text, "", "", "", INT32_MAX);
+      if(c < block.rows[r].size()) {
+        for(Span span : block.rows[r][c]) {
+          if(r == 0) span.style |= HEADER;
+          wrapper.add(span);
+        }
+      }
+      wrapper.finish();
+
+      std::string joined;
+      for(auto& piece : text) joined += (joined.empty() ? "" : " ") + piece;
+      int width = Tui::Screen::text_width(joined);
+      widths[c] = std::max(widths[c], width);
+      row.push_back({joined, width});
+    }
+  }
+
+  std::vector<std::string> out;
+  const std::string bar = "\x1b[90m│" + reset;
+  for(size_t r = 0; r < cells.size(); r++) {
+    std::string line = quote;
+    for(size_t c = 0; c < cells[r].size(); c++) {
+      auto& [text, width] = cells[r][c];
+      int pad = widths[c] - width;
+      int left = block.align[c] == 'r' ? pad : block.align[c] == 'c' ? pad / 2 : 0;
+      line += (c ? " " + bar + " " : "") + std::string(left, ' ') + text + std::string(pad - left, ' ');
+    }
+    out.push_back(line);
+
+    if(r == 0) {
+      std::string rule = quote + "\x1b[90m";
+      for(size_t c = 0; c < widths.size(); c++) {
+        if(c) rule += "─┼─";
+        for(int i = 0; i < widths[c]; i++) rule += "─";
+      }
+      out.push_back(rule + reset);
+    }
+  }
+  return out;
+}
+
+// The lines a block takes up on screen at a width, with an empty one in front if it had one in the source
+std::vector<std::string> layout(const Block& block, int width) {
+  std::vector<std::string> out;
+  std::string quote = quote_prefix(block.quote);
+  if(block.blank_before) out.push_back(quote);
+
+  switch(block.type) {
+    case BlockType::PARAGRAPH:
+    case BlockType::HEADING:
+    case BlockType::LIST_ITEM: {
+      std::string base, first = quote, rest = quote;
+      if(block.type == BlockType::HEADING) {
+        base = header_colors[block.level - 1];
+        std::string hashes = block.level > 1 ? std::string(block.level, '#') + " " : "";
+        first += base + hashes;
+        rest += std::string(hashes.size(), ' ');
+      } else if(block.type == BlockType::LIST_ITEM) {
+        std::string indent(2 + block.level * 2, ' ');
+        std::string marker = block.marker;
+        if(marker.ends_with("\U000f0133")) marker.insert(marker.size() - 4, green);
+        first += indent + marker + reset + " ";
+        rest += std::string(indent.size() + Tui::Screen::text_width(block.marker) + 1, ' ');
+      } else if(block.level > 0) {
+        first += std::string(2 + block.level * 2, ' ');
+        rest = first;
+      }
+
+      Wrapper wrapper(out, base, first, rest, width);
+      for(const Span& span : block.spans) wrapper.add(span);
+      wrapper.finish();
+      break;
+    }
+
+    case BlockType::CODE:
+      for(const std::string& line : block.lines) out.push_back(quote + "  " + green + line + reset);
+      break;
+
+    case BlockType::HTML:
+      for(const std::string& line : block.lines) out.push_back(quote + "\x1b[90m" + line + reset);
+      break;
+
+    case BlockType::RULE: {
+      std::string rule = quote;
+      for(int i = Tui::Screen::text_width(quote); i < width; i++) rule += "─";
+      out.push_back(rule);
+      break;
+    }
+
+    case BlockType::TABLE: {
+      auto table = layout_table(block, quote);
+      out.insert(out.end(), table.begin(), table.end());
+      break;
+    }
+  }
+
+  if(out.empty()) out.push_back(quote);
+  return out;
+}
+
+#pragma endregion
+
+class Md {
+  private:
+
+    Tui::Screen screen;
+    Tui::EventLoop loop;
+
+    // Parsed once. Blocks are laid out when they first come into view and again only when the width changes
+    std::vector<Block> blocks;
+    std::vector<std::vector<std::string>> laid_out;
+    std::vector<bool> is_laid_out;
+    int layout_width = 0;
+
+    struct Position {
+      size_t block = 0;
+      size_t line = 0; // Within the block's lines
+    };
+
+    Position top; // First line on screen
+
+    const std::vector<std::string>& lines_of(size_t block) {
+      if(!is_laid_out[block]) {
+        laid_out[block] = layout(blocks[block], layout_width);
+        is_laid_out[block] = true;
       }
+      return laid_out[block];
+    }
 
-      ss << reset;
-      io::print(ss.str());
+    bool advance(Position& pos) {
+      if(pos.line + 1 < lines_of(pos.block).size()) pos.line++;
+      else if(pos.block + 1 < blocks.size()) pos = {pos.block + 1, 0};
+      else return false;
+      return true;
     }
 
+    bool retreat(Position& pos) {
+      if(pos.line > 0) pos.line--;
+      else if(pos.block > 0) pos = {pos.block - 1, lines_of(pos.block - 1).size() - 1};
+      else return false;
+      return true;
+    }
 
+    int visible() { return std::max(1, screen.rows() - 1); }
+
+    // Whether there are lines below the bottom of the screen
+    bool can_scroll_down() {
+      if(blocks.empty()) return false;
+      Position pos = top;
+      for(int i = 0; i < visible(); i++) {
+        if(!advance(pos)) return false;
+      }
+      return true;
+    }
+
+    void scroll(int lines) {
+      for(; lines > 0 && can_scroll_down(); lines--) advance(top);
+      for(; lines < 0 && retreat(top); lines++);
+    }
+
+    void scroll_to_end() {
+      if(blocks.empty()) return;
+      top = {blocks.size() - 1, lines_of(blocks.size() - 1).size() - 1};
+      for(int i = 1; i < visible() && retreat(top); i++);
+    }
+
+    // Lays everything out again if the terminal's width changed, keeping the same block at the top
+    void relayout() {
+      if(screen.cols() == layout_width) return;
+      layout_width = screen.cols();
+      laid_out.assign(blocks.size(), {});
+      is_laid_out.assign(blocks.size(), false);
+      if(!blocks.empty()) top.line = std::min(top.line, lines_of(top.block).size() - 1);
+    }
+
+    void draw_statusbar(int percent, bool empty) {
+      std::string left = bg_green + black + " md " + reset + bg_gray + " q to quit ";
+      std::string right = empty ? yellow + "<empty> " : std::to_string(percent) + "% ";
+
+      int padding = std::max(0, screen.cols() - Tui::Screen::text_width(left) - Tui::Screen::text_width(right));
+      screen.line(screen.rows() - 1, left + std::string(padding, ' ') + right + reset);
+    }
+
+    void redraw() {
+      screen.clear();
+      relayout();
+
+      Position pos = top;
+      for(int row = 0; row < visible() && !blocks.empty(); row++) {
+        screen.line(row, lines_of(pos.block)[pos.line]);
+        if(row + 1 < visible() && !advance(pos)) break;
+      }
+
+      int percent = !can_scroll_down() ? 100 : (pos.block + 1) * 100 / blocks.size();
+      draw_statusbar(percent, blocks.empty());
+      screen.present();
+    }
 
     static void sig_handler(int sig) {
       Tui::clear();
@@ -55,153 +830,40 @@ class Md {
         ttu = std::get<std::string>(content);
       } else ttu = text;
 
+      blocks = parse_markdown(ttu);
+
       signal(SIGINT, sig_handler);
       signal(SIGTERM, sig_handler);
 
       Tui::switch_to_alternate();
       enable_raw_mode();
 
-      const std::string osc8_start = "\x1b]8;;";
-      const std::string osc8_end   = "\x1b]8;;\x1b\\";
-
-      // === Regex patterns ===
-      boost::regex inline_code(R"(`([^`\n]+)`)");
-      boost::regex blockquotes(R"(^>(.*))", boost::regex_constants::perl);
-      boost::regex separators(R"(^(-|=|_){3,})", boost::regex_constants::perl);
-      boost::regex underl(R"(__([^_]+)__)");
-      boost::regex links(R"(\[([^\]]+)\]\(([^\)]+)\))");
-      boost::regex imgs(R"(!\[(.*?)\]\((.*?)\))");
-      boost::regex hyperlinks(R"(<([^\n>]+)>)");
-      boost::regex striketh(R"(\~\~([^\n\~]+)\~\~)");
-      boost::regex italic(R"((?<!\*)\*(?!\*)([^*\n]+)(?<!\*)\*(?!\*))");
-      boost::regex bld(R"(\*{2}([^\n*]+)\*{2})");
-      boost::regex highl(R"(==([^\n=]+)==)");
-      boost::regex nums_list(R"(^\d+\.)", boost::regex_constants::perl);
-      boost::regex unordered(R"(^-\s+)", boost::regex_constants::perl);
-      boost::regex done(R"(^\[x\])");
-      boost::regex undone(R"(^\[\s?\])");
-      boost::regex h1(R"(^#{1}\s([^\n#]+))", boost::regex_constants::perl);
-      boost::regex h2(R"(^#{2}\s([^\n#]+))", boost::regex_constants::perl);
-      boost::regex h3(R"(^#{3}\s([^\n#]+))", boost::regex_constants::perl);
-      boost::regex h4(R"(^#{4}\s([^\n#]+))", boost::regex_constants::perl);
-      boost::regex h5(R"(^#{5}\s([^\n#]+))", boost::regex_constants::perl);
-      boost::regex h6(R"(^#{6}\s([^\n#]+))", boost::regex_constants::perl);
-
-      boost::regex tables(R"(^ *\|.*\| *\n^ *\| *(:?-+:? *\|)+ *\n(^ *\|.*\| *\n)*)");
-
-      // === Colors / formatting ===
-      const std::string reset = "\x1b[0m";
-      const std::string bold = "\x1b[1m";
-      const std::string underline = "\x1b[4m";
-      const std::string green = "\x1b[32m";
-      const std::string blue = "\x1b[34m";
-      const std::string cyan = "\x1b[36m";
-      const std::string gray = "\x1b[90m";
-      const std::string bg_gray = "\x1b[100m";
-      const std::string bg_yellow = "\x1b[43m";
-      const std::string strikethr = "\x1b[9m";
-
-      const std::string header_colors[6] = {
-        "\x1b[38;5;141m",
-        "\x1b[38;5;135m",
-        "\x1b[38;5;99m",
-        "\x1b[38;5;74m",
-        "\x1b[38;5;37m",
-        "\x1b[38;5;31m"
-      };
-
-      // === Prepare separator line ===
-      std::string separator;
-      for (int i = 0; i < Tui::get_terminal_width(); i++) {
-        separator += "─";
-      }
+      redraw();
 
-      // === Start highlighting pipeline ===
-      std::string highlighted = ttu;
-
-      // Order matters — images before links
-      highlighted = boost::regex_replace(highlighted, imgs, "[IMG] " + green + "$1 " + reset + blue + "($2)" + reset);
-      highlighted = boost::regex_replace(
-          highlighted,
-          links,
-          osc8_start + "$2" + "\x1b\\" + green + "$1" + reset + osc8_end + " " + blue + " ($2)" + reset
-      );
-
-      highlighted = boost::regex_replace(highlighted, hyperlinks, blue + underline + "$1" + reset);
-
-      highlighted = boost::regex_replace(highlighted, separators, separator);
-      highlighted = boost::regex_replace(highlighted, bld, cyan + bold + "$1" + reset);
-      highlighted = boost::regex_replace(highlighted, italic, yellow + "\x1b[3m$1$2" + reset);
-      highlighted = boost::regex_replace(highlighted, inline_code, bg_gray + green + "$1" + reset);
-      highlighted = boost::regex_replace(highlighted, underl, red + underline + "$1" + reset);
-      highlighted = boost::regex_replace(highlighted, blockquotes, gray + "┃" + reset + "$1");
-      highlighted = boost::regex_replace(highlighted, striketh, strikethr + "$1" + reset);
-      highlighted = boost::regex_replace(highlighted, highl, bg_yellow + "$1" + reset);
-
-      highlighted = boost::regex_replace(highlighted, done, green + "\U000f0133" + reset);
-      highlighted = boost::regex_replace(highlighted, undone, "\U000f0130");
-
-      highlighted = boost::regex_replace(highlighted, nums_list, "  $0");
-      highlighted = boost::regex_replace(highlighted, unordered, "  • ");
-
-      // Headers
-      highlighted = boost::regex_replace(highlighted, h1, header_colors[0] + "$1" + reset);
-      highlighted = boost::regex_replace(highlighted, h2, header_colors[1] + "$&" + reset);
-      highlighted = boost::regex_replace(highlighted, h3, header_colors[2] + "$&" + reset);
-      highlighted = boost::regex_replace(highlighted, h4, header_colors[3] + "$&" + reset);
-      highlighted = boost::regex_replace(highlighted, h5, header_colors[4] + "$&" + reset);
-      highlighted = boost::regex_replace(highlighted, h6, header_colors[5] + "$&" + reset);
-
-      // === Rendering ===
-      int scroll_offset = 0;
-      int height = Tui::get_terminal_height();
-      std::vector<std::string> lines = io::split(highlighted, "\n");
-
-      auto redraw = [&](int sig = 0) {
-        Tui::clear();
-        for (int i = scroll_offset; i < std::min(scroll_offset + height, (int)lines.size()); i++) {
-          io::print(lines[i] + "\n");
+      loop.run([&](const Tui::Event& event) {
+        if (event.type == Tui::Event::RESIZE) {
+          redraw();
+          return;
         }
-        draw_statusbar(scroll_offset + Tui::get_terminal_height(), lines);
-      };
 
-      redraw();
+        const std::string& key = event.key;
 
-      while (true) {
-        char key;
-        if (read(STDIN_FILENO, &key, 1) != 1) continue;
-
-        if (key == 27) {
-          char seq[2];
-          if (read(STDIN_FILENO, &seq[0], 1) != 1) continue;
-          if (read(STDIN_FILENO, &seq[1], 1) != 1) continue;
-
-          switch (seq[1]) {
-            case 'A': { // Up
-              if (scroll_offset > 0) {
-                scroll_offset--;
-                redraw();
-              }
-              break;
-            }
-            case 'B': { // Down
-              if (scroll_offset + Tui::get_terminal_height() < (int)lines.size()) {
-                scroll_offset++;
-                redraw();
-              }
-              break;
-            }
-            default: break;
-          }
-        }
+        if (key == "ArrowUp") scroll(-1);
+        if (key == "ArrowDown") scroll(1);
+        if (key == "PageUp") scroll(-(visible() - 1));
+        if (key == "PageDown") scroll(visible() - 1);
+        if (key == "Home") top = {};
+        if (key == "End") scroll_to_end();
 
-        if (key == 'q') {
+        if (key == "q") {
           Tui::clear();
           Tui::switch_to_normal();
           disable_raw_mode();
           _exit(0);
         }
-      }
+
+        redraw();
+      });
       return 0;
     }
 
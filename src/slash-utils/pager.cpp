@@ -1,11 +1,423 @@
 #include "../tui/tui.h"
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/filestream.h"
+#include "../abstractions/watcher.h"
 #include "../abstractions/info.h"
 #include "../help_helper.h"
 
 #include <sstream>
 #include <csignal>
-#include <regex>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#pragma region source
+
+// What's being paged, split into lines by a background thread so the first screen shows up right away.
+// Regular files are mapped and only the line starts are kept; pipes and stdin get spooled into memory
+// as they're read. Reading a file stops at its end, unless it's followed (+F or F): then inotify says when
+// it grows or gets replaced, and it's mapped again
+class LineSource {
+  private:
+  mutable std::mutex mutex;
+  mutable std::condition_variable updated; // Notified whenever length or done change
+  std::vector<uint64_t> starts = {0}; // Offset of every line found so far
+  io::FileView file;
+  std::string spool;                  // Used instead of file for pipes, stdin and -t
+  bool from_file = false;
+  uint64_t length = 0;                // Bytes split into lines so far
+  bool done = false;                  // Everything there is for now has been read
+  bool following = false;             // Whether to keep reading a file after its end
+  int err = 0;
+
+  std::atomic<bool> stop{false};
+  std::thread reader;
+
+  std::string_view data() const { return from_file ? file.view() : std::string_view(spool); }
+
+  static void find_starts(std::string_view text, uint64_t offset, std::vector<uint64_t>& found) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    for(const char* p = begin; (p = static_cast<const char*>(memchr(p, '\n', end - p))); p++) {
+      found.push_back(offset + (p - begin) + 1);
+    }
+  }
+
+  void fail(int e) {
+    std::lock_guard lock(mutex);
+    err = e;
+    done = true;
+    updated.notify_all();
+  }
+
+  // Waits until the directory says the file was written, created or moved in, or for a while when there's
+  // no watch to go by. The timeout is only there to notice stop
+  bool wait_for_write(io::Watcher& watcher, int& wd, const std::string& name) {
+    while(!stop) {
+      if(wd < 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        return !stop;
+      }
+
+      bool touched = false;
+      watcher.wait(250, [&](const io::WatchEvent& event) {
+        if(event.mask & (IN_IGNORED | IN_DELETE_SELF)) wd = -1; // The directory is gone, back to stat
+        if(event.mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF) || event.name == name) touched = true;
+      });
+      if(touched) return true;
+    }
+    return false;
+  }
+
+  void read_file(std::string path) {
+    uint64_t scanned = 0;
+    std::vector<uint64_t> found;
+    std::optional<io::Watcher> watcher; // Only made once the file is followed
+    int wd = -1;
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    while(!stop) {
+      // Only this thread replaces file, so it can look at it without the lock
+      std::string_view text = file.view();
+      while(scanned < text.size() && !stop) {
+        size_t chunk = std::min<uint64_t>(text.size() - scanned, 1 << 20);
+        found.clear();
+        find_starts(text.substr(scanned, chunk), scanned, found);
+        scanned += chunk;
+
+        std::lock_guard lock(mutex);
+        starts.insert(starts.end(), found.begin(), found.end());
+        length = scanned;
+        updated.notify_all();
+      }
+      {
+        std::unique_lock lock(mutex);
+        if(!done) updated.notify_all();
+        done = true;
+
+        // Nothing else to do until the file is followed
+        updated.wait(lock, [&] { return stop || following; });
+      }
+      if(stop) break;
+
+      if(!watcher) {
+        watcher.emplace();
+        // The directory rather than the file, which may get replaced by a rename
+        if(watcher->ok()) wd = watcher->add(dir, IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE_SELF);
+      }
+      if(!wait_for_write(*watcher, wd, name)) continue;
+
+      struct stat st{};
+      if(stat(path.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) == text.size()) continue;
+
+      io::FileView changed(path);
+      if(!changed.ok()) continue;
+      std::lock_guard lock(mutex);
+      if(changed.size() < text.size()) { // Truncated or replaced, start over
+        starts = {0};
+        scanned = 0;
+        length = 0;
+      }
+      file = std::move(changed);
+      done = false;
+      updated.notify_all();
+    }
+  }
+
+  void read_stream(int fd) {
+    char chunk[64 * 1024];
+    std::vector<uint64_t> found;
+    uint64_t offset = 0;
+
+    while(!stop) {
+      ssize_t n = ::read(fd, chunk, sizeof(chunk));
+      if(n < 0 && errno == EINTR) continue;
+      if(n <= 0) {
+        if(n < 0) fail(errno);
+        break;
+      }
+
+      found.clear();
+      find_starts(std::string_view(chunk, n), offset, found);
+      offset += n;
+
+      std::lock_guard lock(mutex);
+      spool.append(chunk, n);
+      starts.insert(starts.end(), found.begin(), found.end());
+      length = offset;
+      updated.notify_all();
+    }
+
+    std::lock_guard lock(mutex);
+    done = true;
+    updated.notify_all();
+  }
+
+  public:
+  struct State {
+    size_t lines;
+    uint64_t bytes;   // Read so far
+    uint64_t total;   // Size of the file when known, otherwise bytes
+    bool complete;
+  };
+
+  LineSource() = default;
+  LineSource(const LineSource&) = delete;
+  LineSource& operator=(const LineSource&) = delete;
+
+  ~LineSource() {
+    stop = true;
+    wake();
+    if(!reader.joinable()) return;
+    if(from_file) reader.join();
+    else reader.detach(); // Might be stuck in read() on a pipe that never closes
+  }
+
+  bool open_file(const std::string& path) {
+    struct stat st{};
+    if(stat(path.c_str(), &st) != 0) {
+      err = errno;
+      return false;
+    }
+
+    if(!S_ISREG(st.st_mode)) {
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if(fd == -1) {
+        err = errno;
+        return false;
+      }
+      return open_stream(fd);
+    }
+
+    file = io::FileView(path);
+    if(!file.ok()) {
+      err = file.error();
+      return false;
+    }
+    from_file = true;
+    reader = std::thread(&LineSource::read_file, this, path);
+    return true;
+  }
+
+  bool open_stream(int fd) {
+    reader = std::thread(&LineSource::read_stream, this, fd);
+    return true;
+  }
+
+  void open_text(std::string text) {
+    spool = std::move(text);
+    find_starts(spool, 0, starts);
+    length = spool.size();
+    done = true;
+  }
+
+  int error() const {
+    std::lock_guard lock(mutex);
+    return err;
+  }
+
+  // Keeps reading a file as it grows from now on
+  void follow() {
+    std::lock_guard lock(mutex);
+    following = true;
+    updated.notify_all();
+  }
+
+  State state() const {
+    std::lock_guard lock(mutex);
+    uint64_t total = from_file ? std::max<uint64_t>(file.size(), length) : length;
+    return {starts.size(), length, total, done};
+  }
+
+  // Copies of lines [first, first + count), as many of them as there are so far
+  std::vector<std::string> lines(size_t first, size_t count) const {
+    std::lock_guard lock(mutex);
+    std::vector<std::string> out;
+    std::string_view text = data();
+    for(size_t i = first; i < starts.size() && i < first + count; i++) {
+      uint64_t end = i + 1 < starts.size() ? starts[i + 1] - 1 : length;
+      out.emplace_back(text.substr(starts[i], end - starts[i]));
+    }
+    return out;
+  }
+
+  // Line the byte at offset is on, as far as lines are known
+  size_t line_at(uint64_t offset) const {
+    std::lock_guard lock(mutex);
+    return std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+  }
+
+  uint64_t offset_of(size_t line) const {
+    std::lock_guard lock(mutex);
+    return line < starts.size() ? starts[line] : length;
+  }
+
+  // Blocks until more has been read than seen says, the source is done or stops being done, or cancel
+  // is set and wake() called
+  void wait_for_more(const State& seen, const std::atomic<bool>& cancel) const {
+    std::unique_lock lock(mutex);
+    updated.wait(lock, [&] { return cancel || length != seen.bytes || done != seen.complete; });
+  }
+
+  void wake() const {
+    { std::lock_guard lock(mutex); }
+    updated.notify_all();
+  }
+
+  // Hands bytes [from, to) of what's been read so far to f. The source is locked meanwhile, keep it short
+  void read(uint64_t from, uint64_t to, const std::function<void(std::string_view)>& f) const {
+    std::lock_guard lock(mutex);
+    to = std::min(to, length);
+    f(from < to ? data().substr(from, to - from) : std::string_view());
+  }
+};
+
+// A search through the whole source on a thread of its own, done a chunk at a time so the first matches
+// are there to jump to long before a big file has been gone through. Only the first match on each line is
+// kept, in order, so finding the next or previous one from anywhere is a binary search
+class Search {
+  private:
+  const LineSource& source;
+  std::string needle;
+  bool ignore_case;
+
+  mutable std::mutex mutex;
+  std::vector<uint64_t> offsets;
+  uint64_t scanned = 0; // Everything before this has been searched
+  bool done = false;
+
+  std::atomic<bool> stop{false};
+  std::thread worker;
+
+  void run() {
+    const uint64_t CHUNK = 1 << 20;
+    std::vector<uint64_t> found;
+
+    while(!stop) {
+      LineSource::State state = source.state();
+      uint64_t from;
+      {
+        std::lock_guard lock(mutex);
+        if(state.bytes < scanned) { // The file got truncated, start over
+          offsets.clear();
+          scanned = 0;
+        }
+        from = scanned;
+        done = state.complete && scanned >= state.bytes;
+      }
+
+      // Sleeps through a finished search until the source has more or stop is set
+      if(from >= state.bytes) {
+        source.wait_for_more(state, stop);
+        continue;
+      }
+
+      // Whole lines only, the last one could still be getting longer. One without an end in
+      // a whole chunk is searched as it is
+      uint64_t used = 0;
+      found.clear();
+      source.read(from, from + CHUNK, [&](std::string_view text) {
+        size_t end = text.size();
+        bool at_end = from + text.size() >= state.bytes;
+        if(!(at_end && state.complete)) {
+          size_t nl = text.rfind('\n');
+          if(nl != std::string_view::npos) end = nl + 1;
+          else if(text.size() < CHUNK) end = 0;
+        }
+        text = text.substr(0, end);
+
+        for(size_t i = 0; (i = find(text, i)) != std::string_view::npos;) {
+          found.push_back(from + i);
+          i = text.find('\n', i);
+          if(i == std::string_view::npos) break;
+          i++;
+        }
+        used = end;
+      });
+
+      {
+        std::lock_guard lock(mutex);
+        offsets.insert(offsets.end(), found.begin(), found.end());
+        scanned += used;
+      }
+      if(used == 0) source.wait_for_more(state, stop);
+    }
+  }
+
+  public:
+  Search(const LineSource& source, std::string pattern) : source(source), needle(std::move(pattern)) {
+    // Smart case, like the fuzzy finders: only a pattern with uppercase in it has to match case
+    ignore_case = std::none_of(needle.begin(), needle.end(), [](unsigned char c) { return isupper(c); });
+    worker = std::thread(&Search::run, this);
+  }
+
+  Search(const Search&) = delete;
+  Search& operator=(const Search&) = delete;
+
+  ~Search() {
+    stop = true;
+    source.wake();
+    worker.join();
+  }
+
+  const std::string& pattern() const { return needle; }
+
+  // Where the pattern next shows up in text at or after pos
+  size_t find(std::string_view text, size_t pos) const {
+    if(!ignore_case) return text.find(needle, pos);
+    if(needle.empty() || text.size() < needle.size()) return std::string_view::npos;
+
+    char first_lower = tolower(needle[0]);
+    char first_upper = toupper(needle[0]);
+    for(size_t i = pos; i + needle.size() <= text.size(); i++) {
+      if(text[i] != first_lower && text[i] != first_upper) continue;
+      size_t j = 1;
+      while(j < needle.size() && tolower((unsigned char)text[i + j]) == needle[j]) j++;
+      if(j == needle.size()) return i;
+    }
+    return std::string_view::npos;
+  }
+
+  size_t count() const {
+    std::lock_guard lock(mutex);
+    return offsets.size();
+  }
+
+  bool complete() const {
+    std::lock_guard lock(mutex);
+    return done;
+  }
+
+  // First match at or after offset. Not finding one only means there isn't one once complete()
+  std::optional<uint64_t> next(uint64_t offset) const {
+    std::lock_guard lock(mutex);
+    auto it = std::lower_bound(offsets.begin(), offsets.end(), offset);
+    if(it == offsets.end()) return std::nullopt;
+    return *it;
+  }
+
+  // Last match before offset, and whether the search has got that far yet
+  std::optional<uint64_t> previous(uint64_t offset, bool& certain) const {
+    std::lock_guard lock(mutex);
+    certain = scanned >= offset || done;
+    auto it = std::lower_bound(offsets.begin(), offsets.end(), offset);
+    if(it == offsets.begin()) return std::nullopt;
+    return *std::prev(it);
+  }
+};
+
+#pragma endregion
 
 class Pager {
   private:
@@ -24,44 +436,24 @@ class Pager {
     }
   */
 
-    std::string strip_ansi(const std::string& input) {
-      static const std::regex ansi_regex("\x1b\\[[0-9;]*[mGKHF]");
-      return std::regex_replace(input, ansi_regex, "");
-    }
-
-    void print_footer(std::string filepath, int percentage) {
-      int width = Tui::get_terminal_width();
+    Tui::Screen screen;
+    Tui::EventLoop loop; // Made along with the pager, before the LineSource starts its thread
 
+    std::string footer(std::string filepath, int percentage, std::string status) {
       std::stringstream footer;
       footer << bg_blue << black << " pager " << reset << bg_gray;
       footer << " " << filepath;
 
       std::string left = footer.str();
-      std::string right = "(↑/↓ to scroll) " + std::to_string(percentage) + "% ";
+      std::string right = (status.empty() ? "" : status + " ") + "(↑/↓ to scroll) " + std::to_string(percentage) + "% ";
 
-      int space_len = (width - strip_ansi(left).length() - strip_ansi(right).length()) + 4; // 4 because of the extra size they take coz theyre not ascii
+      int space_len = screen.cols() - Tui::Screen::text_width(left) - Tui::Screen::text_width(right);
       if(space_len < 0) space_len = 0;
 
-      std::string line = left + std::string(space_len, ' ') + right + reset;
-  
-      Tui::move_cursor_to_last();
-
-      io::print(line);
+      return left + std::string(space_len, ' ') + right + reset;
     }
 
-    int page(std::string text, bool text_isfilepath) {
-      std::string ttu; // text to use
-      int height = Tui::get_terminal_height() - 1;
-
-      if(text_isfilepath) {
-        auto content = io::read_file(text);
-        if(!std::holds_alternative<std::string>(content)) {
-          info::error(std::string("Failed to read file: ") + strerror(errno));
-          return errno;
-        }
-        ttu = std::get<std::string>(content);
-      } else ttu = text;
-
+    int page(LineSource& source, std::string filepath, bool follow) {
       Tui::switch_to_alternate();
       enable_raw_mode();
       Tui::clear();
@@ -70,44 +462,217 @@ class Pager {
       signal(SIGINT, Tui::cleanup_and_exit);
       signal(SIGTERM, Tui::cleanup_and_exit);
 
-      std::vector<std::string> lines = io::split(ttu, "\n");
-      int scroll_offset = 0;
+      size_t scroll_offset = 0;
+      std::string count; // Digits typed before g, G or %
+      LineSource::State shown{};
+
+      std::unique_ptr<Search> search;
+      bool backward = false;   // Whether the search was started with ? instead of /
+      bool prompting = false;
+      std::string prompt;      // The pattern being typed after / or ?
+      std::string message;     // Shown in the footer until the next key
+      size_t shown_matches = 0;
+      bool shown_search_done = false;
+      int tick = -1; // Timer that looks for new input, only running while there's something to wait for
+
+      // A jump to a match that hasn't been found yet, done as soon as the search gets to it
+      enum { NONE, FORWARD, BACKWARD } pending = NONE;
+      uint64_t pending_from = 0;
+
+      auto highlight = [&](const std::string& line) {
+        if(!search) return line;
+        std::string out;
+        size_t pos = 0, len = search->pattern().size();
+        for(size_t i; (i = search->find(line, pos)) != std::string::npos; pos = i + len) {
+          out += line.substr(pos, i - pos) + "\x1b[7m" + line.substr(i, len) + "\x1b[27m";
+        }
+        return out + line.substr(pos);
+      };
 
-      auto redraw = [&](int sig = 0) {
-        Tui::clear();
-        for (int i = scroll_offset; i < std::min(scroll_offset + height, (int)lines.size()); i++) {
-          io::print(lines[i] + "\n");
+      // Only the lines on screen are copied out of the source, and only what changed gets written
+      auto redraw = [&]() {
+        screen.clear();
+        size_t height = std::max(screen.rows() - 1, 1);
+        shown = source.state();
+        size_t last_top = shown.lines > height ? shown.lines - height : 0;
+        if(follow || scroll_offset > last_top) scroll_offset = last_top;
+
+        std::vector<std::string> lines = source.lines(scroll_offset, height);
+        for(size_t i = 0; i < lines.size(); i++) screen.line(i, highlight(lines[i]));
+
+        // Until a file is fully indexed the lines below aren't known yet, bytes say how far in this is
+        int percent;
+        if(shown.complete) percent = (int)(((scroll_offset + height) * 100.0) / shown.lines);
+        else percent = (int)(source.offset_of(std::min(scroll_offset + height, shown.lines)) * 100.0 / std::max<uint64_t>(shown.total, 1));
+        if(percent > 100) percent = 100;
+
+        bool busy = !shown.complete || follow || pending != NONE || (search && !search->complete());
+        if(busy && tick < 0) tick = loop.add_timer(100);
+        else if(!busy && tick >= 0) {
+          loop.remove_timer(tick);
+          tick = -1;
         }
 
-        std::string first_arg = text_isfilepath ? text : "";
+        if(prompting) {
+          screen.line(height, (backward ? "?" : "/") + prompt);
+          screen.present();
+          return;
+        }
 
-        int percent = (int)(((scroll_offset + height) * 100.0) / lines.size());
-        if (percent > 100) percent = 100;
-        print_footer(first_arg, percent);
+        std::string status = follow ? "following" : shown.complete ? "" : "loading...";
+        if(search) {
+          shown_matches = search->count();
+          shown_search_done = search->complete();
+          std::string found = std::to_string(shown_matches) + (search->complete() ? "" : "+") + (shown_matches == 1 ? " line" : " lines");
+          status = (backward ? "?" : "/") + search->pattern() + ": " + found + (status.empty() ? "" : ", " + status);
+          if(pending != NONE) status += ", searching...";
+        }
+        if(!message.empty()) status = message;
+        if(!count.empty()) status = ":" + count;
+        screen.line(height, footer(filepath, percent, status));
+        screen.present();
       };
 
-      redraw();
+      auto jump = [&](size_t line) {
+        follow = false;
+        scroll_offset = line;
+        redraw();
+      };
 
-      while(true) {
-        std::string key = Tui::get_keypress();
+      auto resolve_pending = [&]() {
+        if(pending == FORWARD) {
+          std::optional<uint64_t> at = search->next(pending_from);
+          if(!at && !search->complete()) return;
+          pending = NONE;
+          if(at) return jump(source.line_at(*at));
+          message = "Pattern not found";
+        } else if(pending == BACKWARD) {
+          bool certain;
+          std::optional<uint64_t> at = search->previous(pending_from, certain);
+          if(!certain) return;
+          pending = NONE;
+          if(at) return jump(source.line_at(*at));
+          message = "Pattern not found";
+        }
+        redraw();
+      };
 
-        if(key == "ArrowUp") {
-          if(scroll_offset > 0) {
-            scroll_offset--;
+      // A new search starts from the top line, n and N from the line after or before it
+      auto find_match = [&](bool forward, bool from_top) {
+        pending = forward ? FORWARD : BACKWARD;
+        pending_from = source.offset_of(forward && !from_top ? scroll_offset + 1 : scroll_offset);
+        redraw();
+        resolve_pending();
+      };
+
+      if(follow) source.follow();
+      redraw();
+
+      loop.run([&](const Tui::Event& event) {
+        if(event.type == Tui::Event::RESIZE) return redraw();
+
+        // Redraw for new input only when it changes what's on screen
+        if(event.type == Tui::Event::TIMER) {
+          LineSource::State now_state = source.state();
+          size_t height = std::max(screen.rows() - 1, 1);
+          bool changed = now_state.lines != shown.lines || now_state.complete != shown.complete || now_state.total != shown.total;
+          bool more_matches = search && !prompting && (search->count() != shown_matches || search->complete() != shown_search_done);
+          if(pending != NONE) resolve_pending();
+          if(more_matches || (changed && (follow || scroll_offset + height > shown.lines || now_state.complete != shown.complete || !shown.complete))) {
             redraw();
           }
+          return;
         }
 
-        if(key == "ArrowDown") {
-          if(scroll_offset + height < (int)lines.size()) {
-            scroll_offset++;
+        const std::string& key = event.key;
+        message.clear();
+
+        if(prompting) {
+          if(key == "Enter") {
+            prompting = false;
+            if(!prompt.empty()) search = std::make_unique<Search>(source, prompt);
+            if(search) find_match(!backward, !prompt.empty());
+            else {
+              message = "No previous search";
+              redraw();
+            }
+          }
+          else if(key == "Backspace") {
+            if(prompt.empty()) prompting = false; // Backspace on nothing backs out of the prompt
+            else prompt.pop_back();
             redraw();
           }
+          else if(key.size() == 1 && (unsigned char)key[0] >= 32) {
+            prompt += key;
+            redraw();
+          }
+          return;
         }
 
+        size_t height = std::max(Tui::get_terminal_height() - 1, 1);
+        size_t lines = source.state().lines;
+        size_t n = count.empty() ? 0 : std::stoull(count.substr(0, 18));
 
-        if(key == "q" || key == "Q") Tui::cleanup_and_exit(0);
-      }
+        if(key.size() == 1 && isdigit(key[0])) {
+          count += key;
+          redraw();
+          return;
+        }
+        count.clear();
+
+        if(key == "ArrowUp" || key == "k") {
+          follow = false;
+          if(scroll_offset > 0) scroll_offset--;
+          redraw();
+        }
+
+        else if(key == "ArrowDown" || key == "j" || key == "Enter") {
+          if(scroll_offset + height < lines) scroll_offset++;
+          redraw();
+        }
+
+        else if(key == " " || key == "f" || key == "PageDown") {
+          scroll_offset += height;
+          redraw();
+        }
+
+        else if(key == "b" || key == "PageUp") {
+          follow = false;
+          scroll_offset = scroll_offset > height ? scroll_offset - height : 0;
+          redraw();
+        }
+
+        else if(key == "g" || key == "Home") jump(n > 0 ? n - 1 : 0);
+        else if(key == "G" || key == "End") jump(n > 0 ? n - 1 : SIZE_MAX);
+
+        // N% goes by bytes, so it works before the whole file has been split into lines
+        else if(key == "%" || key == "p") {
+          LineSource::State st = source.state();
+          jump(source.line_at(std::min<uint64_t>(n, 100) * st.total / 100));
+        }
+
+        else if(key == "/" || key == "?") {
+          prompting = true;
+          backward = key == "?";
+          prompt.clear();
+          pending = NONE;
+          redraw();
+        }
+
+        // n keeps going the way the search went, N goes the other way
+        else if((key == "n" || key == "N") && search) find_match((key == "n") != backward, false);
+
+        else if(key == "F") {
+          follow = true;
+          source.follow();
+          redraw();
+        }
+
+        else if(key == "q" || key == "Q") Tui::cleanup_and_exit(0);
+
+        else redraw();
+      });
+      return 0;
     }
 
     public:
@@ -119,39 +684,54 @@ class Pager {
           "Paginate long files or text",
           {
             "pager <file>",
-            "pager -t <text>"
+            "pager -t <text>",
+            "command | pager -t"
           },
           {
-            {"-t", "--text", "The incoming input is text"}
+            {"-t", "--text", "The incoming input is text, read from stdin if none is given"},
+            {"+F", "", "Keep showing the end of the input as it grows, like tail -f"}
           },
           {
             {"pager super_long.txt", "Paginates super_long.txt"},
+            {"pager +F server.log", "Follows server.log as lines get added (F to follow again after scrolling)"},
           },
-          "",
+          green + "Keys\n" + reset +
+          "  space/b for the next/previous page, g/G for the start/end, 50g for line 50, 30% to go 30% of the way in,\n"
+          "  /pattern and ?pattern to search forward and backward, n/N for the next/previous match,\n"
+          "  F to follow the end again and q to quit\n",
           ""
         }));
           return 0;
       }
 
+      std::vector<std::string> validArgs = {"-t", "--text", "+F"};
+
       std::string a;
       bool is_filepath = true;
+      bool follow = false;
 
       for(auto& arg : args) {
-        if(!io::vecContains(args, arg) && arg.starts_with("-")) {
+        if(!io::vecContains(validArgs, arg) && arg.starts_with("-")) {
           info::error("Invalid argument \"" + arg + "\"");
           return -1;
         }
 
         if(arg == "-t" || arg == "--text") is_filepath = false;
-        if(!arg.starts_with("-")) a = arg;
+        else if(arg == "+F") follow = true;
+        else a = arg;
       }
 
-      if(!is_filepath && a.empty()) {
-        std::stringstream ss; ss << std::cin.rdbuf();
-        a = ss.str();
-      }
+      LineSource source;
+      if(is_filepath) {
+        if(!source.open_file(a)) {
+          info::error(std::string("Failed to read file: ") + strerror(source.error()), source.error(), a);
+          return source.error();
+        }
+      } else if(a.empty()) {
+        source.open_stream(STDIN_FILENO);
+      } else source.open_text(a);
 
-      return page(a, is_filepath);
+      return page(source, is_filepath ? a : "", follow);
     }
 };
 
@@ -162,4 +742,4 @@ int main(int argc, char* argv[]) {
     args.emplace_back(argv[i]);
   }
   return pager.exec(args);
-}
\ No newline at end of file
+}
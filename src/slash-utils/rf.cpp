@@ -1,6 +1,7 @@
 
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
+#include "../abstractions/filestream.h"
 #include "../git/git.h"
 #include "syntax_highlighting/cpp.h"
 #include "syntax_highlighting/python.h"
@@ -41,7 +42,139 @@ class Rf {
       return result;
     }
 
+    // Hidden characters made visible, highlighting and tabs, for one line about to be printed
+    std::string format_line(std::string content, const std::string& fullpath, int tab_indent, bool hidden, bool reverse_text, bool no_highlight) {
+      if (hidden) {
+        std::string space = cyan + "·" + reset;
+        std::string enter = gray + "↲" + reset;
+
+        std::string tab_dashes = [tab_indent](){
+          std::string res;
+          for(int i = 0; i < tab_indent - 2; i++) res += "─";
+          return res;
+        }();
+        std::string tab = gray + "├" + tab_dashes + "┤" + reset;
+        static const std::vector<std::string> control_pics = {
+          "␀", "␁", "␂", "␃", "␄", "␅", "␆", "␇",
+          "␈", "␉", "␊", "␋", "␌", "␍", "␎", "␏",
+          "␐", "␑", "␒", "␓", "␔", "␕", "␖", "␗",
+          "␘", "␙", "␚", "␛", "␜", "␝", "␞", "␟"
+        };
+
+        std::string line;
+        for (auto &c: content) {
+          int code = static_cast<int>(c);
+          if (c == '\n') {
+            line += control_pics[code] + enter;
+            continue;
+          }
+          if (c == '\t') {
+            line += tab;
+            continue;
+          }
+          if (c == ' ') {
+            line += space;
+            continue;
+          }
+          if (code >= 0 && code < 32) {
+            line += control_pics[code];
+            continue;
+          }
+          line += c;
+        }
+        return line; // No tabs left to expand
+      }
+
+      // Highlighting isn't implemented yet when there are hidden characters, otherwise you'll see terminal gore
+      if(!reverse_text && !no_highlight) {
+        if(fullpath.ends_with(".cpp") || fullpath.ends_with(".h")) content = cpp_sh(content);
+        if(fullpath.ends_with(".py")) content = python_sh(content);
+        if(fullpath.ends_with(".java")) content = java_sh(content);
+        if(fullpath.ends_with(".rs")) content = rust_sh(content);
+        if(fullpath.ends_with(".lua")) content = lua_sh(content);
+        if(fullpath.ends_with(".js") || fullpath.ends_with(".ts")) content = js_sh(content);
+        if(fullpath.ends_with(".go")) content = go_sh(content);
+      }
+
+      return tab_to_spaces(content, tab_indent);
+    }
+
+    // Line number and separator in front of line i, padded for a file with total lines
+    std::string gutter(size_t i, size_t total, const std::string& gc) {
+      int longest_num_length = std::to_string(total - 1).length(); // Line no of the last element
+
+      int line_width = std::to_string(total).length();
+      if(line_width % 2 == 0) line_width += 3;
+      else line_width += 2;
+
+      std::string line_no = std::to_string(i + 1);
+      // Pad with spaces to align right, based on longest_num_length
+      if(static_cast<int>(line_no.length()) < longest_num_length) line_no.insert(0, std::string(longest_num_length - line_no.length(), ' '));
+
+      return std::string((line_width - 1) / 2, ' ') + " " + gray + line_no + reset + gc
+        + std::string((line_width - 1) / 2, ' ') + gray + "│ " + reset;
+    }
+
+    // Everything that doesn't need all of the lines at once. The file is mapped, the start of the range
+    // is found by counting newlines instead of splitting the file, and only the printed lines are formatted
+    int stream_content(std::string fullpath, int tab_indent, bool hidden, bool reverse_text, bool no_highlight, bool raw, bool specified_fromto, int from, int to) {
+      io::FileView file(fullpath);
+      if(!file.ok()) {
+        errno = file.error();
+        std::string error = std::string("Failed to read file: ") + strerror(errno);
+        info::error(error, errno);
+        return errno;
+      }
+      std::string_view text = file.view();
+
+      std::string out;
+      auto flush = [&](bool force) {
+        if(force || out.size() >= 64 * 1024) {
+          io::print(out);
+          out.clear();
+        }
+      };
+
+      if(raw) {
+        for(std::string_view line : io::Lines(text)) {
+          std::string l(line);
+          if(reverse_text) std::reverse(l.begin(), l.end());
+          out += tab_to_spaces(l + "\n", tab_indent);
+          flush(false);
+        }
+        if(text.empty() || text.ends_with('\n')) out += "\n"; // The empty last line after the final newline
+        flush(true);
+        return 0;
+      }
+
+      size_t total = io::count_newlines(text) + 1; // The same number of lines splitting on '\n' gives
+      size_t first = 0, last = total;
+      if(specified_fromto) {
+        if(from != -1) first = std::max(from, 0);
+        if(to != -1) last = std::min(static_cast<size_t>(std::max(to, 0)), total);
+      }
+
+      size_t offset = first < last ? io::line_start(text, first) : std::string_view::npos;
+      for(size_t i = first; i < last && offset != std::string_view::npos; i++) {
+        size_t nl = text.find('\n', offset);
+        std::string line(text.substr(offset, nl == std::string_view::npos ? std::string_view::npos : nl - offset));
+        offset = nl == std::string_view::npos ? std::string_view::npos : nl + 1;
+
+        if(reverse_text) std::reverse(line.begin(), line.end());
+        out += gutter(i, total, "") + format_line(std::move(line), fullpath, tab_indent, hidden, reverse_text, no_highlight) + "\n";
+        flush(false);
+      }
+
+      out += "\n";
+      flush(true);
+      return 0;
+    }
+
     int print_content(std::string fullpath, int tab_indent, bool hidden, bool git, bool reverse_lines, bool reverse_text, bool no_highlight, bool raw, bool filter_dups, bool sort,  bool specified_fromto, int from, int to) {
+      if(!git && !reverse_lines && !sort && !filter_dups) {
+        return stream_content(fullpath, tab_indent, hidden, reverse_text, no_highlight, raw, specified_fromto, from, to);
+      }
+
       std::vector<std::pair<std::string, std::string>> content_to_use;
       
       if(git) {
@@ -64,19 +197,18 @@ class Rf {
         }
       }
       else {
-        auto rf = io::read_file(fullpath);
-        if(!std::holds_alternative<std::string>(rf)) {
+        io::FileView file(fullpath);
+        if(!file.ok()) {
+          errno = file.error();
           std::string error = std::string("Failed to read file: ") + strerror(errno);
           info::error(error, errno);
           return errno;
         }
 
-        std::string content = std::get<std::string>(rf);
-        std::vector<std::pair<std::string, std::string>> raw_lines;
-
-        std::vector<std::string> cnt = io::split(content, "\n");
-        for(auto& line : cnt) raw_lines.push_back({"", line});
-        content_to_use = raw_lines;
+        std::string_view text = file.view();
+        content_to_use.reserve(io::count_newlines(text) + 1);
+        for(std::string_view line : io::Lines(text)) content_to_use.push_back({"", std::string(line)});
+        if(text.empty() || text.ends_with('\n')) content_to_use.push_back({"", ""}); // Same lines as splitting on '\n'
       }
       
       if(reverse_text) for(auto& [gc, line] : content_to_use) { std::reverse(line.begin(), line.end()); }
@@ -87,100 +219,34 @@ class Rf {
       if(filter_dups) content_to_use = filter_duplicates(content_to_use);
 
       if(raw) {
-        for(auto [gc, line] : content_to_use) {
-          io::print(tab_to_spaces(line + "\n", tab_indent));
-        }
+        std::string out;
+        for(auto& [gc, line] : content_to_use) out += tab_to_spaces(line + "\n", tab_indent);
+        io::print(out);
         return 0;
       }
 
-      // From here, all formatting begins
-      for(auto& [gc, content] : content_to_use) {
-        if (hidden) {
-          std::string space = cyan + "·" + reset;
-          std::string enter = gray + "↲" + reset;
-
-          std::string tab_dashes = [tab_indent](){
-            std::string res;
-            for(int i = 0; i < tab_indent - 2; i++) res += "─";
-            return res;
-          }();
-          std::string tab = gray + "├" + tab_dashes + "┤" + reset;
-          std::vector<std::string> control_pics = {
-            "␀", "␁", "␂", "␃", "␄", "␅", "␆", "␇",
-            "␈", "␉", "␊", "␋", "␌", "␍", "␎", "␏",
-            "␐", "␑", "␒", "␓", "␔", "␕", "␖", "␗",
-            "␘", "␙", "␚", "␛", "␜", "␝", "␞", "␟"
-          };
-
-          std::string line;
-          for (auto &c: content) {
-            int code = static_cast<int>(c);
-            if (c == '\n') {
-              line += control_pics[code] + enter;
-              continue;
-            }
-            if (c == '\t') {
-              line += tab;
-              continue;
-            }
-            if (c == ' ') {
-              line += space;
-              continue;
-            }
-            if (code >= 0 && code < 32) {
-              line += control_pics[code];
-              continue;
-            }
-            line += c;
-          }
-          content = line;
-        }
-      }
-
-      for(auto& [gc, l] : content_to_use) {
-        // Highlighting isn't implemented yet when there are hidden characters, otherwise you'll see terminal gore
-        if(!hidden && !reverse_text && !no_highlight) {
-          if(fullpath.ends_with(".cpp") || fullpath.ends_with(".h")) l = cpp_sh(l);
-          if(fullpath.ends_with(".py")) l = python_sh(l);
-          if(fullpath.ends_with(".java")) l = java_sh(l);
-          if(fullpath.ends_with(".rs")) l = rust_sh(l);
-          if(fullpath.ends_with(".lua")) l = lua_sh(l);
-          if(fullpath.ends_with(".js") || fullpath.ends_with(".ts")) l = js_sh(l);
-          if(fullpath.ends_with(".go")) l = go_sh(l);
-        } else break;
-      }
-      
-      int line_width = 0;
-      int longest_num_length = std::to_string(content_to_use.size() - 1).length(); // Line no of the last element
-
-      line_width = std::to_string(content_to_use.size()).length();
-      if(line_width % 2 == 0) line_width += 3;
-      else line_width += 2;
-
-      int i = 0;
-      int idk = content_to_use.size();
+      size_t first = 0, last = content_to_use.size();
       if(specified_fromto) {
-        if(from != -1) i = from;
-        if(to != -1) idk = to;
+        if(from != -1) first = std::max(from, 0);
+        if(to != -1) last = std::min(static_cast<size_t>(std::max(to, 0)), content_to_use.size());
       }
 
-      for (i; i < idk; i++) {
-        if(!hidden) content_to_use[i].second = tab_to_spaces(content_to_use[i].second, tab_indent); // No need if hidden
-        std::string line_no = std::to_string(i + 1);
-        // Pad with spaces to align right, based on longest_num_length
-        line_no.insert(0, std::string(longest_num_length - line_no.length(), ' '));
-
-        // Print the line, with equal padding for line numbers
-        io::print(std::string((line_width - 1) / 2, ' ') + " ");
-        io::print(gray + line_no + reset + content_to_use[i].first);
-        io::print(std::string((line_width - 1) / 2, ' ') + gray + "│ " + reset);
+      // Only the lines that get printed are formatted
+      std::string out;
+      for (size_t i = first; i < last; i++) {
+        auto& [gc, line] = content_to_use[i];
+        out += gutter(i, content_to_use.size(), gc) + format_line(line, fullpath, tab_indent, hidden, reverse_text, no_highlight);
 
         // libgit2 adds a newline automatically for lines
-        if(git) io::print(content_to_use[i].second);
-        else io::print(content_to_use[i].second + "\n");
+        if(!git) out += "\n";
+        if(out.size() >= 64 * 1024) {
+          io::print(out);
+          out.clear();
+        }
       }
 
-      io::print("\n");
+      out += "\n";
+      io::print(out);
       return 0;
     }
 
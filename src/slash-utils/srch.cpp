@@ -1,203 +1,402 @@
 #include "../abstractions/info.h"
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/fuzzy.h"
+#include "../abstractions/walker.h"
+#include "../git/git.h"
 
 #include "../tui/tui.h"
 #include <csignal>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <algorithm>
-#include <boost/regex.hpp>
 #include <filesystem>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 int height = Tui::get_terminal_height() - 2;
 int files_height = Tui::get_terminal_height() - 4;
 
-std::function<void()> renderer = nullptr;
-
-void winch_handler(int sig) { 
+void update_heights() {
   height = Tui::get_terminal_height() - 2;
-  int files_height = Tui::get_terminal_height() - 4;
-
-  if(renderer != nullptr) renderer();
+  files_height = Tui::get_terminal_height() - 4;
 }
  
-class Srch {
+struct FileEntry {
+  std::string name;
+  unsigned char type; // DT_*
+};
+
+// A directory's entries, read on a background thread and handed over in batches, so a huge directory
+// shows up bit by bit instead of all at once. Listings are kept for as long as srch runs and only read again
+// when the directory changed
+class DirListing {
   private:
-    int files_srch(bool no_icons, std::string dirpath) {
-      Tui::clear();
+  std::mutex mutex;
+  std::vector<FileEntry> pending; // Read but not taken by poll yet
+  bool finished = false;          // Guarded by mutex
+  std::atomic<bool> stop{false};
+  std::thread reader;
+  struct stat st{};
+
+  void read_dir(std::string path) {
+    DIR* d = opendir(path.c_str());
+    if(!d) {
+      std::lock_guard lock(mutex);
+      error = errno;
+      finished = true;
+      return;
+    }
+    int dir_fd = dirfd(d);
+
+    std::vector<FileEntry> batch;
+    struct dirent* entry;
+    while((entry = readdir(d)) != nullptr && !stop) {
+      std::string name = entry->d_name;
+      if(name == ".") continue;
+
+      unsigned char type = entry->d_type;
+      if(type == DT_UNKNOWN) {
+        struct stat st;
+        type = fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 ? IFTODT(st.st_mode) : DT_REG;
+      }
 
-      std::string buffer;
-      std::vector<std::pair<std::string, std::string>> files;
+      batch.push_back({std::move(name), type});
 
-      auto redraw = [&](std::string regex, int selected_index, int starting_index){
-        std::vector<std::pair<std::string, std::string>> filtered;
-        Tui::clear();
+      if(batch.size() >= 512) {
+        std::lock_guard lock(mutex);
+        pending.insert(pending.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        batch.clear();
+      }
+    }
+    closedir(d);
 
-        io::print(yellow + "Current directory: " + reset + dirpath + "\n");
-        Tui::print_separator();
+    std::lock_guard lock(mutex);
+    pending.insert(pending.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    finished = true;
+  }
 
-        DIR* d = opendir(dirpath.c_str());
-        if(!d) return; // TODO: Next version, make a popup component in the tui library
+  public:
+  std::vector<FileEntry> entries; // Everything taken so far, only touched by the thread calling poll
+  fuzzy::Candidates names;        // The same, for matching
+  bool done = false;              // All of the directory is in entries
+  int error = 0;                  // Set once done if it couldn't be read
+
+  ~DirListing() {
+    stop = true;
+    if(reader.joinable()) reader.join();
+  }
 
-        struct dirent* entry;
-        while((entry = readdir(d)) != nullptr) {
-          std::string name = entry->d_name;
-          if(name == ".") continue;
+  static std::shared_ptr<DirListing> open(const std::string& path) {
+    static std::unordered_map<std::string, std::shared_ptr<DirListing>> cache;
 
-          boost::regex reg;
-          try {
-            if(!buffer.empty()) reg = boost::regex(regex, boost::regex_constants::icase);
-            else reg = boost::regex(".*");
-          } catch(...) {
-            reg = boost::regex(".*");
-          }
+    struct stat st{};
+    stat(path.c_str(), &st);
 
-          if(!boost::regex_search(name, reg)) continue;
+    auto it = cache.find(path);
+    if(it != cache.end()) {
+      DirListing& cached = *it->second;
+      if(cached.error == 0 && cached.st.st_ino == st.st_ino && cached.st.st_dev == st.st_dev
+        && cached.st.st_mtim.tv_sec == st.st_mtim.tv_sec && cached.st.st_mtim.tv_nsec == st.st_mtim.tv_nsec) {
+        return it->second;
+      }
+    }
+
+    auto listing = std::make_shared<DirListing>();
+    listing->st = st; // Taken before reading, so anything changing it while reading makes it stale
+    listing->reader = std::thread(&DirListing::read_dir, listing.get(), path);
+    cache[path] = listing;
+    return listing;
+  }
 
-          std::string type = [&]() -> std::string {
-            struct stat st;
-            std::string fullpath = dirpath + "/" + name;
+  // Moves whatever the reader got since the last call into entries. True if that changed anything
+  bool poll() {
+    if(done) return false;
+
+    std::lock_guard lock(mutex);
+    bool changed = !pending.empty() || finished;
+    for(auto& entry : pending) names.add(entry.name);
+    entries.insert(entries.end(), std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+    pending.clear();
+    done = finished;
+    return changed;
+  }
+};
 
-            if(lstat(fullpath.c_str(), &st) != 0) {
-              return "file";
-            };
+// Every file below a directory, found by a parallel walk in the background and handed over in batches.
+// Inside a git repository whatever the ignore rules leave out is skipped, along with .git itself
+class TreeIndex {
+  private:
+  walk::ResultQueue results; // Batches of "<DT_* byte><path relative to the root>\0"
+  std::atomic<bool> finished{false};
+  std::atomic<bool> stop{false};
+  std::thread walker;
+
+  void run(std::string root) {
+    // Where the root is inside the work tree, since git wants paths relative to that
+    std::string prefix;
+    bool use_git = false;
+    {
+      GitRepo repo(root);
+      std::string workdir = repo.get_repo() ? repo.get_root_path() : "";
+      char real[PATH_MAX];
+      if(!workdir.empty() && realpath(root.c_str(), real)) {
+        std::string path = std::string(real) + "/";
+        if(path.starts_with(workdir)) {
+          prefix = path.substr(workdir.size());
+          use_git = true;
+        }
+      }
+    }
 
-            if(S_ISREG(st.st_mode))  return "file";
-            if(S_ISDIR(st.st_mode))  return "dir";
-            if(S_ISLNK(st.st_mode))  return "link";
-            if(S_ISFIFO(st.st_mode)) return "fifo";
-            if(S_ISSOCK(st.st_mode)) return "sock";
-            if(S_ISBLK(st.st_mode))  return "blk";
-            if(S_ISCHR(st.st_mode))  return "char";
+    walk::Options options;
+    unsigned threads = walk::thread_count(options);
+    std::vector<std::unique_ptr<GitRepo>> repos(threads);
+    std::vector<std::string> batches(threads);
+    std::vector<std::chrono::steady_clock::time_point> flushed(threads, std::chrono::steady_clock::now());
+    size_t skip = root.ends_with('/') ? root.size() : root.size() + 1;
+
+    options.visit = [&](walk::Entry& entry, unsigned worker) {
+      if(stop || entry.name == ".git") return false;
+
+      unsigned char type = entry.type();
+      std::string rel = entry.path().substr(skip);
+      if(use_git) {
+        auto& repo = repos[worker];
+        if(!repo) repo = std::make_unique<GitRepo>(root);
+        if(repo->is_ignored(prefix + rel + (type == DT_DIR ? "/" : ""))) return false;
+      }
+      if(type == DT_DIR) return true;
+
+      std::string& batch = batches[worker];
+      batch += static_cast<char>(type);
+      batch += rel;
+      batch += '\0';
+
+      // Small batches, or a slow disk would keep what was found from showing up
+      auto now = std::chrono::steady_clock::now();
+      if(batch.size() >= 16 * 1024 || now - flushed[worker] > std::chrono::milliseconds(50)) {
+        results.push(std::move(batch));
+        batch.clear();
+        flushed[worker] = now;
+      }
+      return false;
+    };
 
-            // fallback
-            return "file";
-          }();
+    walk::parallel_walk(root, options);
+    for(auto& batch : batches) {
+      if(!batch.empty()) results.push(std::move(batch));
+    }
+    finished = true;
+  }
 
-          filtered.push_back({type, name});
-        }
+  public:
+  fuzzy::Candidates paths;          // Only touched by the thread calling poll
+  std::vector<unsigned char> types; // DT_* of each path
+  bool done = false;                // The walk is over and everything it found is in paths
 
-        std::sort(filtered.begin(), filtered.end(), [](const auto &a, const auto &b) {
-            bool a_dir = a.first == "dir";
-            bool b_dir = b.first == "dir";
-
-            if (a_dir != b_dir) return a_dir;        // dirs first
-            return a.second < b.second;             // then sort alphabetically by name
-        });
-
-        if(!files.empty()) {
-          auto it = std::find_if(filtered.begin(), filtered.end(), [&](std::pair<std::string, std::string>& pair){
-            return pair.second == files[selected_index].second;
-          });
-          if(it != filtered.end()) {
-            selected_index = std::distance(filtered.begin(), it);
-          } else selected_index = 0;
-        }
+  explicit TreeIndex(const std::string& root) {
+    walker = std::thread(&TreeIndex::run, this, root);
+  }
 
-        files = filtered; 
+  ~TreeIndex() {
+    stop = true;
+    if(walker.joinable()) walker.join();
+  }
 
-        for(int i = starting_index; i < std::min(starting_index + files_height, (int)files.size()); i++) {
-          auto type = files[i].first;
-          auto name = files[i].second;
-
-          std::string ic; // icon and color
-
-          if(type == "dir") ic += yellow;
-          if(type == "link") ic += orange;
-          if(type == "fifo") ic += magenta;
-          if(type == "sock") ic += blue;
-          if(type == "blk") ic += cyan;
-          if(type == "char") ic += gray;
-
-          if(!no_icons) {
-            if(type == "file") ic += "\uf4a5";
-            if(type == "dir") ic += "\uf4d3";
-            if(type == "link") ic += "\uf0c1";
-            if(type == "fifo") ic += "\U000f07e5";
-            if(type == "sock") ic += "\U000f0427";
-            if(type == "blk") ic += "\uf0a0";
-            if(type == "char") ic += "\uf11c";
-          }
+  // Adds whatever the walk found since the last call. True if that changed anything
+  bool poll() {
+    if(done) return false;
+
+    bool was_finished = finished; // Before taking, so nothing pushed after it is missed
+    bool changed = was_finished;
+    for(auto& batch : results.take_all()) {
+      for(size_t start = 0; start < batch.size();) {
+        size_t end = batch.find('\0', start);
+        types.push_back(static_cast<unsigned char>(batch[start]));
+        paths.add(std::string_view(batch).substr(start + 1, end - start - 1));
+        start = end + 1;
+      }
+      changed = true;
+    }
+    done = was_finished;
+    return changed;
+  }
+};
 
-          std::stringstream ss;
-          if(i == selected_index) ss << bg_gray;
-          ss << ic << " " << name << reset << "\n";
-          io::print(ss.str());
-        }
+class Srch {
+  private:
+    Tui::Screen screen;
+    Tui::EventLoop loop; // Made along with Srch, before any reader threads start
+
+    // A line of ─ across the screen
+    void separator(int row) {
+      std::string line;
+      for(int i = 0; i < screen.cols(); i++) line += "─";
+      screen.line(row, line);
+    }
+
+    // Icon and color for an entry of this type
+    std::string style(unsigned char type, bool no_icons) {
+      std::string ic;
+
+      if(type == DT_DIR) ic += yellow;
+      if(type == DT_LNK) ic += orange;
+      if(type == DT_FIFO) ic += magenta;
+      if(type == DT_SOCK) ic += blue;
+      if(type == DT_BLK) ic += cyan;
+      if(type == DT_CHR) ic += gray;
+
+      if(!no_icons) {
+        if(type == DT_DIR) ic += "\uf4d3";
+        else if(type == DT_LNK) ic += "\uf0c1";
+        else if(type == DT_FIFO) ic += "\U000f07e5";
+        else if(type == DT_SOCK) ic += "\U000f0427";
+        else if(type == DT_BLK) ic += "\uf0a0";
+        else if(type == DT_CHR) ic += "\uf11c";
+        else ic += "\uf4a5";
+      }
+      return ic;
+    }
+
+    int files_srch(bool no_icons, std::string dirpath) {
+      screen.invalidate();
+
+      std::string buffer;
+      std::shared_ptr<DirListing> listing = DirListing::open(dirpath);
+      fuzzy::Pattern pattern(buffer);
+      size_t filtered_up_to = 0;        // Entries of the listing the pattern already ran on
+      std::vector<fuzzy::Match> files;  // Entries that match, best first. Dirs first and then by name without a query
+
+      int selected_index = 0,
+          height = Tui::get_terminal_height() - 4,
+          starting_index = 0;
 
-        int i = 0;
-        while(files.size() + i < files_height) {
-          io::print("\n");
-          i++;
+      auto before = [&](const fuzzy::Match& a, const fuzzy::Match& b) {
+        const FileEntry& x = listing->entries[a.index];
+        const FileEntry& y = listing->entries[b.index];
+        bool a_dir = x.type == DT_DIR;
+        bool b_dir = y.type == DT_DIR;
+
+        if (a_dir != b_dir) return a_dir;        // dirs first
+        return x.name < y.name;                  // then sort alphabetically by name
+      };
+
+      // Matches for the entries in [begin, end), sorted the way files is
+      auto match_range = [&](size_t begin, size_t end) {
+        if(!pattern.empty()) return fuzzy::match(pattern, listing->names, fuzzy::Tiebreak::LENGTH, begin, end);
+
+        std::vector<fuzzy::Match> all;
+        for(size_t i = begin; i < end; i++) all.push_back({static_cast<uint32_t>(i), 0});
+        std::sort(all.begin(), all.end(), before);
+        return all;
+      };
+
+      // Runs when the query changed. A query that only narrows the last one rescores what's shown now,
+      // anything else goes through all of the entries again
+      auto apply_query = [&]() {
+        fuzzy::Pattern next(buffer);
+        bool narrowing = !pattern.empty() && next.narrows(pattern);
+        pattern = std::move(next);
+        files = narrowing ? fuzzy::match(pattern, listing->names, files) : match_range(0, filtered_up_to);
+
+        selected_index = 0;
+        starting_index = 0;
+      };
+
+      // Matches whatever the reader added since last time and merges it in, keeping the same entry selected.
+      // A listing that came from the cache is already complete, so this goes by what was matched, not by poll()
+      auto take_new_entries = [&]() {
+        bool changed = listing->poll(); // Also true when the reader just finished, which the header shows
+        if(filtered_up_to == listing->entries.size()) return changed;
+
+        uint32_t selected = selected_index < (int)files.size() ? files[selected_index].index : UINT32_MAX;
+        std::vector<fuzzy::Match> more = match_range(filtered_up_to, listing->entries.size());
+        filtered_up_to = listing->entries.size();
+
+        if(pattern.empty()) {
+          size_t middle = files.size();
+          files.insert(files.end(), more.begin(), more.end());
+          std::inplace_merge(files.begin(), files.begin() + middle, files.end(), before);
+        } else {
+          fuzzy::merge(files, std::move(more), listing->names);
         }
 
-        Tui::print_separator();
-        io::print(orange + "> " + reset + buffer);
+        auto it = std::find_if(files.begin(), files.end(), [&](const fuzzy::Match& m) { return m.index == selected; });
+        selected_index = it != files.end() ? std::distance(files.begin(), it) : 0;
+        if(selected_index < starting_index || selected_index >= starting_index + files_height) {
+          starting_index = std::max(0, selected_index - files_height + 1);
+        }
+        return true;
       };
-      auto redraw_line = [&](int selected_index, int starting_index, bool highlight) {
-        Tui::turn_cursor(OFF);
-        Tui::move_cursor_to((selected_index - starting_index) + 3, 0);
-        if(highlight) io::print(bg_gray);
-
-        std::string ic; // icon and color
-        std::string type = files[selected_index].first;
-
-        if(type == "dir") ic += yellow;
-        if(type == "link") ic += orange;
-        if(type == "fifo") ic += magenta;
-        if(type == "sock") ic += blue;
-        if(type == "blk") ic += cyan;
-        if(type == "char") ic += gray;
-
-        if(!no_icons) {
-          if(type == "file") ic += "\uf4a5";
-          if(type == "dir") ic += "\uf4d3";
-          if(type == "link") ic += "\uf0c1";
-          if(type == "fifo") ic += "\U000f07e5";
-          if(type == "sock") ic += "\U000f0427";
-          if(type == "blk") ic += "\uf0a0";
-          if(type == "char") ic += "\uf11c";
+
+      // The whole frame gets drawn every time, the screen only sends the lines that changed
+      auto redraw = [&](){
+        screen.clear();
+
+        std::string header = yellow + "Current directory: " + reset + dirpath;
+        if(!listing->done) header += gray + " (reading...)" + reset;
+        screen.line(0, header);
+        separator(1);
+
+        int lines = 0;
+        if(listing->done && listing->error != 0) {
+          screen.line(2, red + strerror(listing->error) + reset); // TODO: Next version, make a popup component in the tui library
+          lines++;
+        }
+
+        for(int i = starting_index; i < std::min(starting_index + files_height, (int)files.size()); i++, lines++) {
+          const FileEntry& entry = listing->entries[files[i].index];
+          screen.line(2 + lines, (i == selected_index ? bg_gray : "") + style(entry.type, no_icons) + " " + entry.name + reset);
         }
 
-        io::print(ic + " " + files[selected_index + starting_index].second + reset);
-        io::print("\x1b[0K");
-        Tui::move_cursor_to(Tui::get_terminal_height(), 2 + buffer.size());
+        separator(screen.rows() - 2);
+        screen.line(screen.rows() - 1, orange + "> " + reset + buffer);
+        screen.present();
       };
 
-      int selected_index = 0,
-          height = Tui::get_terminal_height() - 4,
-          starting_index = 0;
-  
-      renderer = [&](){
-        redraw(buffer, selected_index, starting_index); // for files
-      };       
+      take_new_entries();
+      redraw();
 
-      redraw(".*", selected_index, starting_index);
+      // While the reader is still going, show whatever it found in the meantime every so often
+      int tick = listing->done ? -1 : loop.add_timer(50);
 
       while(true) {
-        std::string keypress = Tui::get_keypress();
-        if(keypress.empty()) continue;
+        Tui::Event event = loop.wait();
+        if(event.type == Tui::Event::RESIZE) {
+          update_heights();
+          redraw();
+          continue;
+        }
+        if(event.type == Tui::Event::TIMER) {
+          if(take_new_entries()) redraw();
+          if(listing->done) {
+            loop.remove_timer(tick);
+            tick = -1;
+          }
+          continue;
+        }
+
+        std::string keypress = event.key;
 
         if(keypress == "Backspace") {
           if(!buffer.empty()) {
             buffer.pop_back();
-            io::print("\b \b");
+            apply_query();
           }
         }
 
         if(keypress == "ArrowDown") {
             if(selected_index + 1 < files.size()) {
                 selected_index++;
-                if(selected_index >= starting_index + files_height) {
-                  starting_index = selected_index - files_height + 1;
-                  redraw(buffer, selected_index, starting_index);
-                } else if(starting_index != 0) {
-                    redraw(buffer, selected_index, starting_index);
-                }
-                else {
-                  redraw_line(selected_index - 1, starting_index, false);
-                  redraw_line(selected_index, starting_index, true);
-                }
+                if(selected_index >= starting_index + files_height) starting_index = selected_index - files_height + 1;
+                redraw();
             }
             continue;
         }
@@ -205,48 +404,164 @@ class Srch {
         if(keypress == "ArrowUp") {
             if(selected_index > 0) {
                 selected_index--;
-                if(selected_index < starting_index) {
-                    starting_index = selected_index;
-                    redraw(buffer, selected_index, starting_index);
-                } else if(starting_index != 0) {
-                    redraw(buffer, selected_index, starting_index);
-                } else {
-                  redraw_line(selected_index + 1, starting_index, false);
-                  redraw_line(selected_index, starting_index, true);
-                }
+                if(selected_index < starting_index) starting_index = selected_index;
+                redraw();
             }
             continue;
         }
 
-        if(keypress == "Enter") {
-          if(files[selected_index].first == "dir") {
-            std::filesystem::path canonical = std::filesystem::canonical(std::filesystem::path(dirpath + "/" + files[selected_index].second));
+        if(keypress == "Enter" && selected_index < (int)files.size()) {
+          const FileEntry& entry = listing->entries[files[selected_index].index];
+          if(entry.type == DT_DIR) {
+            std::filesystem::path canonical = std::filesystem::canonical(std::filesystem::path(dirpath + "/" + entry.name));
+            if(tick >= 0) loop.remove_timer(tick);
             return files_srch(no_icons, canonical.string());
           } else {
-            if(!files.empty() && selected_index + starting_index < files.size()) {
-              disable_raw_mode();
-              Tui::switch_to_normal();
-              io::print(files[selected_index].second + "\n"); // For piping
-              Tui::turn_cursor(ON);
-              _exit(0);
-            }
+            disable_raw_mode();
+            Tui::switch_to_normal();
+            io::print(entry.name + "\n"); // For piping
+            Tui::turn_cursor(ON);
+            _exit(0);
           }
-
         }
 
         if(keypress.size() == 1 && isprint(keypress[0])) {
-          io::print(keypress);
           buffer.push_back(keypress[0]);
+          apply_query();
         }
 
-        Tui::clear();
-        redraw(buffer, selected_index, starting_index);
+        redraw();
       }
 
       Tui::move_cursor_to(Tui::get_terminal_height(), 3);
       return 0;
     }
 
+    // Like files_srch, but for every file below dirpath, matched by its path relative to it
+    int tree_srch(bool no_icons, std::string dirpath) {
+      screen.invalidate();
+
+      std::string buffer;
+      TreeIndex index(dirpath);
+      fuzzy::Pattern pattern(buffer);
+      size_t filtered_up_to = 0;        // Paths the pattern already ran on
+      std::vector<fuzzy::Match> files;  // Paths that match, best first
+
+      int selected_index = 0,
+          starting_index = 0;
+
+      auto apply_query = [&]() {
+        fuzzy::Pattern next(buffer);
+        bool narrowing = !pattern.empty() && next.narrows(pattern);
+        pattern = std::move(next);
+        files = narrowing ? fuzzy::match(pattern, index.paths, files) : fuzzy::match(pattern, index.paths, fuzzy::Tiebreak::LENGTH, 0, filtered_up_to);
+
+        selected_index = 0;
+        starting_index = 0;
+      };
+
+      auto take_new_paths = [&]() {
+        if(!index.poll()) return false;
+
+        uint32_t selected = selected_index < (int)files.size() ? files[selected_index].index : UINT32_MAX;
+        fuzzy::merge(files, fuzzy::match(pattern, index.paths, fuzzy::Tiebreak::LENGTH, filtered_up_to), index.paths);
+        filtered_up_to = index.paths.size();
+
+        auto it = std::find_if(files.begin(), files.end(), [&](const fuzzy::Match& m) { return m.index == selected; });
+        selected_index = it != files.end() ? std::distance(files.begin(), it) : 0;
+        if(selected_index < starting_index || selected_index >= starting_index + files_height) {
+          starting_index = std::max(0, selected_index - files_height + 1);
+        }
+        return true;
+      };
+
+      auto row = [&](int i) {
+        uint32_t path = files[i].index;
+        return style(index.types[path], no_icons) + " " + std::string(index.paths.at(path)) + reset;
+      };
+
+      auto redraw = [&](){
+        screen.clear();
+
+        screen.line(0, yellow + "Files below: " + reset + dirpath + gray + "  " + std::to_string(files.size()) + "/"
+          + std::to_string(index.paths.size()) + (index.done ? "" : " (indexing...)") + reset);
+        separator(1);
+
+        for(int i = starting_index; i < std::min(starting_index + files_height, (int)files.size()); i++) {
+          screen.line(2 + i - starting_index, (i == selected_index ? bg_gray : "") + row(i));
+        }
+
+        separator(screen.rows() - 2);
+        screen.line(screen.rows() - 1, orange + "> " + reset + buffer);
+        screen.present();
+      };
+
+      take_new_paths();
+      redraw();
+
+      // Shows whatever the walk found in the meantime, a few times a second at most
+      int tick = index.done ? -1 : loop.add_timer(100);
+
+      while(true) {
+        Tui::Event event = loop.wait();
+        if(event.type == Tui::Event::RESIZE) {
+          update_heights();
+          redraw();
+          continue;
+        }
+        if(event.type == Tui::Event::TIMER) {
+          if(take_new_paths()) redraw();
+          if(index.done) {
+            loop.remove_timer(tick);
+            tick = -1;
+          }
+          continue;
+        }
+
+        std::string keypress = event.key;
+
+        if(keypress == "Backspace") {
+          if(!buffer.empty()) {
+            buffer.pop_back();
+            apply_query();
+          }
+        }
+
+        if(keypress == "ArrowDown") {
+          if(selected_index + 1 < (int)files.size()) {
+            selected_index++;
+            if(selected_index >= starting_index + files_height) starting_index = selected_index - files_height + 1;
+            redraw();
+          }
+          continue;
+        }
+
+        if(keypress == "ArrowUp") {
+          if(selected_index > 0) {
+            selected_index--;
+            if(selected_index < starting_index) starting_index = selected_index;
+            redraw();
+          }
+          continue;
+        }
+
+        if(keypress == "Enter" && selected_index < (int)files.size()) {
+          disable_raw_mode();
+          Tui::switch_to_normal();
+          io::print(std::string(index.paths.at(files[selected_index].index)) + "\n"); // For piping
+          Tui::turn_cursor(ON);
+          _exit(0);
+        }
+
+        if(keypress.size() == 1 && isprint(keypress[0])) {
+          buffer.push_back(keypress[0]);
+          apply_query();
+        }
+
+        redraw();
+      }
+    }
+
     int history_srch(bool no_icons) {
       static std::unordered_map<std::string, std::string> icons = {
         {"vim", "\ue62b"},
@@ -316,7 +631,7 @@ class Srch {
         {"sleep", "\U000f0904"}
     };
 
-      Tui::clear();
+      screen.invalidate();
       std::string home = getenv("HOME");
       auto content = io::read_file(home + "/.slash/.slash_history");
       if(!std::holds_alternative<std::string>(content)) {
@@ -328,107 +643,83 @@ class Srch {
       }
 
       std::vector<std::string> history = io::split(std::get<std::string>(content), "\n");
-      std::vector<std::string> filtered;
+
+      // Every command once, newest first, so ties go to the most recent one
+      fuzzy::Candidates commands;
+      std::unordered_set<std::string_view> seen;
+      for(auto it = history.rbegin(); it != history.rend(); it++) {
+        if(!it->empty() && seen.insert(*it).second) commands.add(*it);
+      }
+
+      fuzzy::Pattern pattern("");
+      std::vector<fuzzy::Match> filtered = fuzzy::match(pattern, commands, fuzzy::Tiebreak::INDEX);
+      auto line = [&](int i) { return std::string(commands.at(filtered[i].index)); };
 
       int selected_index = 0;
       int starting_index = 0;
       std::string buffer;
 
-      auto redraw = [&](int &selected_index, int starting_index) {
-          // Rebuild filtered list
-          filtered.clear();
-          boost::regex reg;
-          try {
-              reg = buffer.empty() ? boost::regex(".*") : boost::regex(buffer, boost::regex_constants::icase);
-          } catch(...) {
-              reg = boost::regex(".*");
-          }
-          for(auto &elm : history) {
-              if(boost::regex_search(elm, reg)) filtered.push_back(elm);
-          }
+      // Runs when the query changed. Typing more only rescores what matched before
+      auto refilter = [&]() {
+          fuzzy::Pattern next(buffer);
+          bool narrowing = !pattern.empty() && next.narrows(pattern);
+          pattern = std::move(next);
+          filtered = narrowing ? fuzzy::match(pattern, commands, filtered, fuzzy::Tiebreak::INDEX)
+                               : fuzzy::match(pattern, commands, fuzzy::Tiebreak::INDEX);
+      };
 
+      auto redraw = [&](int &selected_index, int starting_index) {
           // Clamp selected_index
           if(selected_index >= (int)filtered.size()) selected_index = filtered.empty() ? 0 : filtered.size() - 1;
 
-          Tui::clear();
+          screen.clear();
           for(int i = starting_index; i < std::min(starting_index + height, (int)filtered.size()); i++) {
-              if(i == selected_index) io::print(bg_gray);
+              std::string row = i == selected_index ? bg_gray : "";
 
               if(!no_icons) {
-                std::string command = io::split(filtered[i], " ")[0];
-                if(command.starts_with("sudo")) command = io::split(filtered[i], " ")[1]; // Get icon for command instead of sudo
+                std::string command = io::split(line(i), " ")[0];
+                if(command.starts_with("sudo")) command = io::split(line(i), " ")[1]; // Get icon for command instead of sudo
 
                 auto it = icons.find(command);
                 if(it != icons.end()) {
-                  io::print(icons[io::split(command, " ")[0]]);
-                } else io::print("\uf489");
+                  row += icons[io::split(command, " ")[0]];
+                } else row += "\uf489";
 
-                io::print(" ");
+                row += " ";
               }
 
-              io::print(filtered[i] + reset + "\n");
-          }
-
-          int extra = 0;
-          while(filtered.size() + extra < Tui::get_terminal_height()) {
-              io::print("\n");
-              extra++;
-          }
-
-          Tui::print_separator();
-          io::print(orange + "> " + reset + buffer);
-      };
-
-      auto redraw_line = [&](int selected_index, int starting_index, bool highlight) {
-          int row = (selected_index - starting_index) + 1;
-          Tui::move_cursor_to(row, 0);
-          if(highlight) io::print(bg_gray);
-
-          if(!no_icons) {
-              std::string command = io::split(filtered[starting_index + selected_index], " ")[0];
-              if(command.starts_with("sudo")) command = io::split(filtered[starting_index + selected_index], " ")[1]; // Get icon for command instead of sudo
-
-              auto it = icons.find(command);
-              if(it != icons.end()) {
-               io::print(icons[io::split(command, " ")[0]]);
-             } else io::print("\uf489");
-
-            io::print(" ");
+              screen.line(i - starting_index, row + line(i) + reset);
           }
 
-          io::print("\x1b[0K"); // Clear line
-          io::print(filtered[selected_index] + reset);
-          Tui::move_cursor_to(Tui::get_terminal_height(), buffer.size() + 2);
+          separator(screen.rows() - 2);
+          screen.line(screen.rows() - 1, orange + "> " + reset + buffer);
+          screen.present();
       };
 
       redraw(selected_index, starting_index);
-      renderer = [&](){
-        redraw(selected_index, starting_index);
-      };
 
       while(true) {
-          std::string keypress = Tui::get_keypress();
-          if(keypress.empty()) continue;
+          Tui::Event event = loop.wait();
+          if(event.type == Tui::Event::RESIZE) {
+              update_heights();
+              redraw(selected_index, starting_index);
+              continue;
+          }
+
+          std::string keypress = event.key;
 
           if(keypress == "Backspace") {
               if(!buffer.empty()) {
                   buffer.pop_back();
-                  io::print("\b \b");
+                  refilter();
               }
           }
 
           if(keypress == "ArrowDown") {
               if(selected_index + 1 < (int)filtered.size()) {
                   selected_index++;
-                  if(selected_index >= starting_index + height) {
-                      starting_index = selected_index - height + 1;
-                      redraw(selected_index, starting_index);
-                  } else if(starting_index != 0) {
-                      redraw(selected_index, starting_index);
-                  } else {
-                      redraw_line(selected_index - 1, starting_index, false);
-                      redraw_line(selected_index, starting_index, true);
-                  }
+                  if(selected_index >= starting_index + height) starting_index = selected_index - height + 1;
+                  redraw(selected_index, starting_index);
               }
               continue;
           }
@@ -436,15 +727,8 @@ class Srch {
           if(keypress == "ArrowUp") {
               if(selected_index > 0) {
                   selected_index--;
-                  if(selected_index < starting_index) {
-                      starting_index = selected_index;
-                      redraw(selected_index, starting_index);
-                  } else if(starting_index != 0) {
-                      redraw(selected_index, starting_index);
-                  } else {
-                      redraw_line(selected_index + 1, starting_index, false);
-                      redraw_line(selected_index, starting_index, true);
-                  }
+                  if(selected_index < starting_index) starting_index = selected_index;
+                  redraw(selected_index, starting_index);
               }
               continue;
           }
@@ -452,7 +736,7 @@ class Srch {
           if(keypress == "Enter") {
               disable_raw_mode();
               Tui::switch_to_normal();
-              if(!filtered.empty()) io::print(filtered[selected_index] + "\n");
+              if(!filtered.empty()) io::print(line(selected_index) + "\n");
               Tui::turn_cursor(ON);
               _exit(0);
           }
@@ -461,6 +745,7 @@ class Srch {
               buffer.push_back(keypress[0]);
               selected_index = 0;
               starting_index = 0;
+              refilter();
           }
 
           redraw(selected_index, starting_index);
@@ -475,21 +760,31 @@ class Srch {
 
       signal(SIGINT, Tui::cleanup_and_exit);
       signal(SIGTERM, Tui::cleanup_and_exit);
-      signal(SIGWINCH, winch_handler);
 
-      auto render = [&](){
+      auto welcome = [&](){
         Tui::clear();
         std::stringstream ss;
         ss << "Welcome to " << green << "srch!\n\n" << reset;
         ss << blue << "Ctrl+F" << reset << " to search files  \n";
+        ss << blue << "Ctrl+T" << reset << " to search all files below\n";
         ss << blue << "Ctrl+P" << reset << " to search history\n";
         ss << red  << "     q" << reset << " to exit\n";
 
         Tui::print_in_center_of_terminal(ss.str());
+      };
+
+      auto render = [&](){
+        welcome();
 
         while(true) {
-          std::string keypress = Tui::get_keypress();
-          if(keypress.empty()) continue;
+          Tui::Event event = loop.wait();
+          if(event.type == Tui::Event::RESIZE) {
+            update_heights();
+            welcome();
+            continue;
+          }
+
+          std::string keypress = event.key;
 
           if(keypress == "q" || keypress == "Q") {
             disable_raw_mode();
@@ -502,13 +797,18 @@ class Srch {
 
             return files_srch(no_icons, buffer);
           }
+          if(keypress == "Ctrl+T") {
+            char buffer[PATH_MAX];
+            getcwd(buffer, PATH_MAX);
+
+            return tree_srch(no_icons, buffer);
+          }
           if(keypress == "Ctrl+P") return history_srch(no_icons);
 
           continue;
         }
       };
 
-      renderer = [render](){ render(); };
       return render();
     }
 
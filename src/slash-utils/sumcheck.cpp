@@ -1,5 +1,6 @@
 #include "../abstractions/iofuncs.h"
 #include "../abstractions/info.h"
+#include "../abstractions/filestream.h"
 
 #include <bitset>
 #include <sstream>
@@ -29,7 +30,7 @@ class Sumcheck {
         return std::regex_replace(input, ansi_pattern, "");
     }
 
-    uint32_t crc32(std::string data) {
+    uint32_t crc32(std::string_view data) {
         init_crc32_table();
         uint32_t crc = 0xFFFFFFFF;
         for (unsigned char byte : data) {
@@ -38,7 +39,7 @@ class Sumcheck {
         return ~crc;
     }
 
-    int get_vrc(std::string data) {
+    int get_vrc(std::string_view data) {
       int ones = 0;
       for(auto& byte : data) {
         ones += std::bitset<8>(byte).count();
@@ -46,7 +47,7 @@ class Sumcheck {
       return ones % 2 == 0 ? 0 : 1;
     }
 
-    uint8_t get_lrc(std::string data) {
+    uint8_t get_lrc(std::string_view data) {
       uint8_t res = 0;
       for(auto& byte : data) res ^= byte;
       return res;
@@ -60,29 +61,30 @@ class Sumcheck {
       return ss.str();
     }
 
-    std::string get_md5(std::string input) {
+    std::string get_md5(std::string_view input) {
         unsigned char digest[MD5_DIGEST_LENGTH];
-        MD5(reinterpret_cast<const unsigned char*>(input.c_str()), input.size(), digest);
+        MD5(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
         return to_hex(digest, MD5_DIGEST_LENGTH);
     }
 
-    std::string get_sha256(std::string input) {
+    std::string get_sha256(std::string_view input) {
         unsigned char digest[SHA256_DIGEST_LENGTH];
-        SHA256(reinterpret_cast<const unsigned char*>(input.c_str()), input.size(), digest);
+        SHA256(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
         return to_hex(digest, SHA256_DIGEST_LENGTH);
     }
 
     int sumcheck(std::string content, bool is_file, bool no_color, bool vrc, bool lrc, bool crc, bool md5, bool sha256) {
-      std::string content_to_use;
-      if(!is_file) content_to_use = content;
-      else {
-        auto cnt = io::read_file(content);
-        if(!std::holds_alternative<std::string>(cnt)) {
-          std::string error = std::string("Failed to read file: ") + strerror(errno);
-          info::error(error, errno);
+      // Files are hashed straight from the mapping, not copied into a string first
+      io::FileView file;
+      std::string_view content_to_use = content;
+      if(is_file) {
+        file = io::FileView(content);
+        if(!file.ok()) {
+          std::string error = std::string("Failed to read file: ") + strerror(file.error());
+          info::error(error, file.error());
           return -1;
         }
-        content_to_use = std::get<std::string>(cnt);
+        content_to_use = file.view();
       }
 
       std::vector<std::pair<std::string, std::string>> results;
@@ -1,21 +1,32 @@
 #include "tui.h"
 #include "../abstractions/iofuncs.h"
+#include "../abstractions/info.h"
 
 #include <unordered_map>
 #include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <sys/signalfd.h>
 
 static struct termios orig_tty;
+static int raw_fd = STDIN_FILENO;
 
 void enable_raw_mode() {
-    tcgetattr(STDIN_FILENO, &orig_tty);  // Save original
+    // With input piped in (command | pager -t), the terminal is only reachable through /dev/tty
+    if(!isatty(STDIN_FILENO)) {
+      int fd = open("/dev/tty", O_RDONLY | O_CLOEXEC);
+      if(fd >= 0) raw_fd = fd;
+    }
+    tcgetattr(raw_fd, &orig_tty);  // Save original
     struct termios tty = orig_tty;
     tty.c_lflag &= ~ICANON;
     tty.c_lflag &= ~ECHO;
-    tcsetattr(STDIN_FILENO, TCSANOW, &tty);
+    tcsetattr(raw_fd, TCSANOW, &tty);
 }
 
 void disable_raw_mode() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &orig_tty);  // Restore original
+    tcsetattr(raw_fd, TCSANOW, &orig_tty);  // Restore original
 }
 
 void Tui::switch_to_alternate() {
@@ -98,9 +109,9 @@ void Tui::print_in_center_of_terminal(std::string text) {
 }
 
 void Tui::print_separator() {
-  for(int i = 0; i < Tui::get_terminal_width(); i++) {
-     io::print("─");
-  } io::print("\n");
+  std::string line;
+  for(int i = 0; i < Tui::get_terminal_width(); i++) line += "─";
+  io::print(line + "\n");
 }
 
 int Tui::get_terminal_width() {
@@ -124,36 +135,443 @@ void init_tty() {
   }
 }
 
+// Bytes in the UTF-8 sequence that starts with lead, 1 for anything that can't start one
+static size_t utf8_length(unsigned char lead) {
+  if(lead < 0x80) return 1;
+  if((lead >> 5) == 0x6) return 2;
+  if((lead >> 4) == 0xE) return 3;
+  if((lead >> 3) == 0x1E) return 4;
+  return 1;
+}
+
+// Parses the key at the start of bytes into the name get_keypress() gives it ("" for sequences nobody
+// needs). Returns how many bytes it took, 0 if bytes end partway through one
+static size_t parse_key(std::string_view bytes, std::string& key) {
+  unsigned char c = bytes[0];
+  key.clear();
+
+  if(c == 27) {
+    if(bytes.size() == 1) return 0;
+
+    if(bytes[1] == '[') {
+      size_t end = 2;
+      while(end < bytes.size() && !(bytes[end] >= 0x40 && bytes[end] <= 0x7E)) end++;
+      if(end == bytes.size()) return bytes.size() > 32 ? 1 : 0; // Garbage rather than a slow sequence
+
+      std::string_view params = bytes.substr(2, end - 2);
+      char final = bytes[end];
+
+      // Modifiers come as "1;5A" or "5;5~", with 1 + shift/alt/ctrl bits after the ;
+      std::string modifier;
+      size_t semi = params.find(';');
+      if(semi != std::string_view::npos) {
+        int mods = atoi(std::string(params.substr(semi + 1)).c_str()) - 1;
+        if(mods & 4) modifier += "Ctrl+";
+        if(mods & 2) modifier += "Alt+";
+        if(mods & 1) modifier += "Shift+";
+        params = params.substr(0, semi);
+      }
+
+      static const std::unordered_map<char, std::string> finals = {
+        {'A', "ArrowUp"}, {'B', "ArrowDown"}, {'C', "ArrowRight"}, {'D', "ArrowLeft"},
+        {'H', "Home"}, {'F', "End"}, {'Z', "Shift+Tab"}
+      };
+      static const std::unordered_map<std::string_view, std::string> tildes = {
+        {"1", "Home"}, {"2", "Insert"}, {"3", "Delete"}, {"4", "End"}, {"5", "PageUp"}, {"6", "PageDown"},
+        {"7", "Home"}, {"8", "End"}, {"11", "F1"}, {"12", "F2"}, {"13", "F3"}, {"14", "F4"}, {"15", "F5"},
+        {"17", "F6"}, {"18", "F7"}, {"19", "F8"}, {"20", "F9"}, {"21", "F10"}, {"23", "F11"}, {"24", "F12"}
+      };
+
+      if(final == '~') {
+        auto it = tildes.find(params);
+        if(it != tildes.end()) key = modifier + it->second;
+      } else {
+        auto it = finals.find(final);
+        if(it != finals.end()) key = modifier + it->second;
+      }
+      return end + 1;
+    }
+
+    // SS3, sent for arrows in application cursor mode and for F1-F4
+    if(bytes[1] == 'O') {
+      if(bytes.size() < 3) return 0;
+      static const std::unordered_map<char, std::string> ss3 = {
+        {'A', "ArrowUp"}, {'B', "ArrowDown"}, {'C', "ArrowRight"}, {'D', "ArrowLeft"},
+        {'H', "Home"}, {'F', "End"}, {'P', "F1"}, {'Q', "F2"}, {'R', "F3"}, {'S', "F4"}
+      };
+      auto it = ss3.find(bytes[2]);
+      if(it != ss3.end()) key = it->second;
+      return 3;
+    }
+
+    if(bytes[1] == 27) {
+      key = "Escape";
+      return 1;
+    }
+
+    // ESC in front of a key is how terminals send Alt
+    std::string rest;
+    size_t used = parse_key(bytes.substr(1), rest);
+    if(used == 0) return 0;
+    if(!rest.empty()) key = "Alt+" + rest;
+    return used + 1;
+  }
+
+  if(c == '\t') key = "Tab";
+  else if(c == '\r' || c == '\n') key = "Enter";
+  else if(c == 127 || c == 8) key = "Backspace";
+  else if(c >= 1 && c <= 26) key = "Ctrl+" + std::string(1, 'A' + (c - 1));
+  else if(c >= 0x80) {
+    size_t len = utf8_length(c);
+    if(bytes.size() < len) return 0;
+    key = bytes.substr(0, len);
+    return len;
+  }
+  else if(c != 0) key = std::string(1, c);
+  return 1;
+}
+
 std::string Tui::get_keypress() {
   if(tty_fd < 0) init_tty();
 
-  char c;
-  if(read(tty_fd, &c, 1) != 1) return "";
-  
-  if(c == '\t') return "Tab";
-  if(c == '\r' || c == '\n') return "Enter";
-  
-  if(c == 27) {
-    char seq[2];
-    if (read(tty_fd, &seq[0], 1) != 1) return "";
-    if (read(tty_fd, &seq[1], 1) != 1) return "";
+  static std::string pending;
+  char buffer[64];
+  ssize_t n = read(tty_fd, buffer, sizeof(buffer));
+  if(n > 0) pending.append(buffer, n);
+  if(pending.empty()) return "";
+
+  std::string key;
+  size_t used = parse_key(pending, key);
+  if(used == 0) { // Cut short, and there's nothing more to wait for here
+    key = pending[0] == 27 ? "Escape" : "";
+    used = 1;
+  }
+  pending.erase(0, used);
+  return key;
+}
+
+static uint32_t decode_utf8(const char* bytes, size_t len) {
+  auto b = [&](size_t i) { return static_cast<uint32_t>(static_cast<unsigned char>(bytes[i])); };
+  if(len == 2) return (b(0) & 0x1F) << 6 | (b(1) & 0x3F);
+  if(len == 3) return (b(0) & 0x0F) << 12 | (b(1) & 0x3F) << 6 | (b(2) & 0x3F);
+  if(len == 4) return (b(0) & 0x07) << 18 | (b(1) & 0x3F) << 12 | (b(2) & 0x3F) << 6 | (b(3) & 0x3F);
+  return b(0);
+}
 
-    switch(seq[1]) {
-      case 'A': return "ArrowUp";
-      case 'B': return "ArrowDown";
-      case 'C': return "ArrowRight";
-      case 'D': return "ArrowLeft";
+// Columns a code point takes. Not all of wcwidth(), just the ranges that show up in practice:
+// combining marks and joiners take none, CJK, Hangul, fullwidth forms and emoji take two
+static int codepoint_width(uint32_t cp) {
+  if((cp >= 0x300 && cp <= 0x36F) || (cp >= 0x200B && cp <= 0x200F) || cp == 0xFE0E || cp == 0xFE0F) return 0;
+  if((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF && cp != 0x303F) || (cp >= 0xAC00 && cp <= 0xD7A3)
+     || (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60)
+     || (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) || (cp >= 0x1F900 && cp <= 0x1F9FF)
+     || (cp >= 0x20000 && cp <= 0x3FFFD)) return 2;
+  return 1;
+}
+
+// Length of the escape sequence at text[i]: CSI up to its final byte, OSC up to BEL or ST
+static size_t escape_length(std::string_view text, size_t i) {
+  if(i + 1 >= text.size()) return 1;
+  if(text[i + 1] == '[') {
+    size_t j = i + 2;
+    while(j < text.size() && !(text[j] >= 0x40 && text[j] <= 0x7E)) j++;
+    return std::min(j + 1, text.size()) - i;
+  }
+  if(text[i + 1] == ']') {
+    for(size_t j = i + 2; j < text.size(); j++) {
+      if(text[j] == '\a') return j + 1 - i;
+      if(text[j] == '\x1b' && j + 1 < text.size() && text[j + 1] == '\\') return j + 2 - i;
     }
+    return text.size() - i;
   }
+  return 2;
+}
+
+Tui::Screen::Screen() {
+  clear();
+}
+
+uint16_t Tui::Screen::intern(const Style& style) {
+  if(style.sgr.empty() && style.link.empty()) return 0;
+
+  std::string key = style.sgr + '\0' + style.link;
+  auto it = style_ids.find(key);
+  if(it != style_ids.end()) return it->second;
+  if(styles.size() == UINT16_MAX) return 0; // Out of ids, it gets drawn plain
+
+  styles.push_back(style);
+  style_ids.emplace(key, styles.size() - 1);
+  return styles.size() - 1;
+}
 
-  if(c >= 1 && c <= 26) {
-    char ctrl_char = 'A' + (c - 1);
-    return "Ctrl+" + std::string(1, ctrl_char);
+void Tui::Screen::clear() {
+  int rows = get_terminal_height();
+  int columns = get_terminal_width();
+  if(rows != height || columns != width) {
+    height = std::max(rows, 0);
+    width = std::max(columns, 0);
+    front.assign(height * width, Cell{});
+    full_repaint = true;
   }
 
-  if(c == 127 || c == 8) return "Backspace";
+  back.assign(height * width, Cell{});
+  cursor_row = cursor_col = -1;
+}
+
+int Tui::Screen::print(int row, int col, std::string_view text) {
+  if(row < 0 || row >= height) return col;
+  Cell* cells = &back[row * width];
+  Style style;
+  uint16_t id = 0;
+
+  auto put = [&](uint32_t glyph, int w) {
+    if(cells[col].glyph == 0 && col > 0) cells[col - 1].glyph = ' '; // Overwrote half of a wide character
+    cells[col] = {glyph, id};
+    if(w == 2) cells[col + 1] = {0, id};
+    col += w;
+    if(col < width && cells[col].glyph == 0) cells[col].glyph = ' ';
+  };
+
+  for(size_t i = 0; i < text.size() && col < width;) {
+    unsigned char c = text[i];
+
+    if(c == '\x1b') {
+      std::string_view seq = text.substr(i, escape_length(text, i));
+      i += seq.size();
+
+      if(seq.size() >= 3 && seq[1] == '[' && seq.back() == 'm') {
+        std::string_view params = seq.substr(2, seq.size() - 3);
+        if(params.empty() || params == "0") style.sgr.clear();
+        else if(params.starts_with("0;")) style.sgr = seq;
+        else style.sgr += seq;
+        id = intern(style);
+      } else if(seq.starts_with("\x1b]8;")) {
+        size_t uri = seq.find(';', 4);
+        size_t end = seq.size() - (seq.back() == '\a' ? 1 : 2);
+        style.link = uri == std::string_view::npos || uri >= end ? "" : std::string(seq.substr(uri + 1, end - uri - 1));
+        id = intern(style);
+      }
+      continue;
+    }
+
+    if(c == '\n') break;
+    if(c == '\t') {
+      int stop = std::min((col / 8 + 1) * 8, width);
+      while(col < stop) put(' ', 1);
+      i++;
+      continue;
+    }
+    if(c < 32 || c == 127) {
+      i++;
+      continue;
+    }
+
+    size_t len = std::min(utf8_length(c), text.size() - i);
+    uint32_t glyph = 0;
+    memcpy(&glyph, text.data() + i, len);
+    int w = codepoint_width(decode_utf8(text.data() + i, len));
+    i += len;
 
-  return std::string(1, c);
+    if(w == 0) continue;
+    if(col + w > width) break;
+    put(glyph, w);
+  }
+
+  return col;
 }
 
+void Tui::Screen::line(int row, std::string_view text) {
+  if(row < 0 || row >= height) return;
+  std::fill(back.begin() + row * width, back.begin() + (row + 1) * width, Cell{});
+  print(row, 0, text);
+}
 
+void Tui::Screen::place_cursor(int row, int col) {
+  cursor_row = row;
+  cursor_col = col;
+}
+
+void Tui::Screen::present() {
+  std::string out;
+  if(full_repaint) {
+    out += "\x1b[0m\x1b[2J";
+    std::fill(front.begin(), front.end(), Cell{});
+    full_repaint = false;
+  }
+
+  uint16_t pen = 0; // Style the terminal is drawing with
+  int at_row = -1, at_col = -1;
+
+  auto switch_style = [&](uint16_t id) {
+    const Style& from = styles[pen];
+    const Style& to = styles[id];
+    if(from.link != to.link) out += "\x1b]8;;" + to.link + "\x1b\\";
+    if(from.sgr != to.sgr) out += "\x1b[0m" + to.sgr;
+    pen = id;
+  };
+
+  for(int r = 0; r < height; r++) {
+    const Cell* now = &back[r * width];
+    const Cell* was = &front[r * width];
+
+    for(int c = 0; c < width; c++) {
+      if(now[c] == was[c]) continue;
+
+      // The second half of a wide character gets drawn by drawing the first
+      int lead = c;
+      if(now[c].glyph == 0) {
+        if(at_row == r && at_col > c) continue;
+        lead = c - 1;
+      }
+
+      if(at_row == r - 1 && lead == 0 && r > 0) out += "\r\n";
+      else if(at_row != r || at_col != lead) out += "\x1b[" + std::to_string(r + 1) + ";" + std::to_string(lead + 1) + "H";
+      if(now[lead].style != pen) switch_style(now[lead].style);
+
+      uint32_t glyph = now[lead].glyph;
+      out.append(reinterpret_cast<const char*>(&glyph), utf8_length(glyph & 0xFF));
+      at_row = r;
+      at_col = lead + (lead + 1 < width && now[lead + 1].glyph == 0 ? 2 : 1);
+    }
+  }
+
+  bool cursor_moved = cursor_row >= 0 && (!out.empty() || cursor_row != placed_row || cursor_col != placed_col);
+  if(out.empty() && !cursor_moved) return;
+  if(pen != 0) switch_style(0);
+  if(cursor_moved) out += "\x1b[" + std::to_string(cursor_row + 1) + ";" + std::to_string(cursor_col + 1) + "H";
+  placed_row = cursor_row;
+  placed_col = cursor_col;
+
+  // Synchronized update (DEC mode 2026): terminals that know it show the frame all at once, the rest ignore it
+  io::print("\x1b[?2026h" + out + "\x1b[?2026l");
+  front = back;
+}
+
+int Tui::Screen::text_width(std::string_view text) {
+  int col = 0;
+  for(size_t i = 0; i < text.size();) {
+    unsigned char c = text[i];
+    if(c == '\x1b') {
+      i += escape_length(text, i);
+      continue;
+    }
+    if(c == '\t') {
+      col = (col / 8 + 1) * 8;
+      i++;
+      continue;
+    }
+    if(c < 32 || c == 127) {
+      i++;
+      continue;
+    }
+    size_t len = std::min(utf8_length(c), text.size() - i);
+    col += codepoint_width(decode_utf8(text.data() + i, len));
+    i += len;
+  }
+  return col;
+}
+
+Tui::EventLoop::EventLoop() {
+  tty = open("/dev/tty", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGWINCH);
+  pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+  winch = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+Tui::EventLoop::~EventLoop() {
+  if(tty >= 0) close(tty);
+  if(winch >= 0) close(winch);
+  pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+}
+
+int Tui::EventLoop::add_timer(int interval_ms) {
+  auto interval = std::chrono::milliseconds(interval_ms);
+  timers.push_back({next_timer, interval, std::chrono::steady_clock::now() + interval});
+  return next_timer++;
+}
+
+void Tui::EventLoop::remove_timer(int id) {
+  std::erase_if(timers, [&](const Timer& t) { return t.id == id; });
+  std::erase_if(ready, [&](const Event& e) { return e.type == Event::TIMER && e.timer == id; });
+}
+
+// Turns whatever was read into key events. With flush, a sequence that never got finished
+// (which is how a lone Escape looks) is given up on
+void Tui::EventLoop::read_keys(bool flush) {
+  char buffer[4096];
+  ssize_t n;
+  while((n = read(tty, buffer, sizeof(buffer))) > 0) pending.append(buffer, n);
+
+  while(!pending.empty()) {
+    std::string key;
+    size_t used = parse_key(pending, key);
+    if(used == 0) {
+      if(!flush) break;
+      key = pending[0] == 27 ? "Escape" : "";
+      used = 1;
+    }
+    pending.erase(0, used);
+    if(!key.empty()) ready.push_back({Event::KEY, key, -1});
+  }
+}
+
+Tui::Event Tui::EventLoop::wait() {
+  // How long the rest of an escape sequence gets to arrive before the ESC counts as the Escape key
+  const auto ESCAPE_DELAY = std::chrono::milliseconds(25);
+
+  while(ready.empty()) {
+    auto now = std::chrono::steady_clock::now();
+    int timeout = -1;
+    auto until = [&](std::chrono::steady_clock::time_point when) {
+      int ms = std::max<int64_t>(0, std::chrono::ceil<std::chrono::milliseconds>(when - now).count());
+      if(timeout < 0 || ms < timeout) timeout = ms;
+    };
+    for(auto& timer : timers) until(timer.next);
+    if(!pending.empty()) until(now + ESCAPE_DELAY);
+
+    struct pollfd fds[2] = {{tty, POLLIN, 0}, {winch, POLLIN, 0}};
+    int n = poll(fds, 2, timeout);
+    if(n < 0 && errno != EINTR) {
+      // Won't get better by trying again, and no event could be told apart from a real one
+      int err = errno;
+      disable_raw_mode();
+      clear();
+      switch_to_normal();
+      turn_cursor(ON);
+      info::error(std::string("Failed to wait for input: ") + strerror(err), err);
+      _exit(err);
+    }
+
+    if(n > 0 && (fds[1].revents & POLLIN)) {
+      struct signalfd_siginfo info;
+      while(read(winch, &info, sizeof(info)) == sizeof(info));
+      ready.push_back({Event::RESIZE, "", -1});
+    }
+
+    if(n > 0 && (fds[0].revents & POLLIN)) read_keys(false);
+    else if(n == 0 && !pending.empty()) read_keys(true);
+
+    now = std::chrono::steady_clock::now();
+    for(auto& timer : timers) {
+      if(timer.next > now) continue;
+      ready.push_back({Event::TIMER, "", timer.id});
+      timer.next += timer.interval;
+      if(timer.next <= now) timer.next = now + timer.interval; // Fell behind, don't fire a burst to catch up
+    }
+
+    // The terminal went away, there will never be another key
+    if(n > 0 && (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) && ready.empty()) Tui::cleanup_and_exit(0);
+  }
+
+  Event event = std::move(ready.front());
+  ready.pop_front();
+  return event;
+}
+
+void Tui::EventLoop::run(const std::function<void(const Event&)>& on_event) {
+  running = true;
+  while(running) on_event(wait());
+}
@@ -4,6 +4,15 @@
 #include <termios.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <csignal>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "../abstractions/iofuncs.h"
 
 void enable_raw_mode();
@@ -34,7 +43,115 @@ namespace Tui {
     int get_terminal_width();
     int get_terminal_height();
 
+    // Names keys the way the event loop does: "a", "Enter", "Ctrl+F", "ArrowUp", "PageDown", "Escape"...
+    // Returns "" when nothing was typed
     std::string get_keypress();
+
+    struct Event {
+      enum Type { KEY, RESIZE, TIMER } type;
+      std::string key; // For KEY
+      int timer = -1;  // For TIMER, what add_timer() returned
+    };
+
+    // Waits for keys, terminal resizes and timers in one poll(), so a TUI sleeps until one of them
+    // happens instead of spinning on get_keypress(). Resizes come in through a signalfd rather than
+    // a SIGWINCH handler, so they get handled like any other event instead of in signal context.
+    // SIGWINCH gets blocked for that, and threads only inherit that from whoever created them,
+    // so the loop has to exist before any threads get started
+    class EventLoop {
+      private:
+      struct Timer {
+        int id;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point next;
+      };
+
+      int tty = -1;
+      int winch = -1;
+      sigset_t old_mask;
+      std::string pending;     // Bytes read from the terminal that aren't a whole key yet
+      std::deque<Event> ready;
+      std::vector<Timer> timers;
+      int next_timer = 0;
+      bool running = false;
+
+      void read_keys(bool flush);
+
+      public:
+      EventLoop();
+      EventLoop(const EventLoop&) = delete;
+      EventLoop& operator=(const EventLoop&) = delete;
+      ~EventLoop();
+
+      // Fires every interval_ms until removed
+      int add_timer(int interval_ms);
+      void remove_timer(int id);
+
+      // Blocks until the next event
+      Event wait();
+
+      // Hands every event to on_event until stop() gets called
+      void run(const std::function<void(const Event&)>& on_event);
+      void stop() { running = false; }
+    };
+
+    // The whole terminal as a grid of cells, drawn into and then sent with present(). Only the cells that
+    // changed since the last present() get written, all in one write() inside a synchronized update, so
+    // moving a selection by one line costs two lines of output instead of a screenful
+    class Screen {
+      private:
+      struct Cell {
+        uint32_t glyph = ' ';  // UTF-8 bytes, 0 for the second column of a wide character
+        uint16_t style = 0;    // Into styles, 0 for none
+        bool operator==(const Cell& other) const { return glyph == other.glyph && style == other.style; }
+      };
+
+      struct Style {
+        std::string sgr;  // The SGR sequences in effect, from the last reset
+        std::string link; // OSC 8 hyperlink target, if any
+      };
+
+      int height = 0;
+      int width = 0;
+      std::vector<Cell> back;  // Being drawn
+      std::vector<Cell> front; // What the terminal shows
+      bool full_repaint = true;
+      std::vector<Style> styles = {{}};
+      std::unordered_map<std::string, uint16_t> style_ids;
+      int cursor_row = -1;
+      int cursor_col = -1;
+      int placed_row = -1; // Where present() last put the cursor
+      int placed_col = -1;
+
+      uint16_t intern(const Style& style);
+
+      public:
+      Screen();
+
+      int rows() const { return height; }
+      int cols() const { return width; }
+
+      // Starts a new frame with every cell blank, resizing first if the terminal was
+      void clear();
+
+      // Draws text from (row, col), clipped to the line. SGR sequences and OSC 8 links in it carry over
+      // into the cells, other escape sequences are dropped. Returns the column after the last one drawn
+      int print(int row, int col, std::string_view text);
+
+      // Blanks a row and draws text on it
+      void line(int row, std::string_view text);
+
+      // Where the cursor goes after present(), -1 to leave it wherever drawing ended
+      void place_cursor(int row, int col);
+
+      // Forgets what the terminal shows, for when something else drew over it
+      void invalidate() { full_repaint = true; }
+
+      void present();
+
+      // Columns text takes up on screen, escape sequences not counted
+      static int text_width(std::string_view text);
+    };
 }
 
 #endif // TUI_H